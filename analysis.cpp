@@ -0,0 +1,202 @@
+// analysis.cpp
+#include "analysis.h"
+#include "cfg.h"
+#include "scoperesolver.h"
+#include "typeinference.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <thread>
+#include <tuple>
+
+// Inputs with more tokens than this parse the top level first, skipping
+// block bodies, and then parse all the bodies in parallel before any pass
+// runs. Either way a block ends up with the same statements and errors.
+static const size_t LAZY_BLOCK_TOKEN_THRESHOLD = 200000;
+
+// Sources larger than this (in bytes) are lexed and parsed as a pipeline.
+// The parser then reads tokens as they are lexed, so it parses eagerly.
+static const size_t PIPELINE_SOURCE_THRESHOLD = 1 << 20;
+static const size_t TOKEN_RING_CAPACITY = 64;   // batches in flight
+static const size_t TOKEN_BATCH_SIZE = 1024;    // tokens per batch
+
+std::shared_ptr<AnalysisResult> analyzeSource(const std::string& code, const CancellationToken& cancel,
+                                              ConstantFolder& folder, bool trace, bool compile)
+{
+    auto result = std::make_shared<AnalysisResult>();
+    result->compileRequested = compile;
+    QElapsedTimer total;
+    total.start();
+
+    PythonLexer lexer(code);
+    lexer.setCancellation(&cancel);
+    std::vector<Token> tokens;
+    std::vector<LexicalError> lexicalErrors;
+
+    // Large inputs lex on a second thread that feeds the parser through a
+    // bounded token ring, so parsing overlaps lexing
+    std::unique_ptr<SyntaxAnalyzer> pipelinedParser;
+    ParseNode* pipelinedTree = nullptr;
+    if (code.size() > PIPELINE_SOURCE_THRESHOLD) {
+        QElapsedTimer timer;
+        timer.start();
+
+        TokenRing ring(TOKEN_RING_CAPACITY);
+        lexer.setTokenSink(&ring, TOKEN_BATCH_SIZE);
+        std::exception_ptr lexerFailure;
+        std::thread lexerThread([&]() {
+            try {
+                std::tie(tokens, lexicalErrors) = lexer.tokenize();
+            } catch (...) {
+                lexerFailure = std::current_exception();
+                ring.close();
+            }
+        });
+
+        pipelinedParser = std::make_unique<SyntaxAnalyzer>(ring);
+        pipelinedParser->setCancellation(&cancel);
+        pipelinedParser->setTrace(trace);
+        pipelinedTree = pipelinedParser->parseProgram();
+        lexerThread.join();
+        lexer.setTokenSink(nullptr);
+        if (lexerFailure) {
+            SyntaxAnalyzer::deleteTree(pipelinedTree);
+            std::rethrow_exception(lexerFailure);
+        }
+
+        const RingStats stats = ring.stats();
+        const double seconds = std::max(timer.nsecsElapsed() / 1e9, 1e-9);
+        result->pipelineStatus =
+            QString("Pipeline: %1 tokens in %2 ms (%3 tokens/s); ring occupancy %4 avg / %5 max of %6 batches; "
+                    "lexer stalls %7, parser stalls %8")
+                .arg(tokens.size())
+                .arg(timer.elapsed())
+                .arg(qRound64(tokens.size() / seconds))
+                .arg(stats.meanOccupancy, 0, 'f', 1)
+                .arg(stats.maxOccupancy)
+                .arg(stats.capacity)
+                .arg(stats.producerStalls)
+                .arg(stats.consumerStalls);
+    } else {
+        std::tie(tokens, lexicalErrors) = lexer.tokenize();
+    }
+    if (cancel.isCancelled()) {
+        SyntaxAnalyzer::deleteTree(pipelinedTree);
+        result->cancelled = true;
+        return result;
+    }
+
+    // Debug: Print all tokens
+    if (trace) {
+        std::cout << "\nAll tokens:" << std::endl;
+        for (const auto& token : tokens) {
+            std::cout << "[Line " << token.line << ":" << token.column << "] "
+                      << tokenTypeToString(token.type) << ": '" << token.lexeme << "'" << std::endl;
+        }
+    }
+
+    // The token view formats rows from the store as they are painted
+    auto tokenStore = std::make_shared<std::vector<Token>>(std::move(tokens));
+    result->tokens = tokenStore;
+
+    // Lexical errors with line numbers
+    for (const auto& error : lexicalErrors) {
+        result->lexicalErrorOutput += QString("[Line %1:%2] Lexical Error: %3\n")
+            .arg(error.line)
+            .arg(error.column)
+            .arg(QString::fromStdString(error.message));
+    }
+
+    // If there are lexical errors, don't proceed with parsing
+    if (!lexicalErrors.empty()) {
+        SyntaxAnalyzer::deleteTree(pipelinedTree);
+        result->hasLexicalErrors = true;
+        result->elapsedMs = total.elapsed();
+        return result;
+    }
+
+    // The pipeline has already parsed; otherwise parse the finished stream
+    std::unique_ptr<SyntaxAnalyzer> sequentialParser;
+    ParseNode* tree = pipelinedTree;
+    if (!pipelinedParser) {
+        // Filter out comment tokens before parsing
+        result->parseTokens = std::make_shared<std::vector<Token>>();
+        std::vector<Token>& parseTokens = *result->parseTokens;
+        parseTokens.reserve(tokenStore->size());
+        for (const auto& token : *tokenStore) {
+            if (token.type != TokenType::COMMENT) {
+                parseTokens.push_back(token);
+            }
+        }
+
+        // Independent top-level statements are parsed concurrently on large inputs
+        sequentialParser = std::make_unique<SyntaxAnalyzer>(parseTokens);
+        if (parseTokens.size() > LAZY_BLOCK_TOKEN_THRESHOLD) {
+            sequentialParser->setLazyBlocks(true, std::make_shared<const std::vector<BlockSpan>>(lexer.getBlocks()));
+        }
+        sequentialParser->setCancellation(&cancel);
+        sequentialParser->setTrace(trace);
+        tree = sequentialParser->parseProgramParallel();
+    }
+    if (cancel.isCancelled()) {
+        SyntaxAnalyzer::deleteTree(tree);
+        result->cancelled = true;
+        return result;
+    }
+    SyntaxAnalyzer& parser = pipelinedParser ? *pipelinedParser : *sequentialParser;
+    result->tree = tree;
+    result->syntaxErrors = parser.getErrors();
+
+    // Names, types and folded values inside function bodies, and the syntax
+    // errors there, must not depend on which blocks the tree view expanded
+    SyntaxAnalyzer::materializeAll(tree, result->syntaxErrors, &cancel);
+    if (cancel.isCancelled()) {
+        SyntaxAnalyzer::deleteTree(tree);
+        result->tree = nullptr;
+        result->cancelled = true;
+        return result;
+    }
+
+    // Data types come from flow-sensitive inference over the control-flow
+    // graphs; names that fold to one constant then show its exact value
+    result->symbolTable = lexer.getSymbolTable();
+    if (tree != nullptr) {
+        ScopeResolver resolver;
+        resolver.run(tree);
+        CfgBuilder cfgBuilder;
+        const std::vector<ControlFlowGraph> graphs = cfgBuilder.build(tree);
+        TypeInference inference;
+        inference.run(graphs, resolver);
+        inference.annotate(result->symbolTable);
+
+        // The folder's saved state is only replaced by a run that finishes
+        if (cancel.isCancelled()) {
+            SyntaxAnalyzer::deleteTree(tree);
+            result->tree = nullptr;
+            result->cancelled = true;
+            return result;
+        }
+        folder.setResolver(&resolver);
+        folder.setGraphs(&graphs);
+        folder.run(tree);
+        folder.setGraphs(nullptr);
+        folder.setResolver(nullptr);
+        folder.annotate(result->symbolTable);
+        result->warnings = folder.getDiagnostics();
+
+        // Run executes the tree every pass above has seen
+        if (compile && result->syntaxErrors.empty()) {
+            BytecodeCompiler compiler;
+            auto program = std::make_shared<BytecodeProgram>();
+            if (compiler.compile(tree, *program)) {
+                result->program = std::move(program);
+            }
+            result->compileErrors = compiler.getErrors();
+        }
+    }
+
+    result->elapsedMs = total.elapsed();
+    return result;
+}
@@ -0,0 +1,52 @@
+// analysis.h
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <QMetaType>
+#include <QString>
+#include "bytecode.h"
+#include "cancellation.h"
+#include "constantfolder.h"
+#include "pythonlexer.h"
+#include "syntaxanalyzer.h"
+
+// Everything one analysis produces for the main window. It is built on a
+// worker thread and handed to the GUI thread whole, so it holds no widgets.
+struct AnalysisResult {
+    uint64_t generation = 0;            // request this answers; older ones are stale
+    bool cancelled = false;             // superseded before it finished; nothing below is valid
+
+    std::shared_ptr<const std::vector<Token>> tokens;  // every token, comments included
+    QString lexicalErrorOutput;
+    bool hasLexicalErrors = false;      // then nothing was parsed
+
+    ParseNode* tree = nullptr;          // owned by the receiver
+    std::shared_ptr<std::vector<Token>> parseTokens;    // unparsed blocks of `tree` point into it
+    std::vector<SyntaxError> syntaxErrors;
+    std::vector<FoldDiagnostic> warnings;
+    SymbolTable symbolTable;
+
+    // Bytecode of `tree` for Run, when the request asked for it; null if
+    // the program had errors
+    bool compileRequested = false;
+    std::shared_ptr<const BytecodeProgram> program;
+    std::vector<CompileError> compileErrors;
+
+    QString pipelineStatus;             // ring statistics when the input went through the pipeline
+    qint64 elapsedMs = 0;
+};
+
+// Lex, parse and annotate `code`, polling `cancel` on the way. `folder`
+// keeps state between runs, so runs sharing one must not overlap. `trace`
+// echoes the tokens and the parser's steps on stdout. `compile` also
+// compiles the tree to bytecode once it has no syntax errors.
+std::shared_ptr<AnalysisResult> analyzeSource(const std::string& code, const CancellationToken& cancel,
+                                              ConstantFolder& folder, bool trace = true, bool compile = false);
+
+Q_DECLARE_METATYPE(std::shared_ptr<AnalysisResult>)
+
+#endif // ANALYSIS_H
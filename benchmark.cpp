@@ -0,0 +1,364 @@
+// benchmark.cpp
+// Timings behind the performance work on the analyzer, the VM and the tree
+// layout. Built only with -DBUILD_BENCHMARKS=ON; run as
+//     Finalproject_bench [section...]
+// with no arguments running every section. Inputs are generated, so the
+// figures compare between sections and builds, not between machines.
+#include "analysis.h"
+#include "numeric.h"
+#include "syntaxanalyzer.h"
+#include "tokenring.h"
+#include "treelayout.h"
+#include "vm.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double percentile(std::vector<double> samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, size_t(p * samples.size()))];
+}
+
+// A program of about `lines` lines mixing the statements the analyzer
+// supports. With `brokenEvery` set, every so many statements is replaced
+// by one with a syntax or evaluation error.
+static std::string generateProgram(size_t lines, size_t brokenEvery = 0) {
+    static const char* const broken[] = {
+        "q%1 = 1 / 0\n",
+        "q%1 = undefined%1 + 1\n",
+        "q%1 = (1 + 2\n",
+        "q%1 = 3 * * 4\n",
+        "q%1 = 2 ** 1000000\n",
+    };
+    std::string code;
+    size_t written = 0;
+    for (size_t k = 0; written < lines; ++k) {
+        const std::string n = std::to_string(k);
+        if (brokenEvery && k % brokenEvery == brokenEvery - 1) {
+            std::string line = broken[k / brokenEvery % 5];
+            for (size_t at; (at = line.find("%1")) != std::string::npos;) line.replace(at, 2, n);
+            code += line;
+            written += 1;
+            continue;
+        }
+        switch (k % 5) {
+        case 0:
+            code += "def f" + n + "(a, b):\n    c = a + b * " + n + "\n    if c > 3:\n        return c\n    return a\n";
+            written += 5;
+            break;
+        case 1:
+            code += "x" + n + " = 3 + 2 * " + n + "\ny" + n + " = x" + n + " - 0x1F\n";
+            written += 2;
+            break;
+        case 2:
+            code += "x" + n + " = 0\nwhile x" + n + " < 10:\n    x" + n + " = x" + n + " + 1\n";
+            written += 3;
+            break;
+        case 3:
+            code += "for j in range(10):\n    t" + n + " = j * 2\n    print(t" + n + ")\n";
+            written += 3;
+            break;
+        default:
+            code += "s" + n + " = \"str" + n + "\"  # comment\nprint(s" + n + ")\n";
+            written += 2;
+            break;
+        }
+    }
+    return code;
+}
+
+//——— VM ———
+
+// Runs `code` unprofiled for the time and profiled for the instruction
+// count, and reports the cost per instruction
+static void benchProgram(const char* name, const std::string& code) {
+    ConstantFolder folder;
+    CancellationToken cancel;
+    auto analysis = analyzeSource(code, cancel, folder, false, true);
+    SyntaxAnalyzer::deleteTree(analysis->tree);
+    if (!analysis->program) {
+        std::printf("  %-10s did not compile\n", name);
+        return;
+    }
+
+    VirtualMachine vm(*analysis->program);
+    Clock::time_point start = Clock::now();
+    const bool ok = vm.run();
+    const double plainMs = msSince(start);
+
+    vm.setProfiling(true);
+    start = Clock::now();
+    vm.run();
+    const double profiledMs = msSince(start);
+    const uint64_t instructions = vm.getProfile().instructions;
+
+    std::printf("  %-10s %12llu instructions  %8.1f ms  %5.2f ns/instruction  profiled %8.1f ms%s\n", name,
+                (unsigned long long)instructions, plainMs, plainMs * 1e6 / double(instructions), profiledMs,
+                ok ? "" : "  (runtime error)");
+}
+
+static void benchVm() {
+    std::printf("VM\n");
+    benchProgram("arith", "total = 0\nfor i in range(20000000):\n    total = total + i * 3 % 7\nprint(total)\n");
+    benchProgram("while", "i = 0\nwhile i < 10000000:\n    i = i + 1\n");
+    benchProgram("calls", "def fib(n):\n    if n < 2:\n        return n\n    return fib(n - 1) + fib(n - 2)\nprint(fib(27))\n");
+    benchProgram("strings", "i = 0\nwhile i < 3000:\n    s = \"x\" * 1000000\n    i = i + 1\nprint(len(s))\n");
+}
+
+//——— Numerics ———
+
+static void benchNumeric() {
+    const int n = 200000000;
+    volatile int64_t seed = 3;
+    volatile double realSeed = 3;
+
+    Clock::time_point start = Clock::now();
+    Integer acc(0);
+    const Integer step = Integer(seed);
+    for (int i = 0; i < n; ++i) {
+        acc = acc + step;
+        if (acc.smallValue() > (int64_t(1) << 60)) acc = Integer(0);
+    }
+    const double integerMs = msSince(start);
+
+    start = Clock::now();
+    int64_t raw = 0;
+    for (int i = 0; i < n; ++i) {
+        raw += seed;
+        if (raw > (int64_t(1) << 60)) raw = 0;
+    }
+    const double rawMs = msSince(start);
+
+    start = Clock::now();
+    double real = 0;
+    for (int i = 0; i < n; ++i) {
+        real += realSeed;
+        if (real > 1e18) real = 0;
+    }
+    const double realMs = msSince(start);
+
+    start = Clock::now();
+    Integer big(1);
+    for (int i = 0; i < 2000; ++i) big = big * Integer(int64_t(1000003));
+    const double bigMs = msSince(start);
+
+    std::printf("Numerics\n");
+    std::printf("  Integer add   %5.2f ns/op\n", integerMs * 1e6 / n);
+    std::printf("  int64 add     %5.2f ns/op\n", rawMs * 1e6 / n);
+    std::printf("  double add    %5.2f ns/op\n", realMs * 1e6 / n);
+    std::printf("  2000 big multiplies up to %zu bits: %.1f ms  (%s %lld %g)\n", big.bitLength(), bigMs,
+                acc.toString().c_str(), (long long)raw, real);
+}
+
+//——— Error-dense analysis ———
+
+static void benchErrors() {
+    const size_t lines = 20000;
+    std::printf("Error-dense analysis, %zu lines\n", lines);
+    for (size_t every : { size_t(0), size_t(8), size_t(2) }) {
+        const std::string code = generateProgram(lines, every);
+        std::vector<double> times;
+        size_t errors = 0;
+        for (int run = 0; run < 5; ++run) {
+            ConstantFolder folder;
+            CancellationToken cancel;
+            const Clock::time_point start = Clock::now();
+            auto analysis = analyzeSource(code, cancel, folder, false);
+            times.push_back(msSince(start));
+            errors = analysis->syntaxErrors.size() + analysis->warnings.size();
+            SyntaxAnalyzer::deleteTree(analysis->tree);
+        }
+        std::printf("  %-22s %8.1f ms median  %6zu diagnostics\n",
+                    every ? ("1 in " + std::to_string(every) + " broken").c_str() : "clean",
+                    percentile(times, 0.5), errors);
+    }
+}
+
+//——— Streaming parse ———
+
+static void benchStream() {
+    const std::string code = generateProgram(500000);
+    std::printf("Parse, %zu bytes\n", code.size());
+
+    Clock::time_point start = Clock::now();
+    {
+        PythonLexer lexer(code);
+        std::vector<Token> tokens;
+        for (Token& token : lexer.tokenize().first) {
+            if (token.type != TokenType::COMMENT) tokens.push_back(std::move(token));
+        }
+        SyntaxAnalyzer parser(tokens);
+        parser.setTrace(false);
+        ParseNode* tree = parser.parseProgram();
+        std::printf("  whole tree       %8.1f ms  %zu statements\n", msSince(start), size_t(tree->children.size()));
+        SyntaxAnalyzer::deleteTree(tree);
+    }
+
+    start = Clock::now();
+    {
+        PythonLexer lexer(code);
+        TokenRing ring(256);
+        lexer.setTokenSink(&ring, 64);
+        std::thread producer([&lexer]() { lexer.tokenize(); });
+        SyntaxAnalyzer parser(ring);
+        parser.setTrace(false);
+        size_t defs = 0;
+        const size_t statements = parser.parseStreaming([&defs](const ParseNode* statement) {
+            if (statement->name == "FuncDef") defs++;
+        });
+        producer.join();
+        std::printf("  streamed, ring   %8.1f ms  %zu statements, %zu defs\n", msSince(start), statements, defs);
+    }
+}
+
+//——— Live analysis latency ———
+
+// Worker time of an analysis after a one-character edit of a 10k-line
+// file; showing the results on the GUI thread comes on top
+static void benchLive() {
+    std::string code = generateProgram(10000);
+    ConstantFolder folder;
+    folder.setMemoized(true);
+    CancellationToken cancel;
+    std::mt19937 random(7);
+    std::vector<double> times;
+    for (int run = 0; run <= 50; ++run) {
+        if (run > 0) {
+            // Append a digit to a line that ends in one
+            for (;;) {
+                const size_t end = code.find('\n', random() % code.size());
+                if (end != std::string::npos && end > 0 && std::isdigit((unsigned char)code[end - 1])) {
+                    code.insert(end, "7");
+                    break;
+                }
+            }
+        }
+        const Clock::time_point start = Clock::now();
+        auto analysis = analyzeSource(code, cancel, folder, false);
+        if (run > 0) times.push_back(msSince(start));
+        SyntaxAnalyzer::deleteTree(analysis->tree);
+    }
+    std::printf("Live analysis, 10k lines, one-character edits\n");
+    std::printf("  median %.1f ms  p95 %.1f ms  (budget: p95 under 50 ms)\n", percentile(times, 0.5),
+                percentile(times, 0.95));
+}
+
+//——— Tree layout ———
+
+// Random tree numbered in pre-order, shaped like parse trees: mostly deep
+// and narrow, with the odd wide node
+static TreeGeometry randomTree(int n, unsigned seed) {
+    std::mt19937 random(seed);
+    const size_t count = size_t(n);
+    std::vector<int> parent(count, -1);
+    for (int i = 1; i < n; ++i) {
+        parent[size_t(i)] = std::max(0, i - 1 - int(random() % 6));
+        if (random() % 40 == 0) parent[size_t(i)] = int(random() % unsigned(i));
+    }
+
+    // Renumber in pre-order
+    std::vector<std::vector<int>> children(count);
+    for (int i = 1; i < n; ++i) children[size_t(parent[size_t(i)])].push_back(i);
+    TreeGeometry tree;
+    std::vector<std::pair<int, int>> pending{ { 0, -1 } };
+    while (!pending.empty()) {
+        const auto [node, newParent] = pending.back();
+        pending.pop_back();
+        const int index = int(tree.size());
+        tree.parent.push_back(newParent);
+        tree.depth.push_back(newParent < 0 ? 0 : tree.depth[size_t(newParent)] + 1);
+        tree.x.push_back(0);
+        tree.width.push_back(40 + 8 * qreal(random() % 14));
+        tree.label.push_back(QString());
+        tree.collapsed.push_back(0);
+        for (size_t c = children[size_t(node)].size(); c-- > 0;) pending.push_back({ children[size_t(node)][c], index });
+    }
+    return tree;
+}
+
+// The leaf-counter layout the tidy layout replaced, with std::map standing
+// in for its QMap, kept as the baseline
+static qreal previousLayout(const TreeGeometry& tree) {
+    const qreal nodeWidth = 150, spacing = 20;
+    std::vector<std::vector<int>> children(tree.size());
+    for (size_t i = 1; i < tree.size(); ++i) children[size_t(tree.parent[i])].push_back(int(i));
+
+    std::map<int, qreal> x;
+    qreal next = 0;
+    struct Frame { int node; size_t nextChild; };
+    std::vector<Frame> stack{ { 0, 0 } };
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const std::vector<int>& kids = children[size_t(frame.node)];
+        if (frame.nextChild < kids.size()) {
+            stack.push_back({ kids[frame.nextChild++], 0 });
+            continue;
+        }
+        const int node = frame.node;
+        stack.pop_back();
+        if (kids.empty()) {
+            x[node] = next;
+            next += nodeWidth + spacing;
+            continue;
+        }
+        qreal left = x[kids.front()], right = x[kids.back()];
+        if (right - left < nodeWidth && kids.size() > 1) {
+            const qreal start = (left + right) / 2 - (kids.size() - 1) * (nodeWidth + spacing) / 2;
+            for (size_t i = 0; i < kids.size(); ++i) x[kids[i]] = start + qreal(i) * (nodeWidth + spacing);
+            left = x[kids.front()];
+            right = x[kids.back()];
+        }
+        x[node] = (left + right) / 2;
+    }
+    return next;
+}
+
+static void benchLayout() {
+    std::printf("Tree layout\n");
+    for (int n : { 10000, 100000, 1000000 }) {
+        TreeGeometry tree = randomTree(n, 1);
+
+        Clock::time_point start = Clock::now();
+        const qreal previousWidth = previousLayout(tree);
+        const double previousMs = msSince(start);
+
+        start = Clock::now();
+        layoutTidyTree(tree, 20, 40);
+        const double tidyMs = msSince(start);
+        const auto [left, right] = std::minmax_element(tree.x.begin(), tree.x.end());
+
+        std::printf("  %8d nodes  previous %7.1f ms  tidy %7.1f ms  width %.3g -> %.3g\n", n, previousMs, tidyMs,
+                    previousWidth, *right - *left);
+    }
+}
+
+int main(int argc, char** argv) {
+    static const std::pair<const char*, void (*)()> sections[] = {
+        { "vm", benchVm },
+        { "numeric", benchNumeric },
+        { "errors", benchErrors },
+        { "stream", benchStream },
+        { "live", benchLive },
+        { "layout", benchLayout },
+    };
+    for (const auto& [name, run] : sections) {
+        bool wanted = argc == 1;
+        for (int i = 1; i < argc; ++i) wanted = wanted || std::strcmp(argv[i], name) == 0;
+        if (wanted) run();
+    }
+    return 0;
+}
@@ -0,0 +1,492 @@
+// bytecode.cpp
+#include "bytecode.h"
+#include <sstream>
+#include <iomanip>
+
+const char* opName(Op op) {
+    static const char* const names[] = {
+#define BYTECODE_NAME(name) #name,
+        BYTECODE_OPCODES(BYTECODE_NAME)
+#undef BYTECODE_NAME
+    };
+    return op < Op::Count ? names[size_t(op)] : "?";
+}
+
+std::string BytecodeProgram::disassemble() const {
+    std::ostringstream out;
+    for (size_t pc = 0; pc < code.size(); ++pc) {
+        for (size_t f = 0; f < functions.size(); ++f) {
+            if (functions[f].entry == pc && f != 0) {
+                out << functions[f].name << ":\n";
+            }
+        }
+        const Instr& ins = code[pc];
+        out << std::setw(6) << pc << "  line " << std::setw(4) << lines[pc] << "  "
+            << std::left << std::setw(12) << opName(ins.op) << std::right << ' ' << ins.a;
+        if (ins.op == Op::CallBuiltin) out << " builtin " << int(ins.b);
+        if (ins.op == Op::LoadGlobal || ins.op == Op::StoreGlobal) out << " (" << globalNames[ins.a] << ")";
+        out << '\n';
+    }
+    return out.str();
+}
+
+namespace {
+
+bool isBuiltinName(const QString& name, Builtin& id) {
+    if (name == "print") { id = Builtin::Print; return true; }
+    if (name == "len")   { id = Builtin::Len;   return true; }
+    if (name == "input") { id = Builtin::Input; return true; }
+    return false;
+}
+
+} // namespace
+
+//——— Emission helpers ———
+
+size_t BytecodeCompiler::emit(Op op, int32_t a, uint8_t b) {
+    program->code.push_back({ op, b, a });
+    program->lines.push_back(currentLine);
+    return program->code.size() - 1;
+}
+
+void BytecodeCompiler::patchJump(size_t at) {
+    program->code[at].a = here();
+}
+
+int32_t BytecodeCompiler::addConstant(const Value& v) {
+    program->constants.push_back(v);
+    return int32_t(program->constants.size() - 1);
+}
+
+int32_t BytecodeCompiler::addString(const std::string& s) {
+    auto it = stringConstants.find(s);
+    if (it != stringConstants.end()) return it->second;
+    program->strings.push_back(s);
+    int32_t constant = addConstant(Value::string(uint32_t(program->strings.size() - 1)));
+    stringConstants.emplace(s, constant);
+    return constant;
+}
+
+void BytecodeCompiler::error(const std::string& message) {
+    errors.push_back({ message, currentLine });
+}
+
+// Globals and the running function's locals are addressed by slot; the
+// VM has no closures, so another function's locals cannot be reached
+void BytecodeCompiler::emitLoad(const ParseNode* ref) {
+    const Slot* slot = resolver.slotOf(ref);
+    if (!slot) {
+        error("Unresolved name: " + ref->value.toStdString());
+        return;
+    }
+    const std::string name(resolver.nameOf(*slot));
+    if (slot->scope == ScopeResolver::MODULE_SCOPE) {
+        emit(Op::LoadGlobal, slot->index);
+    } else if (slot->scope == currentScope) {
+        emit(Op::LoadLocal, slot->index);
+    } else if (slot->scope == ScopeResolver::BUILTIN_SCOPE) {
+        error("builtin '" + name + "' can only be called");
+    } else {
+        error("free variable '" + name + "' of an enclosing function is not supported");
+    }
+}
+
+void BytecodeCompiler::emitStore(const ParseNode* ref) {
+    const Slot* slot = resolver.slotOf(ref);
+    if (!slot) {
+        error("Unresolved name: " + ref->value.toStdString());
+        return;
+    }
+    emit(slot->scope == ScopeResolver::MODULE_SCOPE ? Op::StoreGlobal : Op::StoreLocal, slot->index);
+}
+
+// A call of print/len/input/range that is not shadowed by a user binding
+bool BytecodeCompiler::isBuiltinCall(const ParseNode* call, Builtin* id) const {
+    const Slot* slot = resolver.slotOf(call);
+    if (!slot || slot->scope != ScopeResolver::BUILTIN_SCOPE) return false;
+    Builtin builtin = Builtin::Print;
+    const bool vmBuiltin = isBuiltinName(call->value, builtin);
+    if (id) *id = builtin;
+    return vmBuiltin || call->value == "range";
+}
+
+//——— Program and statements ———
+
+bool BytecodeCompiler::compile(ParseNode* root, BytecodeProgram& out) {
+    out = BytecodeProgram();
+    program = &out;
+    errors.clear();
+    stringConstants.clear();
+    currentScope = ScopeResolver::MODULE_SCOPE;
+    loops.clear();
+    currentLine = 0;
+
+    FunctionInfo module;
+    module.name = "<module>";
+    out.functions.push_back(module);
+
+    // Resolution also parses every unparsed block the program can reach
+    resolver.setMaterializeBlocks(true);
+    resolver.run(root);
+    for (const auto& err : resolver.getErrors()) {
+        errors.push_back({ err.message, err.line });
+    }
+    folder.setResolver(&resolver);
+    folder.run(root);
+    const Scope& globals = resolver.getScopes()[ScopeResolver::MODULE_SCOPE];
+    for (int32_t slot = 0; slot < int32_t(globals.names.size()); ++slot) {
+        out.globalNames.push_back(std::string(resolver.nameOf({ ScopeResolver::MODULE_SCOPE, slot })));
+    }
+
+    if (root) {
+        for (ParseNode* stmt : root->children) {
+            compileStatement(stmt);
+        }
+    }
+    emit(Op::Halt);
+    return errors.empty();
+}
+
+// Parse an unparsed block; its syntax errors become compile errors
+void BytecodeCompiler::materialize(ParseNode* node) {
+    if (!node || !node->lazy) return;
+    std::vector<SyntaxError> blockErrors;
+    SyntaxAnalyzer::materialize(node, &blockErrors);
+    for (const auto& err : blockErrors) {
+        errors.push_back({ err.message, err.line });
+    }
+}
+
+// A compound statement's body is a Block holding every statement of the
+// indented suite; a header whose block was missing has a single statement
+void BytecodeCompiler::compileBody(ParseNode* body) {
+    if (!body) return;
+    if (body->name != "Block") {
+        compileStatement(body);
+        return;
+    }
+
+    materialize(body);
+    for (ParseNode* stmt : body->children) {
+        compileStatement(stmt);
+    }
+}
+
+void BytecodeCompiler::compileStatement(ParseNode* node) {
+    if (!node) return;
+    if (node->line) currentLine = node->line;
+
+    const QString& kind = node->name;
+    if (kind == "Assignment") {
+        compileAssignment(node);
+    } else if (kind == "ExprStmt") {
+        if (!node->children.isEmpty()) {
+            compileExpression(node->children[0]);
+            emit(Op::Pop);
+        }
+    } else if (kind == "FuncCall") {
+        compileExpression(node);
+        emit(Op::Pop);
+    } else if (kind == "IfStmt") {
+        compileIf(node);
+    } else if (kind == "WhileStmt") {
+        compileWhile(node);
+    } else if (kind == "ForStmt") {
+        compileFor(node);
+    } else if (kind == "FuncDef") {
+        compileFuncDef(node);
+    } else if (kind == "ReturnStmt") {
+        if (currentScope == ScopeResolver::MODULE_SCOPE) {
+            error("'return' outside function");
+        } else if (!node->children.isEmpty()) {
+            compileExpression(node->children[0]);
+            emit(Op::Return);
+        } else {
+            emit(Op::ReturnNone);
+        }
+    } else if (kind == "BreakStmt") {
+        if (loops.empty()) {
+            error("'break' outside loop");
+            return;
+        }
+        if (loops.back().stackItems) emit(Op::PopN, loops.back().stackItems);
+        loops.back().breakJumps.push_back(emit(Op::Jump));
+    } else if (kind == "ContinueStmt") {
+        if (loops.empty()) {
+            error("'continue' not properly in loop");
+            return;
+        }
+        emit(Op::Jump, loops.back().continueTarget);
+    } else if (kind == "PassStmt") {
+        // nothing to do
+    } else if (kind == "Block") {
+        compileBody(node);
+    } else {
+        error("Unsupported statement: " + kind.toStdString());
+    }
+}
+
+void BytecodeCompiler::compileAssignment(ParseNode* node) {
+    if (node->children.size() < 2) {
+        error("Incomplete assignment");
+        return;
+    }
+    const ParseNode* target = node->children[0];
+    const QString& op = node->value;
+
+    if (op == "=") {
+        compileExpression(node->children[1]);
+    } else {
+        emitLoad(target);
+        compileExpression(node->children[1]);
+        if (op == "+=")      emit(Op::Add);
+        else if (op == "-=") emit(Op::Sub);
+        else if (op == "*=") emit(Op::Mul);
+        else if (op == "/=") emit(Op::Div);
+        else error("Unsupported assignment operator: " + op.toStdString());
+    }
+    emitStore(target);
+}
+
+// IfStmt: condition, body, then any Elif(condition, body) and an optional
+// Else(body)
+void BytecodeCompiler::compileIf(ParseNode* node) {
+    const size_t none = size_t(-1);
+    std::vector<size_t> endJumps;
+
+    compileExpression(node->children.value(0));
+    size_t nextClause = emit(Op::JumpIfFalse);
+    compileBody(node->children.value(1));
+
+    for (int i = 2; i < node->children.size(); ++i) {
+        ParseNode* clause = node->children[i];
+        if (!clause) continue;
+        endJumps.push_back(emit(Op::Jump));
+        if (nextClause != none) patchJump(nextClause);
+        nextClause = none;
+
+        if (clause->name == "Elif") {
+            compileExpression(clause->children.value(0));
+            nextClause = emit(Op::JumpIfFalse);
+            compileBody(clause->children.value(1));
+        } else {
+            compileBody(clause->children.value(0));
+        }
+    }
+
+    if (nextClause != none) patchJump(nextClause);
+    for (size_t jump : endJumps) {
+        patchJump(jump);
+    }
+}
+
+void BytecodeCompiler::compileWhile(ParseNode* node) {
+    const int32_t top = here();
+    compileExpression(node->children.value(0));
+    const size_t exit = emit(Op::JumpIfFalse);
+
+    loops.push_back({ top, {}, 0 });
+    compileBody(node->children.value(1));
+    emit(Op::Jump, top);
+
+    patchJump(exit);
+    for (size_t jump : loops.back().breakJumps) {
+        patchJump(jump);
+    }
+    loops.pop_back();
+}
+
+// Only range() iterables are compiled: the start/stop/step triple stays on
+// the stack for the duration of the loop and ForRange produces each value
+void BytecodeCompiler::compileFor(ParseNode* node) {
+    ParseNode* targets = node->children.value(0);
+    ParseNode* iterable = node->children.value(1);
+    if (!targets || targets->children.size() != 1) {
+        error("for loops support a single target");
+        return;
+    }
+    if (!iterable || iterable->name != "FuncCall" || iterable->value != "range" || !isBuiltinCall(iterable) ||
+        iterable->children.isEmpty() || iterable->children.size() > 3) {
+        error("for loops are only supported over range() with 1 to 3 arguments");
+        return;
+    }
+
+    const auto& args = iterable->children;
+    if (args.size() == 1) {
+        emit(Op::LoadConst, addConstant(Value::integer(0)));
+        compileExpression(args[0]);
+    } else {
+        compileExpression(args[0]);
+        compileExpression(args[1]);
+    }
+    if (args.size() == 3) {
+        compileExpression(args[2]);
+    } else {
+        emit(Op::LoadConst, addConstant(Value::integer(1)));
+    }
+
+    const int32_t top = here();
+    const size_t exit = emit(Op::ForRange);
+    emitStore(targets->children[0]);
+
+    loops.push_back({ top, {}, 3 });
+    compileBody(node->children.value(2));
+    emit(Op::Jump, top);
+
+    patchJump(exit);
+    for (size_t jump : loops.back().breakJumps) {
+        patchJump(jump);
+    }
+    loops.pop_back();
+}
+
+// The body is emitted inline behind a jump; the function value is then
+// bound to its name like any other assignment
+void BytecodeCompiler::compileFuncDef(ParseNode* node) {
+    ParseNode* nameNode = node->children.value(0);
+    const int32_t scopeId = resolver.scopeOf(node);
+    if (!nameNode || scopeId < 0) return;
+
+    ParseNode* body = nullptr;
+    for (int i = 1; i < node->children.size(); ++i) {
+        ParseNode* child = node->children[i];
+        if (!child || child->name != "ParamList") body = child;
+    }
+
+    const Scope& scope = resolver.getScopes()[scopeId];
+    FunctionInfo info;
+    info.name = scope.name;
+    info.params = scope.params;
+    info.locals = uint16_t(scope.names.size());
+    for (int32_t slot = 0; slot < int32_t(scope.names.size()); ++slot) {
+        info.localNames.push_back(std::string(resolver.nameOf({ scopeId, slot })));
+    }
+
+    const size_t skip = emit(Op::Jump);
+    info.entry = uint32_t(here());
+    const uint32_t index = uint32_t(program->functions.size());
+    program->functions.push_back(info);
+
+    // Compile the body in its own scope
+    const int32_t enclosingScope = currentScope;
+    std::vector<LoopContext> enclosingLoops;
+    enclosingLoops.swap(loops);
+    const int headerLine = currentLine;
+    currentScope = scopeId;
+
+    compileBody(body);
+    emit(Op::ReturnNone);
+
+    currentScope = enclosingScope;
+    loops.swap(enclosingLoops);
+    currentLine = headerLine;
+    patchJump(skip);
+
+    emit(Op::LoadConst, addConstant(Value::function(index)));
+    emitStore(nameNode);
+}
+
+//——— Expressions ———
+
+void BytecodeCompiler::emitLiteral(const ParseNode* node) {
+    Constant value;
+    std::string message;
+    if (!ConstantFolder::literalValue(node, value, message)) {
+        error(message);
+        return;
+    }
+    emitConstant(value);
+}
+
+void BytecodeCompiler::emitConstant(const Constant& c) {
+    switch (c.kind) {
+    case Constant::Kind::Int:
+        if (c.i.isSmall()) {
+            emit(Op::LoadConst, addConstant(Value::integer(c.i.smallValue())));
+        } else {
+            program->bigIntegers.push_back(c.i);
+            emit(Op::LoadConst, addConstant(Value::big(uint32_t(program->bigIntegers.size() - 1))));
+        }
+        break;
+    case Constant::Kind::Float: emit(Op::LoadConst, addConstant(Value::real(c.f)));    break;
+    case Constant::Kind::Bool:  emit(Op::LoadConst, addConstant(Value::boolean(!c.i.isZero()))); break;
+    case Constant::Kind::Str:   emit(Op::LoadConst, addString(c.s));                   break;
+    }
+}
+
+// Post-order walk with an explicit stack, like the parser's expression code
+void BytecodeCompiler::compileExpression(const ParseNode* root) {
+    struct Frame {
+        const ParseNode* node;
+        int next;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({ root, 0 });
+
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const ParseNode* node = frame.node;
+        if (!node) {
+            error("Incomplete expression");
+            stack.pop_back();
+            continue;
+        }
+
+        // A constant subtree becomes a single load
+        const Constant* folded = frame.next == 0 ? folder.valueOf(node) : nullptr;
+        if (folded) {
+            emitConstant(*folded);
+            stack.pop_back();
+            continue;
+        }
+
+        Builtin builtin = Builtin::Print;
+        const bool isCall = node->name == "FuncCall";
+        const bool isBuiltin = isCall && isBuiltinCall(node, &builtin);
+
+        // A user function's value goes below its arguments
+        if (frame.next == 0 && isCall && !isBuiltin) {
+            emitLoad(node);
+        }
+        if (frame.next < node->children.size()) {
+            const ParseNode* child = node->children[frame.next++];
+            stack.push_back({ child, 0 });
+            continue;
+        }
+        stack.pop_back();
+
+        const QString& kind = node->name;
+        if (kind == "Identifier") {
+            emitLoad(node);
+        } else if (kind == "Number" || kind == "Hex" || kind == "Binary" || kind == "Octal" ||
+                   kind == "String" || kind == "Bool") {
+            emitLiteral(node);
+        } else if (kind == "Operator") {
+            if (node->value == "+")      emit(Op::Add);
+            else if (node->value == "-") emit(Op::Sub);
+            else if (node->value == "*") emit(Op::Mul);
+            else if (node->value == "/") emit(Op::Div);
+            else if (node->value == "%") emit(Op::Mod);
+            else if (node->value == "**") emit(Op::Pow);
+            else error("Unsupported operator: " + node->value.toStdString());
+        } else if (kind == "CompareOp") {
+            if (node->value == "==")      emit(Op::CmpEq);
+            else if (node->value == "!=") emit(Op::CmpNe);
+            else if (node->value == "<")  emit(Op::CmpLt);
+            else if (node->value == "<=") emit(Op::CmpLe);
+            else if (node->value == ">")  emit(Op::CmpGt);
+            else if (node->value == ">=") emit(Op::CmpGe);
+            else error("Unsupported comparison: " + node->value.toStdString());
+        } else if (isBuiltin) {
+            if (node->value == "range") {
+                error("range() is only supported as a for loop iterable");
+            } else {
+                emit(Op::CallBuiltin, node->children.size(), uint8_t(builtin));
+            }
+        } else if (isCall) {
+            emit(Op::Call, node->children.size());
+        } else {
+            error("Unsupported expression: " + kind.toStdString());
+        }
+    }
+}
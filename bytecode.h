@@ -0,0 +1,149 @@
+// bytecode.h
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "syntaxanalyzer.h"
+#include "constantfolder.h"
+#include "scoperesolver.h"
+
+// Instruction set of the VM in vm.h; one X(...) per opcode so the enum, the
+// name table and the VM's dispatch table stay in the same order
+#define BYTECODE_OPCODES(X) \
+    X(LoadConst)    /* push constants[a] */                                 \
+    X(LoadGlobal)   /* push globals[a] */                                   \
+    X(StoreGlobal)  /* pop into globals[a] */                               \
+    X(LoadLocal)    /* push frame slot a */                                 \
+    X(StoreLocal)   /* pop into frame slot a */                             \
+    X(Pop)          /* drop the top value */                                \
+    X(PopN)         /* drop the top a values */                             \
+    X(Add) X(Sub) X(Mul) X(Div) X(Mod) X(Pow)                               \
+    X(CmpEq) X(CmpNe) X(CmpLt) X(CmpLe) X(CmpGt) X(CmpGe)                   \
+    X(Jump)         /* pc = a */                                            \
+    X(JumpIfFalse)  /* pop; pc = a if falsy */                              \
+    X(ForRange)     /* [cur stop step]: push cur and step it, or pop 3 and pc = a */ \
+    X(Call)         /* [fn arg1..argN], N = a */                            \
+    X(CallBuiltin)  /* builtin b with a arguments */                        \
+    X(Return)       /* return the top value */                              \
+    X(ReturnNone)                                                           \
+    X(Halt)
+
+enum class Op : uint8_t {
+#define BYTECODE_ENUM(name) name,
+    BYTECODE_OPCODES(BYTECODE_ENUM)
+#undef BYTECODE_ENUM
+    Count
+};
+
+const char* opName(Op op);
+
+enum class Builtin : uint8_t { Print, Len, Input };
+
+// One instruction: opcode, a small second operand and a 32-bit operand
+// (constant or slot index, jump target, argument count)
+struct Instr {
+    Op op;
+    uint8_t b = 0;
+    int32_t a = 0;
+};
+
+// Unboxed runtime value. Strings, functions and ints too wide for 64 bits
+// (Big) are indices into the owning tables; nothing is reference counted.
+struct Value {
+    enum class Kind : uint8_t { Unbound, None, Bool, Int, Big, Float, Str, Func };
+    Kind kind = Kind::Unbound;
+    union {
+        int64_t i = 0;
+        double f;
+        uint32_t ref;
+    };
+
+    static Value none()                  { Value v; v.kind = Kind::None; return v; }
+    static Value boolean(bool b)         { Value v; v.kind = Kind::Bool; v.i = b; return v; }
+    static Value integer(int64_t n)      { Value v; v.kind = Kind::Int; v.i = n; return v; }
+    static Value real(double d)          { Value v; v.kind = Kind::Float; v.f = d; return v; }
+    static Value big(uint32_t index)     { Value v; v.kind = Kind::Big; v.ref = index; return v; }
+    static Value string(uint32_t index)  { Value v; v.kind = Kind::Str; v.ref = index; return v; }
+    static Value function(uint32_t index){ Value v; v.kind = Kind::Func; v.ref = index; return v; }
+};
+
+struct FunctionInfo {
+    std::string name;
+    uint32_t entry = 0;     // first instruction
+    uint16_t params = 0;
+    uint16_t locals = 0;    // params first, then other local names
+    std::vector<std::string> localNames;
+};
+
+// Output of the compiler, input of the VM
+struct BytecodeProgram {
+    std::vector<Instr> code;
+    std::vector<int> lines;                 // source line of each instruction
+    std::vector<Value> constants;
+    std::vector<std::string> strings;       // string constants
+    std::vector<Integer> bigIntegers;       // int constants beyond 64 bits
+    std::vector<std::string> globalNames;
+    std::vector<FunctionInfo> functions;
+
+    std::string disassemble() const;
+};
+
+struct CompileError {
+    std::string message;
+    int line;
+};
+
+// Compiles a parse tree from SyntaxAnalyzer to bytecode. Block nodes left
+// unparsed by lazy parsing are materialized as they are reached.
+// Expressions the ConstantFolder proves constant are emitted as a single
+// LoadConst, and variables use the slots the ScopeResolver assigned them.
+class BytecodeCompiler {
+public:
+    // Returns false if any error was reported; `out` is then incomplete
+    bool compile(ParseNode* root, BytecodeProgram& out);
+    const std::vector<CompileError>& getErrors() const { return errors; }
+
+private:
+    struct LoopContext {
+        int32_t continueTarget;
+        std::vector<size_t> breakJumps;   // Jump instructions to patch
+        int32_t stackItems;               // values the loop keeps on the stack
+    };
+
+    BytecodeProgram* program = nullptr;
+    std::vector<CompileError> errors;
+    std::unordered_map<std::string, int32_t> stringConstants;
+    int32_t currentScope = ScopeResolver::MODULE_SCOPE;
+    std::vector<LoopContext> loops;
+    ConstantFolder folder;
+    ScopeResolver resolver;
+    int currentLine = 0;
+
+    size_t emit(Op op, int32_t a = 0, uint8_t b = 0);
+    void patchJump(size_t at);
+    int32_t here() const { return int32_t(program->code.size()); }
+    int32_t addConstant(const Value& v);
+    int32_t addString(const std::string& s);
+    void error(const std::string& message);
+
+    void compileBody(ParseNode* body);
+    void compileStatement(ParseNode* node);
+    void compileAssignment(ParseNode* node);
+    void compileIf(ParseNode* node);
+    void compileWhile(ParseNode* node);
+    void compileFor(ParseNode* node);
+    void compileFuncDef(ParseNode* node);
+    void compileExpression(const ParseNode* node);
+    void emitLoad(const ParseNode* ref);
+    void emitStore(const ParseNode* ref);
+    bool isBuiltinCall(const ParseNode* call, Builtin* id = nullptr) const;
+    void emitLiteral(const ParseNode* node);
+    void emitConstant(const Constant& c);
+
+    void materialize(ParseNode* node);
+};
+
+#endif // BYTECODE_H
@@ -0,0 +1,20 @@
+// cancellation.h
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <atomic>
+
+// Shared between the thread that starts a job and the thread running it.
+// The lexer and the parser poll it (per character and per top-level
+// statement) and stop early once it is set; whatever they return after
+// that is incomplete and must be discarded.
+class CancellationToken {
+public:
+    void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled{ false };
+};
+
+#endif // CANCELLATION_H
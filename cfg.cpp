@@ -0,0 +1,323 @@
+// cfg.cpp
+#include "cfg.h"
+#include <algorithm>
+
+int32_t CfgBuilder::newBlock() {
+    draft.items.emplace_back();
+    draft.opaque.push_back(0);
+    return int32_t(draft.items.size() - 1);
+}
+
+void CfgBuilder::addEdge(int32_t from, int32_t to) {
+    draft.edges.push_back({ from, to });
+}
+
+std::vector<ControlFlowGraph> CfgBuilder::build(ParseNode* root) {
+    std::vector<ControlFlowGraph> graphs;
+    blockErrors.clear();
+    functions.clear();
+
+    graphs.emplace_back();
+    graphs.back().owner = root;
+    buildBody(graphs.back(), root);
+
+    // Function bodies found on the way (including nested ones) get graphs
+    // of their own
+    for (size_t i = 0; i < functions.size(); ++i) {
+        const ParseNode* def = functions[i];
+        ParseNode* body = nullptr;
+        for (int c = 1; c < def->children.size(); ++c) {
+            ParseNode* part = def->children[c];
+            if (part && part->name != "ParamList") body = part;
+        }
+        graphs.emplace_back();
+        graphs.back().owner = def;
+        buildBody(graphs.back(), body);
+    }
+    return graphs;
+}
+
+// Compound statements are state machines on an explicit stack, as in the
+// parser and the folder, so nesting depth is not limited by the native stack
+void CfgBuilder::buildBody(ControlFlowGraph& graph, ParseNode* body) {
+    draft = Draft();
+    newBlock();     // ENTRY
+    newBlock();     // EXIT
+    int32_t current = newBlock();
+    addEdge(ControlFlowGraph::ENTRY, current);
+    loops.clear();
+
+    struct Task {
+        ParseNode* node;
+        int stage = 0;
+        int next = 0;               // next child (blocks) or clause (if chains)
+        int32_t falseFrom = -1;     // condition block whose false edge is still open
+        int32_t join = -1;          // block after the statement
+    };
+    std::vector<Task> stack;
+    stack.push_back({ body });
+
+    // Code after a jump is unreachable; it still gets a block, with no
+    // predecessors
+    auto jumpTo = [&](int32_t target) {
+        addEdge(current, target);
+        current = newBlock();
+    };
+
+    while (!stack.empty()) {
+        Task& task = stack.back();
+        ParseNode* node = task.node;
+        if (!node) {
+            stack.pop_back();
+            continue;
+        }
+        const QString& kind = node->name;
+        auto child = [node](int i) { return node->children.value(i); };
+
+        if (kind == "Program" || kind == "Block") {
+            if (task.stage == 0) {
+                task.stage = 1;
+                if (node->lazy && materializeBlocks) {
+                    SyntaxAnalyzer::materialize(node, &blockErrors);
+                }
+                if (node->lazy) {
+                    const int32_t opaque = newBlock();
+                    draft.items[opaque].push_back(node);
+                    draft.opaque[opaque] = 1;
+                    addEdge(current, opaque);
+                    current = newBlock();
+                    addEdge(opaque, current);
+                    stack.pop_back();
+                    continue;
+                }
+            }
+            if (task.next < node->children.size()) {
+                ParseNode* stmt = node->children[task.next++];
+                stack.push_back({ stmt });
+            } else {
+                stack.pop_back();
+            }
+        } else if (kind == "IfStmt") {
+            if (task.stage == 0) {
+                task.stage = 1;
+                task.next = 2;
+                task.join = newBlock();
+                draft.items[current].push_back(child(0));
+                task.falseFrom = current;
+                const int32_t then = newBlock();
+                addEdge(current, then);
+                current = then;
+                stack.push_back({ child(1) });
+                continue;
+            }
+
+            // A clause body has finished
+            addEdge(current, task.join);
+            if (task.next < node->children.size()) {
+                ParseNode* clause = node->children[task.next++];
+                if (clause && clause->name == "Elif") {
+                    const int32_t test = newBlock();
+                    addEdge(task.falseFrom, test);
+                    draft.items[test].push_back(clause->children.value(0));
+                    task.falseFrom = test;
+                    const int32_t then = newBlock();
+                    addEdge(test, then);
+                    current = then;
+                    stack.push_back({ clause->children.value(1) });
+                } else {
+                    const int32_t otherwise = newBlock();
+                    if (task.falseFrom >= 0) addEdge(task.falseFrom, otherwise);
+                    task.falseFrom = -1;
+                    current = otherwise;
+                    stack.push_back({ clause ? clause->children.value(0) : nullptr });
+                }
+                continue;
+            }
+            if (task.falseFrom >= 0) addEdge(task.falseFrom, task.join);
+            current = task.join;
+            stack.pop_back();
+        } else if (kind == "WhileStmt" || kind == "ForStmt") {
+            const bool isFor = kind == "ForStmt";
+            if (task.stage == 0) {
+                task.stage = 1;
+                if (isFor) draft.items[current].push_back(child(1));
+                const int32_t header = newBlock();
+                addEdge(current, header);
+                draft.items[header].push_back(isFor ? node : child(0));
+                const int32_t loopBody = newBlock();
+                task.join = newBlock();
+                addEdge(header, loopBody);
+                addEdge(header, task.join);
+                task.falseFrom = header;
+                loops.push_back({ header, task.join });
+                current = loopBody;
+                stack.push_back({ child(isFor ? 2 : 1) });
+            } else {
+                addEdge(current, task.falseFrom);
+                loops.pop_back();
+                current = task.join;
+                stack.pop_back();
+            }
+        } else if (kind == "BreakStmt" || kind == "ContinueStmt") {
+            stack.pop_back();
+            if (loops.empty()) continue;    // reported by the compiler
+            jumpTo(kind == "BreakStmt" ? loops.back().breakTarget : loops.back().continueTarget);
+        } else if (kind == "ReturnStmt") {
+            stack.pop_back();
+            draft.items[current].push_back(node);
+            jumpTo(ControlFlowGraph::EXIT);
+        } else if (kind == "FuncDef") {
+            stack.pop_back();
+            draft.items[current].push_back(node);
+            functions.push_back(node);
+        } else if (kind == "Assignment" || kind == "ExprStmt" || kind == "FuncCall") {
+            stack.pop_back();
+            draft.items[current].push_back(node);
+        } else {
+            // pass, and nodes left by error recovery
+            stack.pop_back();
+        }
+    }
+
+    graph.fallthrough = current;
+    addEdge(current, ControlFlowGraph::EXIT);
+    pack(graph);
+    graph.computeDominators();
+}
+
+// Counting sort of the edges by source, then by target; edges keep their
+// order within a block, so a condition's successors stay [true, false]
+void CfgBuilder::pack(ControlFlowGraph& graph) {
+    const size_t count = draft.items.size();
+    graph.itemStart.assign(count + 1, 0);
+    graph.succStart.assign(count + 1, 0);
+    graph.predStart.assign(count + 1, 0);
+    for (size_t b = 0; b < count; ++b) {
+        graph.itemStart[b + 1] = graph.itemStart[b] + uint32_t(draft.items[b].size());
+    }
+    for (const auto& edge : draft.edges) {
+        ++graph.succStart[edge.first + 1];
+        ++graph.predStart[edge.second + 1];
+    }
+    for (size_t b = 0; b < count; ++b) {
+        graph.succStart[b + 1] += graph.succStart[b];
+        graph.predStart[b + 1] += graph.predStart[b];
+    }
+
+    graph.itemNodes.clear();
+    graph.itemNodes.reserve(graph.itemStart[count]);
+    for (const auto& items : draft.items) {
+        graph.itemNodes.insert(graph.itemNodes.end(), items.begin(), items.end());
+    }
+    graph.succ.assign(draft.edges.size(), 0);
+    graph.pred.assign(draft.edges.size(), 0);
+    std::vector<uint32_t> succFill(graph.succStart.begin(), graph.succStart.end() - 1);
+    std::vector<uint32_t> predFill(graph.predStart.begin(), graph.predStart.end() - 1);
+    for (const auto& edge : draft.edges) {
+        graph.succ[succFill[edge.first]++] = edge.second;
+        graph.pred[predFill[edge.second]++] = edge.first;
+    }
+    graph.opaqueBlocks = std::move(draft.opaque);
+    draft = Draft();
+}
+
+//——— Dominators ———
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm": iterate
+// over the blocks in reverse postorder, intersecting the dominators of the
+// processed predecessors by walking up the tree by postorder number. The
+// graphs here are reducible, so two passes are almost always enough.
+void ControlFlowGraph::computeDominators() {
+    const int32_t count = blockCount();
+    idom.assign(count, -1);
+    rpo.clear();
+
+    // Postorder by an explicit depth-first walk
+    std::vector<int32_t> postNumber(count, -1);
+    std::vector<uint8_t> seen(count, 0);
+    struct Visit {
+        int32_t block;
+        uint32_t next;
+    };
+    std::vector<Visit> stack;
+    stack.push_back({ ENTRY, succStart[ENTRY] });
+    seen[ENTRY] = 1;
+    while (!stack.empty()) {
+        Visit& visit = stack.back();
+        if (visit.next < succStart[visit.block + 1]) {
+            const int32_t next = succ[visit.next++];
+            if (!seen[next]) {
+                seen[next] = 1;
+                stack.push_back({ next, succStart[next] });
+            }
+            continue;
+        }
+        postNumber[visit.block] = int32_t(rpo.size());
+        rpo.push_back(visit.block);
+        stack.pop_back();
+    }
+    std::reverse(rpo.begin(), rpo.end());
+
+    auto intersect = [&](int32_t a, int32_t b) {
+        while (a != b) {
+            while (postNumber[a] < postNumber[b]) a = idom[a];
+            while (postNumber[b] < postNumber[a]) b = idom[b];
+        }
+        return a;
+    };
+
+    idom[ENTRY] = ENTRY;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < rpo.size(); ++i) {
+            const int32_t block = rpo[i];
+            int32_t dominator = -1;
+            for (int32_t p : predecessors(block)) {
+                if (idom[p] < 0) continue;      // unreachable, or not processed yet
+                dominator = dominator < 0 ? p : intersect(p, dominator);
+            }
+            if (dominator != idom[block]) {
+                idom[block] = dominator;
+                changed = true;
+            }
+        }
+    }
+
+    // Number the dominator tree so a dominance query is an interval test
+    std::vector<uint32_t> childStart(count + 1, 0);
+    for (int32_t block : rpo) {
+        if (block != ENTRY) ++childStart[idom[block] + 1];
+    }
+    for (int32_t b = 0; b < count; ++b) {
+        childStart[b + 1] += childStart[b];
+    }
+    std::vector<int32_t> children(childStart[count]);
+    std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+    for (int32_t block : rpo) {
+        if (block != ENTRY) children[fill[idom[block]]++] = block;
+    }
+
+    domEnter.assign(count, 0);
+    domLeave.assign(count, 0);
+    uint32_t clock = 0;
+    stack.clear();
+    stack.push_back({ ENTRY, childStart[ENTRY] });
+    domEnter[ENTRY] = clock++;
+    while (!stack.empty()) {
+        Visit& visit = stack.back();
+        if (visit.next < childStart[visit.block + 1]) {
+            const int32_t child = children[visit.next++];
+            domEnter[child] = clock++;
+            stack.push_back({ child, childStart[child] });
+            continue;
+        }
+        domLeave[visit.block] = clock++;
+        stack.pop_back();
+    }
+}
+
+bool ControlFlowGraph::dominates(int32_t dominator, int32_t block) const {
+    if (!isReachable(dominator) || !isReachable(block)) return false;
+    return domEnter[dominator] <= domEnter[block] && domLeave[block] <= domLeave[dominator];
+}
@@ -0,0 +1,124 @@
+// cfg.h
+#ifndef CFG_H
+#define CFG_H
+
+#include <cstdint>
+#include <vector>
+#include "syntaxanalyzer.h"
+
+// View of a contiguous run of one of the graph's flat arrays
+template <typename T>
+struct IndexRange {
+    const T* first = nullptr;
+    const T* last = nullptr;
+
+    const T* begin() const { return first; }
+    const T* end() const { return last; }
+    size_t size() const { return size_t(last - first); }
+    bool empty() const { return first == last; }
+    const T& operator[](size_t i) const { return first[i]; }
+};
+
+// Control flow of the module or of one function body.
+//
+// Blocks are numbered densely and stored compressed: the items, successor
+// and predecessor lists of all blocks live in three flat arrays, with an
+// offset per block into each, so a graph is a handful of allocations no
+// matter how many blocks it has.
+//
+// Items of a block are, in execution order: simple statements (Assignment,
+// ExprStmt, FuncCall, ReturnStmt, FuncDef, which binds the function's
+// name), the conditions of if/elif and while (always a block's last item;
+// successors are then [true, false]), for-loop iterables, and ForStmt
+// nodes, which stand for binding the targets to the next element (in the
+// loop header, successors [body, exit]).
+class ControlFlowGraph {
+public:
+    static constexpr int32_t ENTRY = 0;
+    static constexpr int32_t EXIT = 1;      // empty; reached by return and falling off the end
+
+    const ParseNode* owner = nullptr;       // FuncDef, or the program root
+    int32_t fallthrough = -1;               // block that falls off the end of the body
+
+    int32_t blockCount() const { return int32_t(opaqueBlocks.size()); }
+    IndexRange<const ParseNode*> items(int32_t block) const { return range(itemNodes, itemStart, block); }
+    IndexRange<int32_t> successors(int32_t block) const { return range(succ, succStart, block); }
+    IndexRange<int32_t> predecessors(int32_t block) const { return range(pred, predStart, block); }
+    // Holds one unparsed Block; may bind any name
+    bool isOpaque(int32_t block) const { return opaqueBlocks[block] != 0; }
+
+    //——— Dominators ———
+
+    // Blocks not reachable from ENTRY (code after a jump) have no dominator
+    bool isReachable(int32_t block) const { return idom[block] >= 0; }
+    // ENTRY is its own immediate dominator
+    int32_t immediateDominator(int32_t block) const { return idom[block]; }
+    // Whether every path from ENTRY to `block` passes through `dominator`
+    // (a block dominates itself); constant time
+    bool dominates(int32_t dominator, int32_t block) const;
+    // Reachable blocks, each after all of its dominators
+    const std::vector<int32_t>& reversePostorder() const { return rpo; }
+
+private:
+    friend class CfgBuilder;
+
+    std::vector<const ParseNode*> itemNodes;
+    std::vector<int32_t> succ;
+    std::vector<int32_t> pred;
+    std::vector<uint32_t> itemStart;        // blockCount() + 1 offsets into each array
+    std::vector<uint32_t> succStart;
+    std::vector<uint32_t> predStart;
+    std::vector<uint8_t> opaqueBlocks;
+
+    std::vector<int32_t> idom;
+    std::vector<int32_t> rpo;
+    std::vector<uint32_t> domEnter;         // dominator tree interval of each block
+    std::vector<uint32_t> domLeave;
+
+    template <typename T>
+    static IndexRange<T> range(const std::vector<T>& values, const std::vector<uint32_t>& start, int32_t block) {
+        return { values.data() + start[block], values.data() + start[block + 1] };
+    }
+
+    void computeDominators();
+};
+
+// Lowers a parse tree to one graph for the module and one per FuncDef
+class CfgBuilder {
+public:
+    // Parse unparsed Block nodes of a lazily parsed tree as they are
+    // reached; otherwise each one becomes an opaque block
+    void setMaterializeBlocks(bool enabled) { materializeBlocks = enabled; }
+
+    // Module graph first, then functions in the order they are found
+    std::vector<ControlFlowGraph> build(ParseNode* root);
+
+    // Syntax errors found in blocks materialized while building
+    const std::vector<SyntaxError>& getBlockErrors() const { return blockErrors; }
+
+private:
+    struct LoopTargets {
+        int32_t continueTarget;
+        int32_t breakTarget;
+    };
+
+    // A graph under construction; edges are packed per block at the end
+    struct Draft {
+        std::vector<std::vector<const ParseNode*>> items;
+        std::vector<std::pair<int32_t, int32_t>> edges;
+        std::vector<uint8_t> opaque;
+    };
+
+    bool materializeBlocks = false;
+    std::vector<SyntaxError> blockErrors;
+    Draft draft;
+    std::vector<LoopTargets> loops;
+    std::vector<const ParseNode*> functions;    // FuncDefs waiting for a graph
+
+    int32_t newBlock();
+    void addEdge(int32_t from, int32_t to);
+    void buildBody(ControlFlowGraph& graph, ParseNode* body);
+    void pack(ControlFlowGraph& graph);
+};
+
+#endif // CFG_H
@@ -0,0 +1,747 @@
+// constantfolder.cpp
+#include "constantfolder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// Longest string a folded repetition may produce; longer ones are left
+// for run time rather than stored as constants
+const size_t MAX_FOLDED_STRING = 4096;
+
+bool isIntegral(const Constant& c) { return c.kind == Constant::Kind::Int || c.kind == Constant::Kind::Bool; }
+bool isNumeric(const Constant& c)  { return isIntegral(c) || c.kind == Constant::Kind::Float; }
+Numeric toNumeric(const Constant& c) { return c.kind == Constant::Kind::Float ? Numeric::real(c.f) : Numeric::integer(c.i); }
+
+bool isLiteral(const QString& kind) {
+    return kind == "Number" || kind == "Hex" || kind == "Binary" || kind == "Octal" ||
+           kind == "String" || kind == "Bool";
+}
+
+// Literal text of a string token without its quotes, with the common
+// escape sequences resolved
+std::string unquote(const std::string& lexeme) {
+    std::string body = lexeme;
+    if (body.size() >= 6 && (body.compare(0, 3, "\"\"\"") == 0 || body.compare(0, 3, "'''") == 0)) {
+        body = body.substr(3, body.size() - 6);
+    } else if (body.size() >= 2 && (body.front() == '"' || body.front() == '\'') && body.back() == body.front()) {
+        body = body.substr(1, body.size() - 2);
+    }
+
+    std::string out;
+    out.reserve(body.size());
+    for (size_t i = 0; i < body.size(); ++i) {
+        if (body[i] != '\\' || i + 1 == body.size()) {
+            out += body[i];
+            continue;
+        }
+        char c = body[++i];
+        switch (c) {
+        case 'n':  out += '\n'; break;
+        case 't':  out += '\t'; break;
+        case 'r':  out += '\r'; break;
+        case '0':  out += '\0'; break;
+        case '\\': out += '\\'; break;
+        case '\'': out += '\''; break;
+        case '"':  out += '"';  break;
+        default:   out += '\\'; out += c; break;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+//——— Constant ———
+
+const char* Constant::typeName() const {
+    switch (kind) {
+    case Kind::Int:   return "int";
+    case Kind::Float: return "float";
+    case Kind::Str:   return "str";
+    default:          return "bool";
+    }
+}
+
+std::string Constant::repr() const {
+    switch (kind) {
+    case Kind::Int:   return i.toString();
+    case Kind::Float: return formatFloat(f);
+    case Kind::Bool:  return i.isZero() ? "False" : "True";
+    default:          break;
+    }
+
+    // Single quotes unless the text contains one and no double quote
+    const char quote = s.find('\'') != std::string::npos && s.find('"') == std::string::npos ? '"' : '\'';
+    std::string out(1, quote);
+    for (unsigned char c : s) {
+        switch (c) {
+        case '\n': out += "\\n";  break;
+        case '\t': out += "\\t";  break;
+        case '\r': out += "\\r";  break;
+        case '\\': out += "\\\\"; break;
+        default:
+            if (c == quote) {
+                out += '\\';
+                out += char(c);
+            } else if (c < 0x20 || c == 0x7F) {
+                char hex[5];
+                std::snprintf(hex, sizeof(hex), "\\x%02x", c);
+                out += hex;
+            } else {
+                out += char(c);
+            }
+        }
+    }
+    out += quote;
+    return out;
+}
+
+bool Constant::truthy() const {
+    switch (kind) {
+    case Kind::Float: return f != 0.0;
+    case Kind::Str:   return !s.empty();
+    default:          return !i.isZero();
+    }
+}
+
+bool Constant::sameAs(const Constant& other) const {
+    if (kind != other.kind) return false;
+    switch (kind) {
+    case Kind::Float: return f == other.f && std::signbit(f) == std::signbit(other.f);
+    case Kind::Str:   return s == other.s;
+    default:          return Integer::compare(i, other.i) == 0;
+    }
+}
+
+//——— Literals ———
+
+bool ConstantFolder::literalValue(const ParseNode* node, Constant& out, std::string& error) {
+    const std::string text = node->value.toStdString();
+
+    if (node->name == "String") {
+        out = Constant::string(unquote(text));
+        return true;
+    }
+    if (node->name == "Bool") {
+        out = Constant::boolean(text == "True");
+        return true;
+    }
+
+    std::string digits;
+    for (char c : text) {
+        if (c != '_') digits += c;
+    }
+
+    int base = 10;
+    size_t skip = 0;
+    if (node->name == "Hex")         { base = 16; skip = 2; }
+    else if (node->name == "Binary") { base = 2;  skip = 2; }
+    else if (node->name == "Octal")  { base = 8;  skip = 2; }
+
+    if (base == 10 && digits.find_first_of("jJ") != std::string::npos) {
+        error = "Complex numbers are not supported: " + text;
+        return false;
+    }
+    if (base == 10 && digits.find_first_of(".eE") != std::string::npos) {
+        out = Constant::real(std::strtod(digits.c_str(), nullptr));
+        return true;
+    }
+
+    Integer value;
+    if (!Integer::parse(digits.substr(std::min(skip, digits.size())), base, value)) {
+        error = "Invalid integer literal: " + text;
+        return false;
+    }
+    out = Constant::integer(std::move(value));
+    return true;
+}
+
+//——— Expressions ———
+
+bool ConstantFolder::callsBuiltin(const ParseNode* call) const {
+    if (!resolver) return true;
+    const Slot* slot = resolver->slotOf(call);
+    return slot && slot->scope == ScopeResolver::BUILTIN_SCOPE;
+}
+
+void ConstantFolder::warn(const std::string& message) {
+    diagnostics.push_back({ message, currentLine, currentColumn });
+}
+
+// Same semantics as the VM; operations that would fail at run time are
+// not folded, and those that always fail are reported
+std::optional<Constant> ConstantFolder::applyOperator(const std::string& op, const Constant& l, const Constant& r) {
+    if (op == "==" || op == "!=" || op == "<" || op == "<=" || op == ">" || op == ">=") {
+        int order = 0;
+        bool ordered = true;
+        if (isNumeric(l) && isNumeric(r)) {
+            bool unordered = false;
+            order = compareNumeric(toNumeric(l), toNumeric(r), unordered);
+            if (unordered) return Constant::boolean(op == "!=");
+        } else if (l.kind == Constant::Kind::Str && r.kind == Constant::Kind::Str) {
+            const int c = l.s.compare(r.s);
+            order = (c > 0) - (c < 0);
+        } else {
+            order = 1;
+            ordered = false;
+        }
+
+        if (op == "==") return Constant::boolean(order == 0);
+        if (op == "!=") return Constant::boolean(order != 0);
+        if (!ordered) {
+            warn("'" + op + "' not supported between instances of '" + l.typeName() + "' and '" + r.typeName() + "'");
+            return std::nullopt;
+        }
+        if (op == "<")  return Constant::boolean(order < 0);
+        if (op == "<=") return Constant::boolean(order <= 0);
+        if (op == ">")  return Constant::boolean(order > 0);
+        if (op == ">=") return Constant::boolean(order >= 0);
+        return std::nullopt;
+    }
+
+    if (isNumeric(l) && isNumeric(r)) {
+        ArithOp arith;
+        if (op == "+")       arith = ArithOp::Add;
+        else if (op == "-")  arith = ArithOp::Sub;
+        else if (op == "*")  arith = ArithOp::Mul;
+        else if (op == "/")  arith = ArithOp::Div;
+        else if (op == "%")  arith = ArithOp::Mod;
+        else if (op == "**") arith = ArithOp::Pow;
+        else return std::nullopt;
+
+        Numeric result;
+        std::string error;
+        if (!applyArithmetic(arith, toNumeric(l), toNumeric(r), result, error)) {
+            warn(error);
+            return std::nullopt;
+        }
+        return result.isFloat ? Constant::real(result.f) : Constant::integer(result.i);
+    }
+
+    if (op == "+" && l.kind == Constant::Kind::Str && r.kind == Constant::Kind::Str) {
+        if (l.s.size() + r.s.size() > MAX_FOLDED_STRING) return std::nullopt;
+        return Constant::string(l.s + r.s);
+    }
+    if (op == "*" && ((l.kind == Constant::Kind::Str && isIntegral(r)) || (isIntegral(l) && r.kind == Constant::Kind::Str))) {
+        const std::string& text = l.kind == Constant::Kind::Str ? l.s : r.s;
+        const Integer& times = l.kind == Constant::Kind::Str ? r.i : l.i;
+        if (!times.isSmall()) return std::nullopt;
+        const int64_t count = times.smallValue();
+        if (count <= 0 || text.empty()) return Constant::string(std::string());
+        // Divided rather than multiplied, so a huge count cannot wrap past the check
+        if (uint64_t(count) > MAX_FOLDED_STRING / text.size()) return std::nullopt;
+        std::string repeated;
+        repeated.reserve(text.size() * size_t(count));
+        for (int64_t n = 0; n < count; ++n) repeated.append(text);
+        return Constant::string(std::move(repeated));
+    }
+
+    warn("unsupported operand type(s) for " + op + ": '" + l.typeName() + "' and '" + r.typeName() + "'");
+    return std::nullopt;
+}
+
+// Post-order walk with an explicit stack; operand values wait on `values`
+std::optional<Constant> ConstantFolder::evaluate(const ParseNode* expr) {
+    struct Frame {
+        const ParseNode* node;
+        int next;
+    };
+    std::vector<Frame> stack;
+    std::vector<std::optional<Constant>> values;
+    stack.push_back({ expr, 0 });
+
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const ParseNode* node = frame.node;
+        if (node && frame.next < node->children.size()) {
+            const ParseNode* child = node->children[frame.next++];
+            stack.push_back({ child, 0 });
+            continue;
+        }
+        stack.pop_back();
+
+        std::optional<Constant> result;
+        const int arity = node ? int(node->children.size()) : 0;
+        if (!node) {
+            // incomplete expression
+        } else if (isLiteral(node->name)) {
+            Constant c;
+            std::string error;
+            if (literalValue(node, c, error)) {
+                result = std::move(c);
+            } else {
+                warn(error);
+            }
+        } else if (node->name == "Identifier") {
+            auto it = env.find(node->value.toStdString());
+            if (it != env.end()) result = it->second;
+        } else if ((node->name == "Operator" || node->name == "CompareOp") && arity == 2) {
+            const auto& l = values[values.size() - 2];
+            const auto& r = values[values.size() - 1];
+            if (l && r) result = applyOperator(node->value.toStdString(), *l, *r);
+        } else if (node->name == "FuncCall" && node->value == "len" && arity == 1 && callsBuiltin(node)) {
+            const auto& arg = values.back();
+            if (arg && arg->kind == Constant::Kind::Str) result = Constant::integer(int64_t(arg->s.size()));
+        }
+
+        values.resize(values.size() - arity);
+        if (result) folded[node] = *result;
+        values.push_back(std::move(result));
+    }
+    return values.empty() ? std::nullopt : values.back();
+}
+
+const Constant* ConstantFolder::valueOf(const ParseNode* node) const {
+    auto it = folded.find(node);
+    return it != folded.end() ? &it->second : nullptr;
+}
+
+//——— Environments ———
+
+ConstantFolder::Env ConstantFolder::merge(const Env& a, const Env& b) {
+    Env result;
+    for (const auto& entry : a) {
+        auto other = b.find(entry.first);
+        const bool agree = other != b.end() && entry.second && other->second &&
+                           entry.second->sameAs(*other->second);
+        result.emplace(entry.first, agree ? entry.second : std::nullopt);
+    }
+    for (const auto& entry : b) {
+        result.emplace(entry.first, std::nullopt);  // no-op where `a` had it
+    }
+    return result;
+}
+
+void ConstantFolder::forgetAll() {
+    for (auto& entry : env) {
+        entry.second.reset();
+    }
+}
+
+bool ConstantFolder::materialize(ParseNode* node) {
+    if (!node->lazy) return true;
+    if (!materializeBlocks) return false;
+    SyntaxAnalyzer::materialize(node, &blockErrors);
+    return true;
+}
+
+// A loop body may run any number of times, so nothing it assigns is
+// constant at its head or after it
+void ConstantFolder::forgetAssigned(ParseNode* body) {
+    std::vector<ParseNode*> pending;
+    if (body) pending.push_back(body);
+    while (!pending.empty()) {
+        ParseNode* node = pending.back();
+        pending.pop_back();
+        if (!node) continue;
+        if (!materialize(node)) {
+            forgetAll();
+            continue;
+        }
+
+        if (node->name == "Assignment" && !node->children.isEmpty() && node->children[0]) {
+            env[node->children[0]->value.toStdString()].reset();
+        } else if (node->name == "ForStmt" && !node->children.isEmpty() && node->children[0]) {
+            for (ParseNode* target : node->children[0]->children) {
+                if (target) env[target->value.toStdString()].reset();
+            }
+        } else if (node->name == "FuncDef") {
+            if (!node->children.isEmpty() && node->children[0]) env[node->children[0]->value.toStdString()].reset();
+            continue;
+        }
+
+        if (node->name == "Block" || node->name == "IfStmt" || node->name == "Elif" ||
+            node->name == "Else" || node->name == "WhileStmt" || node->name == "ForStmt") {
+            for (ParseNode* child : node->children) {
+                pending.push_back(child);
+            }
+        }
+    }
+}
+
+//——— Statements ———
+
+void ConstantFolder::run(ParseNode* root) {
+    env.clear();
+    functionLocals.clear();
+    folded.clear();
+    diagnostics.clear();
+    blockErrors.clear();
+    currentLine = currentColumn = 0;
+    evaluatedStatements = reusedStatements = 0;
+
+    unreachable.clear();
+    if (graphs) {
+        for (const ControlFlowGraph& graph : *graphs) {
+            for (int32_t b = 0; b < graph.blockCount(); ++b) {
+                if (graph.isReachable(b)) continue;
+                for (const ParseNode* item : graph.items(b)) {
+                    unreachable.insert(item);
+                }
+            }
+        }
+    }
+
+    EffectMap previous;
+    previous.swap(effects);
+    if (!memoized || !root || root->name != "Program" || root->lazy) {
+        execute(root);
+        return;
+    }
+    for (ParseNode* stmt : root->children) {
+        runStatement(stmt, previous);
+    }
+}
+
+void ConstantFolder::execute(ParseNode* root) {
+    // Compound statements are state machines on an explicit stack, like the
+    // parser, so deeply nested programs do not exhaust the native stack
+    struct Task {
+        Task(ParseNode* node) : node(node) {}
+        ParseNode* node;
+        int stage = 0;
+        int next = 0;           // next child (blocks) or clause (if chains)
+        bool decided = false;   // an if chain has taken a branch that always runs
+        Env saved;
+        Env merged;
+        bool haveMerged = false;
+    };
+    std::vector<Task> stack;
+    stack.push_back({ root });
+
+    while (!stack.empty()) {
+        Task& task = stack.back();
+        ParseNode* node = task.node;
+        if (!node) {
+            stack.pop_back();
+            continue;
+        }
+        if (node->line) {
+            currentLine = node->line;
+            currentColumn = node->column;
+        }
+        const QString& kind = node->name;
+        auto child = [node](int i) { return node->children.value(i); };
+        if (task.stage == 0 && isUnreachable(node)) {
+            stack.pop_back();
+            continue;
+        }
+
+        if (kind == "Program" || kind == "Block") {
+            if (task.stage == 0) {
+                task.stage = 1;
+                if (!materialize(node)) {
+                    forgetAll();
+                    stack.pop_back();
+                    continue;
+                }
+            }
+            if (task.next < node->children.size()) {
+                ParseNode* stmt = node->children[task.next++];
+                stack.push_back({ stmt });
+            } else {
+                stack.pop_back();
+            }
+        } else if (kind == "Assignment") {
+            stack.pop_back();
+            if (node->children.size() < 2 || !node->children[0]) continue;
+            const std::string target = node->children[0]->value.toStdString();
+            std::optional<Constant> value = evaluate(node->children[1]);
+            if (node->value != "=") {
+                auto current = env.find(target);
+                std::optional<Constant> result;
+                if (value && current != env.end() && current->second) {
+                    // "+=" applies "+", and so on
+                    const std::string op = node->value.toStdString();
+                    result = applyOperator(op.substr(0, op.size() - 1), *current->second, *value);
+                }
+                value = result;
+            }
+            env[target] = value;
+        } else if (kind == "ExprStmt" || kind == "ReturnStmt") {
+            stack.pop_back();
+            if (!node->children.isEmpty()) evaluate(node->children[0]);
+        } else if (kind == "FuncCall") {
+            stack.pop_back();
+            evaluate(node);
+        } else if (kind == "IfStmt") {
+            // A clause body has finished
+            if (task.stage == 1) {
+                task.merged = task.haveMerged ? merge(task.merged, env) : env;
+                task.haveMerged = true;
+            }
+            if (task.stage == 0) {
+                task.saved = env;
+                evaluate(child(0));
+            }
+            task.stage = 1;
+
+            // Find the next clause that can run; conditions are evaluated
+            // with the state before the if, since they bind no names
+            ParseNode* body = nullptr;
+            while (!body && !task.decided && (task.next == 0 || task.next < node->children.size())) {
+                env = task.saved;
+                if (task.next == 0) {
+                    task.next = 2;
+                    const Constant* cond = valueOf(child(0));
+                    if (cond && !cond->truthy()) continue;
+                    task.decided = cond != nullptr;
+                    body = child(1);
+                } else {
+                    ParseNode* clause = node->children[task.next++];
+                    if (!clause) continue;
+                    if (clause->name == "Elif") {
+                        std::optional<Constant> cond = evaluate(clause->children.value(0));
+                        if (cond && !cond->truthy()) continue;
+                        task.decided = cond.has_value();
+                        body = clause->children.value(1);
+                    } else {
+                        task.decided = true;
+                        body = clause->children.value(0);
+                    }
+                }
+                // An empty body still counts as a path through the chain
+                if (!body) {
+                    task.merged = task.haveMerged ? merge(task.merged, env) : env;
+                    task.haveMerged = true;
+                }
+            }
+            if (body) {
+                stack.push_back({ body });
+                continue;
+            }
+
+            // No clause ran: the state before the if falls through
+            if (!task.decided) {
+                task.merged = task.haveMerged ? merge(task.merged, task.saved) : task.saved;
+            }
+            env = std::move(task.merged);
+            stack.pop_back();
+        } else if (kind == "WhileStmt") {
+            if (task.stage == 0) {
+                task.stage = 1;
+                forgetAssigned(child(1));
+                std::optional<Constant> cond = evaluate(child(0));
+                if (cond && !cond->truthy()) {
+                    stack.pop_back();
+                    continue;
+                }
+                task.saved = env;
+                stack.push_back({ child(1) });
+            } else {
+                env = std::move(task.saved);
+                stack.pop_back();
+            }
+        } else if (kind == "ForStmt") {
+            if (task.stage == 0) {
+                task.stage = 1;
+                evaluate(child(1));
+                if (ParseNode* targets = child(0)) {
+                    for (ParseNode* target : targets->children) {
+                        if (target) env[target->value.toStdString()].reset();
+                    }
+                }
+                forgetAssigned(child(2));
+                task.saved = env;
+                stack.push_back({ child(2) });
+            } else {
+                env = std::move(task.saved);
+                stack.pop_back();
+            }
+        } else if (kind == "FuncDef") {
+            if (task.stage == 0) {
+                task.stage = 1;
+                ParseNode* name = child(0);
+                ParseNode* body = nullptr;
+                ParseNode* params = nullptr;
+                for (int i = 1; i < node->children.size(); ++i) {
+                    ParseNode* part = node->children[i];
+                    if (part && part->name == "ParamList") params = part;
+                    else body = part;
+                }
+                if (name) env[name->value.toStdString()].reset();
+
+                // The body runs later, with nothing known but its own names
+                task.saved = std::move(env);
+                env = Env();
+                if (params) {
+                    for (ParseNode* param : params->children) {
+                        if (param) env[param->value.toStdString()].reset();
+                    }
+                }
+                stack.push_back({ body });
+            } else {
+                mergeFunctionLocals(env);
+                if (functionEnds) functionEnds->push_back(env);
+                env = std::move(task.saved);
+                stack.pop_back();
+            }
+        } else {
+            // pass, break, continue, and nodes left by error recovery
+            stack.pop_back();
+        }
+    }
+}
+
+// A statement is placed in the graph by its first item: the condition of an
+// if or while, the iterable of a for, or the statement itself
+bool ConstantFolder::isUnreachable(const ParseNode* stmt) const {
+    if (unreachable.empty()) return false;
+    const ParseNode* entry = stmt;
+    if (stmt->name == "IfStmt" || stmt->name == "WhileStmt") {
+        entry = stmt->children.value(0);
+    } else if (stmt->name == "ForStmt") {
+        entry = stmt->children.value(1);
+    }
+    return entry && unreachable.count(entry);
+}
+
+void ConstantFolder::mergeFunctionLocals(const Env& locals) {
+    for (const auto& entry : locals) {
+        auto it = functionLocals.find(entry.first);
+        if (it == functionLocals.end()) {
+            functionLocals.emplace(entry.first, entry.second);
+        } else if (!(it->second && entry.second && it->second->sameAs(*entry.second))) {
+            it->second.reset();
+        }
+    }
+}
+
+//——— Memoized runs ———
+
+ConstantFolder::Binding ConstantFolder::lookup(const std::string& name) const {
+    auto it = env.find(name);
+    return it != env.end() ? it->second : std::nullopt;
+}
+
+// An unbound name and one that is not constant fold the same way
+bool ConstantFolder::sameBinding(const Binding& a, const Binding& b) {
+    if (!a || !b) return !a && !b;
+    return a->sameAs(*b);
+}
+
+ConstantFolder::Statement ConstantFolder::describe(const ParseNode* stmt) const {
+    Statement info;
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const std::string& text) {
+        for (unsigned char c : text) {
+            hash = (hash ^ c) * 1099511628211ull;
+        }
+        hash = (hash ^ 0xFF) * 1099511628211ull;
+    };
+    auto mixNumber = [&hash](uint64_t n) {
+        hash = (hash ^ n) * 1099511628211ull;
+    };
+
+    std::vector<std::string> names;
+    std::vector<const ParseNode*> pending{ stmt };
+    while (!pending.empty()) {
+        const ParseNode* node = pending.back();
+        pending.pop_back();
+        info.nodes.push_back(node);
+        if (!node) {
+            mixNumber(0);
+            continue;
+        }
+        if (node->lazy || isUnreachable(node)) info.reusable = false;
+        mix(node->name.toStdString());
+        mix(node->value.toStdString());
+        mixNumber(uint64_t(node->children.size()));
+        if (node->line) mixNumber(uint64_t(node->line - stmt->line) << 1 | 1);
+        if (node->name == "FuncCall") mixNumber(callsBuiltin(node) ? 2 : 4);
+        if (node->name == "Identifier") names.push_back(node->value.toStdString());
+        for (int i = node->children.size() - 1; i >= 0; --i) {
+            pending.push_back(node->children[i]);
+        }
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    info.names = std::move(names);
+    info.fingerprint = hash;
+    return info;
+}
+
+void ConstantFolder::runStatement(ParseNode* stmt, EffectMap& previous) {
+    if (!stmt) return;
+    const Statement info = describe(stmt);
+
+    // Same text, and every name it mentions holds what it held last time
+    if (info.reusable) {
+        auto candidates = previous.equal_range(info.fingerprint);
+        for (auto it = candidates.first; it != candidates.second; ++it) {
+            const StatementEffect& effect = it->second;
+            bool same = true;
+            for (const auto& read : effect.reads) {
+                same = same && sameBinding(lookup(read.first), read.second);
+            }
+            if (!same) continue;
+
+            for (const auto& write : effect.writes) {
+                env[write.first] = write.second;
+            }
+            for (const Env& locals : effect.functionEnds) {
+                mergeFunctionLocals(locals);
+            }
+            for (const auto& value : effect.folded) {
+                folded.emplace(info.nodes[value.first], value.second);
+            }
+            for (const FoldDiagnostic& d : effect.diagnostics) {
+                diagnostics.push_back({ d.message, d.line + stmt->line, d.column });
+            }
+            effects.insert(previous.extract(it));
+            ++reusedStatements;
+            return;
+        }
+    }
+
+    ++evaluatedStatements;
+    StatementEffect effect;
+    for (const std::string& name : info.names) {
+        effect.reads.push_back({ name, lookup(name) });
+    }
+    const size_t firstDiagnostic = diagnostics.size();
+    functionEnds = &effect.functionEnds;
+    execute(stmt);
+    functionEnds = nullptr;
+    if (!info.reusable) return;
+
+    for (const std::string& name : info.names) {
+        auto it = env.find(name);
+        if (it != env.end()) effect.writes.push_back(*it);
+    }
+    for (uint32_t i = 0; i < info.nodes.size(); ++i) {
+        auto value = folded.find(info.nodes[i]);
+        if (value != folded.end()) effect.folded.push_back({ i, value->second });
+    }
+    for (size_t i = firstDiagnostic; i < diagnostics.size(); ++i) {
+        const FoldDiagnostic& d = diagnostics[i];
+        effect.diagnostics.push_back({ d.message, d.line - stmt->line, d.column });
+    }
+    effects.emplace(info.fingerprint, std::move(effect));
+}
+
+//——— Results ———
+
+void ConstantFolder::annotate(SymbolTable& table) const {
+    auto record = [&table](const std::string& name, const Binding& value) {
+        const SymbolId id = table.lookup(name);
+        if (!value || id == NO_SYMBOL) return;
+        DataType type = DataType::Unknown;
+        switch (value->kind) {
+        case Constant::Kind::Int:   type = DataType::Int;   break;
+        case Constant::Kind::Float: type = DataType::Float; break;
+        case Constant::Kind::Str:   type = DataType::Str;   break;
+        case Constant::Kind::Bool:  type = DataType::Bool;  break;
+        }
+        table.setInfo(id, type, value->repr());
+    };
+    for (const auto& entry : env) {
+        record(entry.first, entry.second);
+    }
+    for (const auto& entry : functionLocals) {
+        if (!env.count(entry.first)) record(entry.first, entry.second);
+    }
+}
@@ -0,0 +1,157 @@
+// constantfolder.h
+#ifndef CONSTANTFOLDER_H
+#define CONSTANTFOLDER_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "cfg.h"
+#include "numeric.h"
+#include "scoperesolver.h"
+#include "syntaxanalyzer.h"
+
+// Typed compile-time value of an expression
+struct Constant {
+    enum class Kind : uint8_t { Int, Float, Str, Bool };
+    Kind kind = Kind::Int;
+    Integer i;          // Int, Bool (0 or 1)
+    double f = 0.0;     // Float
+    std::string s;      // Str
+
+    static Constant integer(Integer n)   { Constant c; c.kind = Kind::Int; c.i = std::move(n); return c; }
+    static Constant real(double d)       { Constant c; c.kind = Kind::Float; c.f = d; return c; }
+    static Constant string(std::string v){ Constant c; c.kind = Kind::Str; c.s = std::move(v); return c; }
+    static Constant boolean(bool b)      { Constant c; c.kind = Kind::Bool; c.i = Integer(b); return c; }
+
+    const char* typeName() const;   // Python type name
+    std::string repr() const;       // Python repr()
+    bool truthy() const;
+    bool sameAs(const Constant& other) const;
+};
+
+struct FoldDiagnostic {
+    std::string message;
+    int line;
+    int column;
+};
+
+// Constant folding and propagation over a parse tree, in one pass.
+// Every expression is evaluated once, against the constants known at that
+// point of the program: values flow through straight-line code, branches
+// merge (a name stays constant only if every path agrees), loops forget
+// the names their body assigns, and function bodies start from their
+// parameters alone.
+//
+// Which statements can run at all comes from the control-flow graphs.
+// Branches are still followed on the tree. Skipping a branch whose
+// condition folds is constant propagation, which a structural graph does
+// not do. Solving it over the graph would need an environment per block
+// instead of one walk with one environment. It would also lose the
+// top-level statements the memoized mode replays. A path that merges in
+// although it ends in a jump can only make a name non-constant, never
+// give it a wrong value.
+class ConstantFolder {
+public:
+    // Parse unparsed Block nodes of a lazily parsed tree as they are reached.
+    // Otherwise such a block is assumed to assign every name.
+    void setMaterializeBlocks(bool enabled) { materializeBlocks = enabled; }
+    // With a resolver that has run over the same tree, calls of a builtin
+    // the program rebinds (a user-defined len) are not folded
+    void setResolver(const ScopeResolver* scopes) { resolver = scopes; }
+    // With the graphs CfgBuilder built for the same tree, statements no path
+    // from the entry reaches (after a return, break or continue) bind
+    // nothing and report nothing; without them every statement is evaluated
+    void setGraphs(const std::vector<ControlFlowGraph>* cfgs) { graphs = cfgs; }
+    // Remember what each top-level statement did, so the next run (over an
+    // edited program) re-evaluates only the statements whose text changed
+    // or that read a name whose value changed; the others replay their
+    // effects. Only folding is saved this way: each run still walks and
+    // fingerprints every statement of a freshly parsed tree.
+    void setMemoized(bool enabled) { memoized = enabled; }
+
+    void run(ParseNode* root);
+
+    // Folded value of an expression node, or null if it is not constant
+    const Constant* valueOf(const ParseNode* node) const;
+
+    // Fill the data type and value columns for every name that is constant
+    // at the end of the module (or, for function locals, of its function)
+    void annotate(SymbolTable& table) const;
+
+    // Operations that will fail whenever they run (division by zero, ...)
+    const std::vector<FoldDiagnostic>& getDiagnostics() const { return diagnostics; }
+    // Syntax errors found in blocks materialized by the pass
+    const std::vector<SyntaxError>& getBlockErrors() const { return blockErrors; }
+    // Top-level statements the last memoized run evaluated, and reused
+    size_t getEvaluatedStatements() const { return evaluatedStatements; }
+    size_t getReusedStatements() const { return reusedStatements; }
+
+    // Value of a literal node (Number, Hex, Binary, Octal, String, Bool)
+    static bool literalValue(const ParseNode* node, Constant& out, std::string& error);
+
+private:
+    // Known constant, or nullopt once a name may hold different values
+    using Binding = std::optional<Constant>;
+    using Env = std::unordered_map<std::string, Binding>;
+
+    // A top-level statement as the memoized run sees it. The names it
+    // mentions are the only ones it can read or bind; its fingerprint
+    // covers its text and relative line layout, and which of its calls
+    // reach builtins.
+    struct Statement {
+        uint64_t fingerprint = 0;
+        std::vector<const ParseNode*> nodes;    // preorder
+        std::vector<std::string> names;
+        bool reusable = true;                   // no unparsed blocks or unreachable code
+    };
+
+    // What evaluating a statement did: replaying it is equivalent to
+    // evaluating it again as long as `reads` still hold
+    struct StatementEffect {
+        std::vector<std::pair<std::string, Binding>> reads;    // its names on entry
+        std::vector<std::pair<std::string, Binding>> writes;   // its bound names on exit
+        std::vector<Env> functionEnds;                         // end states of its function bodies
+        std::vector<std::pair<uint32_t, Constant>> folded;     // by preorder index
+        std::vector<FoldDiagnostic> diagnostics;               // lines relative to the statement
+    };
+    using EffectMap = std::unordered_multimap<uint64_t, StatementEffect>;
+
+    bool materializeBlocks = false;
+    bool memoized = false;
+    EffectMap effects;
+    std::vector<Env>* functionEnds = nullptr;   // recording a statement's effect
+    size_t evaluatedStatements = 0;
+    size_t reusedStatements = 0;
+    const ScopeResolver* resolver = nullptr;
+    const std::vector<ControlFlowGraph>* graphs = nullptr;
+    std::unordered_set<const ParseNode*> unreachable;   // items of blocks no path reaches
+    Env env;
+    Env functionLocals;
+    std::unordered_map<const ParseNode*, Constant> folded;
+    std::vector<FoldDiagnostic> diagnostics;
+    std::vector<SyntaxError> blockErrors;
+    int currentLine = 0;
+    int currentColumn = 0;
+
+    void execute(ParseNode* node);
+    bool isUnreachable(const ParseNode* stmt) const;
+    void runStatement(ParseNode* stmt, EffectMap& previous);
+    Statement describe(const ParseNode* stmt) const;
+    Binding lookup(const std::string& name) const;
+    void mergeFunctionLocals(const Env& locals);
+    static bool sameBinding(const Binding& a, const Binding& b);
+
+    std::optional<Constant> evaluate(const ParseNode* expr);
+    std::optional<Constant> applyOperator(const std::string& op, const Constant& l, const Constant& r);
+    bool materialize(ParseNode* node);
+    void forgetAssigned(ParseNode* body);
+    void forgetAll();
+    void warn(const std::string& message);
+    bool callsBuiltin(const ParseNode* call) const;
+    static Env merge(const Env& a, const Env& b);
+};
+
+#endif // CONSTANTFOLDER_H
@@ -0,0 +1,306 @@
+// grammar.h
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+// Declarative LL(1) grammar for the statement level of the supported Python
+// subset. Nullable/FIRST/FOLLOW sets and the prediction table are computed
+// at compile time; a grammar that is not LL(1) does not build.
+//
+// The table decides which statement is being parsed (Stmt) and how an if
+// chain continues (IfTail); nothing else is looked up in it. The handlers
+// in SyntaxAnalyzer follow the remaining rules by hand: a Suite is the
+// "Block" of every statement up to its DEDENT, and the handlers also
+// recover from errors the grammar does not describe. Expressions keep
+// their own operator-precedence parser, so Expr below only pins down what
+// may start or follow an expression.
+namespace grammar {
+
+//——— Symbols ———
+
+enum class Terminal : uint8_t {
+    If, Elif, Else, For, While, Def, Return, Pass, Break, Continue, In,
+    Builtin,        // print, len, input
+    AssignTarget,   // identifier directly followed by an AssignOp
+    Name, Literal, Operator,
+    AssignOp, Colon, Comma, LParen, RParen,
+    Newline, Indent, Dedent, EndOfFile,
+    Other,          // any token no production starts with
+    Count
+};
+
+enum class NonTerminal : uint8_t {
+    Program, Stmts, Stmt, CompoundStmt, IfStmt, IfTail, ForStmt, WhileStmt,
+    FuncDef, Params, ParamRest, Suite, SimpleStmt, ReturnValue,
+    Expr, ExprTail, Atom, CallTail, Args, ArgRest,
+    Count
+};
+
+// Handler selected by a production; None for productions that only forward
+// to another nonterminal
+enum class Action : uint8_t {
+    None, If, Elif, Else, For, While, Def,
+    Return, Pass, Break, Continue, Builtin, Assign, ExprStmt
+};
+
+constexpr size_t TERMINAL_COUNT = size_t(Terminal::Count);
+constexpr size_t NONTERMINAL_COUNT = size_t(NonTerminal::Count);
+constexpr NonTerminal START = NonTerminal::Program;
+
+using TerminalSet = uint64_t;
+static_assert(TERMINAL_COUNT <= 64, "terminal sets are stored in a 64-bit mask");
+
+constexpr TerminalSet bit(Terminal t) { return TerminalSet(1) << size_t(t); }
+
+struct Symbol {
+    bool terminal = true;
+    uint8_t id = 0;
+
+    constexpr Symbol() = default;
+    constexpr Symbol(Terminal t) : terminal(true), id(uint8_t(t)) {}
+    constexpr Symbol(NonTerminal n) : terminal(false), id(uint8_t(n)) {}
+};
+
+constexpr size_t MAX_RHS = 8;
+
+struct Production {
+    NonTerminal lhs = START;
+    Action action = Action::None;
+    uint8_t length = 0;
+    Symbol rhs[MAX_RHS] = {};
+};
+
+constexpr Production rule(NonTerminal lhs, Action action, std::initializer_list<Symbol> rhs) {
+    Production p;
+    p.lhs = lhs;
+    p.action = action;
+    for (Symbol s : rhs) {
+        p.rhs[p.length++] = s;
+    }
+    return p;
+}
+
+//——— Grammar ———
+
+using T = Terminal;
+using N = NonTerminal;
+using A = Action;
+
+constexpr Production PRODUCTIONS[] = {
+    rule(N::Program,      A::None,     { N::Stmts, T::EndOfFile }),
+
+    rule(N::Stmts,        A::None,     { N::Stmt, N::Stmts }),
+    rule(N::Stmts,        A::None,     {}),
+
+    rule(N::Stmt,         A::None,     { N::CompoundStmt }),
+    rule(N::Stmt,         A::None,     { N::SimpleStmt, T::Newline }),
+
+    rule(N::CompoundStmt, A::None,     { N::IfStmt }),
+    rule(N::CompoundStmt, A::None,     { N::ForStmt }),
+    rule(N::CompoundStmt, A::None,     { N::WhileStmt }),
+    rule(N::CompoundStmt, A::None,     { N::FuncDef }),
+
+    rule(N::IfStmt,       A::If,       { T::If, N::Expr, T::Colon, N::Suite, N::IfTail }),
+    rule(N::IfTail,       A::Elif,     { T::Elif, N::Expr, T::Colon, N::Suite, N::IfTail }),
+    rule(N::IfTail,       A::Else,     { T::Else, T::Colon, N::Suite }),
+    rule(N::IfTail,       A::None,     {}),
+
+    rule(N::ForStmt,      A::For,      { T::For, T::Name, T::In, N::Expr, T::Colon, N::Suite }),
+    rule(N::WhileStmt,    A::While,    { T::While, N::Expr, T::Colon, N::Suite }),
+    rule(N::FuncDef,      A::Def,      { T::Def, T::Name, T::LParen, N::Params, T::RParen, T::Colon, N::Suite }),
+
+    rule(N::Params,       A::None,     { T::Name, N::ParamRest }),
+    rule(N::Params,       A::None,     {}),
+    rule(N::ParamRest,    A::None,     { T::Comma, T::Name, N::ParamRest }),
+    rule(N::ParamRest,    A::None,     {}),
+
+    rule(N::Suite,        A::None,     { T::Newline, T::Indent, N::Stmt, N::Stmts, T::Dedent }),
+
+    rule(N::SimpleStmt,   A::Return,   { T::Return, N::ReturnValue }),
+    rule(N::SimpleStmt,   A::Pass,     { T::Pass }),
+    rule(N::SimpleStmt,   A::Break,    { T::Break }),
+    rule(N::SimpleStmt,   A::Continue, { T::Continue }),
+    rule(N::SimpleStmt,   A::Assign,   { T::AssignTarget, T::AssignOp, N::Expr }),
+    rule(N::SimpleStmt,   A::ExprStmt, { N::Expr }),
+
+    rule(N::ReturnValue,  A::None,     { N::Expr }),
+    rule(N::ReturnValue,  A::None,     {}),
+
+    rule(N::Expr,         A::None,     { N::Atom, N::ExprTail }),
+    rule(N::ExprTail,     A::None,     { T::Operator, N::Expr }),
+    rule(N::ExprTail,     A::None,     {}),
+
+    rule(N::Atom,         A::None,     { T::Name, N::CallTail }),
+    rule(N::Atom,         A::Builtin,  { T::Builtin, N::CallTail }),
+    rule(N::Atom,         A::None,     { T::Literal }),
+    rule(N::Atom,         A::None,     { T::LParen, N::Expr, T::RParen }),
+    rule(N::Atom,         A::None,     { T::Operator, N::Atom }),
+
+    rule(N::CallTail,     A::None,     { T::LParen, N::Args, T::RParen }),
+    rule(N::CallTail,     A::None,     {}),
+    rule(N::Args,         A::None,     { N::Expr, N::ArgRest }),
+    rule(N::Args,         A::None,     {}),
+    rule(N::ArgRest,      A::None,     { T::Comma, N::Expr, N::ArgRest }),
+    rule(N::ArgRest,      A::None,     {}),
+};
+
+constexpr size_t PRODUCTION_COUNT = sizeof(PRODUCTIONS) / sizeof(PRODUCTIONS[0]);
+constexpr uint8_t NO_PRODUCTION = 0xFF;
+static_assert(PRODUCTION_COUNT < NO_PRODUCTION, "production indices are stored in a byte");
+
+//——— Nullable, FIRST and FOLLOW ———
+
+struct Sets {
+    bool nullable[NONTERMINAL_COUNT] = {};
+    TerminalSet first[NONTERMINAL_COUNT] = {};
+    TerminalSet follow[NONTERMINAL_COUNT] = {};
+};
+
+constexpr bool addTo(TerminalSet& set, TerminalSet add) {
+    if ((set | add) == set) return false;
+    set |= add;
+    return true;
+}
+
+constexpr Sets computeSets() {
+    Sets s;
+
+    // Nullable and FIRST by fixed-point iteration
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const Production& p : PRODUCTIONS) {
+            const size_t lhs = size_t(p.lhs);
+            bool prefixNullable = true;
+            for (size_t i = 0; i < p.length && prefixNullable; ++i) {
+                const Symbol sym = p.rhs[i];
+                changed |= addTo(s.first[lhs], sym.terminal ? bit(Terminal(sym.id)) : s.first[sym.id]);
+                prefixNullable = !sym.terminal && s.nullable[sym.id];
+            }
+            if (prefixNullable && !s.nullable[lhs]) {
+                s.nullable[lhs] = true;
+                changed = true;
+            }
+        }
+    }
+
+    // FOLLOW: walk each right-hand side backwards carrying FIRST of the rest
+    s.follow[size_t(START)] = bit(Terminal::EndOfFile);
+    changed = true;
+    while (changed) {
+        changed = false;
+        for (const Production& p : PRODUCTIONS) {
+            TerminalSet trailer = s.follow[size_t(p.lhs)];
+            for (size_t i = p.length; i-- > 0;) {
+                const Symbol sym = p.rhs[i];
+                if (sym.terminal) {
+                    trailer = bit(Terminal(sym.id));
+                    continue;
+                }
+                changed |= addTo(s.follow[sym.id], trailer);
+                trailer = s.nullable[sym.id] ? (trailer | s.first[sym.id]) : s.first[sym.id];
+            }
+        }
+    }
+    return s;
+}
+
+constexpr Sets SETS = computeSets();
+
+// Lookaheads that select production `p`
+constexpr TerminalSet predictSet(const Production& p) {
+    TerminalSet set = 0;
+    for (size_t i = 0; i < p.length; ++i) {
+        const Symbol sym = p.rhs[i];
+        if (sym.terminal) return set | bit(Terminal(sym.id));
+        set |= SETS.first[sym.id];
+        if (!SETS.nullable[sym.id]) return set;
+    }
+    return set | SETS.follow[size_t(p.lhs)];
+}
+
+//——— Prediction table ———
+
+struct Table {
+    uint8_t entry[NONTERMINAL_COUNT][TERMINAL_COUNT] = {};
+    size_t conflicts = 0;
+};
+
+constexpr Table buildTable() {
+    Table table;
+    for (size_t n = 0; n < NONTERMINAL_COUNT; ++n) {
+        for (size_t t = 0; t < TERMINAL_COUNT; ++t) {
+            table.entry[n][t] = NO_PRODUCTION;
+        }
+    }
+    for (size_t k = 0; k < PRODUCTION_COUNT; ++k) {
+        const size_t lhs = size_t(PRODUCTIONS[k].lhs);
+        const TerminalSet set = predictSet(PRODUCTIONS[k]);
+        for (size_t t = 0; t < TERMINAL_COUNT; ++t) {
+            if (!(set & (TerminalSet(1) << t))) continue;
+            if (table.entry[lhs][t] != NO_PRODUCTION) {
+                ++table.conflicts;
+            } else {
+                table.entry[lhs][t] = uint8_t(k);
+            }
+        }
+    }
+    return table;
+}
+
+constexpr Table TABLE = buildTable();
+static_assert(TABLE.conflicts == 0, "grammar is not LL(1): two productions share a lookahead");
+
+//——— Action table ———
+
+// Follows leftmost derivations from `nt` on `lookahead` until a production
+// starts with a terminal; the innermost action on the way wins
+constexpr Action resolveAction(NonTerminal nt, Terminal lookahead) {
+    Action action = Action::None;
+    for (size_t depth = 0; depth < NONTERMINAL_COUNT; ++depth) {
+        const uint8_t k = TABLE.entry[size_t(nt)][size_t(lookahead)];
+        if (k == NO_PRODUCTION) return action;
+        const Production& p = PRODUCTIONS[k];
+        if (p.action != Action::None) action = p.action;
+        if (p.length == 0 || p.rhs[0].terminal) return action;
+        nt = NonTerminal(p.rhs[0].id);
+    }
+    return action;
+}
+
+struct ActionTable {
+    Action entry[NONTERMINAL_COUNT][TERMINAL_COUNT] = {};
+};
+
+constexpr ActionTable buildActionTable() {
+    ActionTable table;
+    for (size_t n = 0; n < NONTERMINAL_COUNT; ++n) {
+        for (size_t t = 0; t < TERMINAL_COUNT; ++t) {
+            table.entry[n][t] = resolveAction(NonTerminal(n), Terminal(t));
+        }
+    }
+    return table;
+}
+
+constexpr ActionTable ACTIONS = buildActionTable();
+
+// Handler for `nt` on `lookahead`, Action::None if the grammar has no
+// production for it
+constexpr Action selectAction(NonTerminal nt, Terminal lookahead) {
+    return ACTIONS.entry[size_t(nt)][size_t(lookahead)];
+}
+
+static_assert(selectAction(N::Stmt, T::If) == A::If, "if statements dispatch to the if handler");
+static_assert(selectAction(N::Stmt, T::Builtin) == A::Builtin, "builtin calls win over expression statements");
+static_assert(selectAction(N::Stmt, T::Name) == A::ExprStmt, "names start expression statements");
+static_assert(selectAction(N::Stmt, T::Elif) == A::None, "a stray elif has no production");
+static_assert(selectAction(N::IfTail, T::Else) == A::Else, "else continues an if chain");
+static_assert(SETS.follow[size_t(N::Stmts)] == (bit(T::Dedent) | bit(T::EndOfFile)),
+              "a Block ends only at a DEDENT or the end of input");
+
+} // namespace grammar
+
+#endif // GRAMMAR_H
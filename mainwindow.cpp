@@ -3,20 +3,44 @@
 #include "pythonlexer.h"
 #include "syntaxanalyzer.h"
 #include "parsetreedisplay.h"
+#include "treeminimap.h"
+#include "bytecode.h"
+#include "analysis.h"
+#include "vm.h"
 
 #include <QString>
 #include <QTextStream>
 #include <vector>
 #include <algorithm>
-#include <QTableWidgetItem>
 #include <QFileDialog>
 #include <QFile>
 #include <QMessageBox>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QCheckBox>
+#include <QHeaderView>
 #include <QPushButton>
+#include <QSpinBox>
+#include <QLabel>
 #include <iostream>
+#include <memory>
+#include <exception>
+#include <QStatusBar>
+
+// Loop iterations and calls a program may make before Run stops it, so a
+// runaway loop ends on its own
+static const uint64_t VM_INSTRUCTION_BUDGET = 50000000;
+
+// Auto-analyze waits this long after an edit for the next one, so a burst
+// of typing starts one analysis; a run that is still going when the next
+// one starts is cancelled
+static const int LIVE_ANALYSIS_DEBOUNCE_MS = 30;
+// Target for the 95th percentile of edit-to-results latency. It is not met
+// on large files yet: the analysis alone exceeds it on a 10k-line file (the
+// "live" section of Finalproject_bench measures that part), and filling the
+// views comes on top.
+static const qint64 LIVE_LATENCY_BUDGET_MS = 50;
+static const size_t LIVE_LATENCY_SAMPLES = 100;
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -24,6 +48,29 @@ MainWindow::MainWindow(QWidget *parent)
     , graphicalViewActive(true) // Default to graphical view
 {
     ui->setupUi(this);
+    folder.setMemoized(true);
+
+    // Analysis runs on a worker thread and reports back through a queued
+    // signal; one thread, so runs sharing the folder never overlap
+    qRegisterMetaType<std::shared_ptr<AnalysisResult>>();
+    analysisPool.setMaxThreadCount(1);
+    connect(this, &MainWindow::analysisReady, this, &MainWindow::showAnalysis, Qt::QueuedConnection);
+
+    // Programs run the same way, on a thread of their own
+    qRegisterMetaType<std::shared_ptr<RunResult>>();
+    runPool.setMaxThreadCount(1);
+    connect(this, &MainWindow::runReady, this, &MainWindow::showRun, Qt::QueuedConnection);
+
+    // Auto-analyze restarts the debounce timer on every edit. Each run takes
+    // the whole text, so only that an edit happened matters, not where:
+    // lexing, parsing, resolution and inference start over, and the folder
+    // replays the statements it can (ConstantFolder::setMemoized)
+    liveTimer.setSingleShot(true);
+    liveTimer.setInterval(LIVE_ANALYSIS_DEBOUNCE_MS);
+    connect(&liveTimer, &QTimer::timeout, this, [this]() { startAnalysis(true); });
+    connect(ui->codeInput, &QPlainTextEdit::textChanged, this, &MainWindow::scheduleLiveAnalysis);
+    connect(ui->autoAnalyzeCheck, &QCheckBox::toggled, this, &MainWindow::setAutoAnalyze);
+    editClock.start();
 
     // Connect the analyze button to the slot
     connect(ui->analyzeButton, &QPushButton::clicked, this, &MainWindow::analyze);
@@ -34,19 +81,48 @@ MainWindow::MainWindow(QWidget *parent)
     // Connect the open file button to the slot
     connect(ui->openFileButton, &QPushButton::clicked, this, &MainWindow::openFile);
 
-    // Configure the symbol table widget
+    // Connect the run button to the slot
+    connect(ui->runButton, &QPushButton::clicked, this, &MainWindow::runProgram);
+
+    // Configure the token view; rows are formatted only as they are
+    // painted, and all rows have one height so none need measuring
+    tokenModel = new TokenTableModel(this);
+    ui->tokenOutput->setModel(tokenModel);
+    ui->tokenOutput->verticalHeader()->setVisible(false);
+    ui->tokenOutput->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    ui->tokenOutput->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    ui->tokenOutput->horizontalHeader()->setStretchLastSection(true);
+    ui->tokenOutput->sortByColumn(TokenTableModel::LineColumn, Qt::AscendingOrder);
+    connect(ui->tokenFilter, &QLineEdit::textChanged, tokenModel, &TokenTableModel::setFilter);
+
+    // Configure the symbol table view
+    symbolModel = new SymbolTableModel(this);
+    ui->symbolTable->setModel(symbolModel);
+    ui->symbolTable->verticalHeader()->setVisible(false);
     ui->symbolTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui->symbolTable->sortByColumn(SymbolTableModel::IdColumn, Qt::AscendingOrder);
 
-    // Configure the parse tree widget (text-based tree)
-    ui->parseTree->setHeaderLabel("Parse Tree");
+    // Configure the parse tree view (text-based tree)
+    parseTreeModel = new ParseTreeModel(this);
+    ui->parseTree->setModel(parseTreeModel);
     ui->parseTree->setAlternatingRowColors(true);
     ui->parseTree->setUniformRowHeights(true);
     ui->parseTree->setAnimated(true);
     ui->parseTree->setAllColumnsShowFocus(true);
     ui->parseTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    connect(parseTreeModel, &ParseTreeModel::blockParsed, this, &MainWindow::showBlockErrors);
 
     // Create the graphical parse tree view
     parseTreeGraphical = new ParseTreeDisplay(this);
+    connect(parseTreeGraphical, &ParseTreeDisplay::blockParsed, this, &MainWindow::showBlockErrors);
+
+    // With an overview of the whole tree beside it, for finding the way
+    // around trees too big to read when fitted in view
+    graphicalPane = new QWidget(this);
+    QHBoxLayout* paneLayout = new QHBoxLayout(graphicalPane);
+    paneLayout->setContentsMargins(0, 0, 0, 0);
+    paneLayout->addWidget(parseTreeGraphical, 1);
+    paneLayout->addWidget(new TreeMinimap(parseTreeGraphical, graphicalPane));
     
     // Create checkbox for switching between views
     QCheckBox* viewToggle = new QCheckBox("Use Graphical View", this);
@@ -80,6 +156,13 @@ MainWindow::MainWindow(QWidget *parent)
             parseTreeGraphical->resetZoom();
         }
     });
+
+    // Levels shown before subtrees are collapsed; clicking a node toggles it
+    QSpinBox* depthBox = new QSpinBox(this);
+    depthBox->setRange(1, 99);
+    depthBox->setValue(parseTreeGraphical->collapseDepth());
+    depthBox->setToolTip("Levels shown before subtrees are collapsed");
+    connect(depthBox, qOverload<int>(&QSpinBox::valueChanged), parseTreeGraphical, &ParseTreeDisplay::setCollapseDepth);
     
     // Create container for zoom buttons
     QHBoxLayout* zoomLayout = new QHBoxLayout();
@@ -87,6 +170,8 @@ MainWindow::MainWindow(QWidget *parent)
     zoomLayout->addWidget(zoomOutBtn);
     zoomLayout->addWidget(resetZoomBtn);
     zoomLayout->addStretch();
+    zoomLayout->addWidget(new QLabel("Depth", this));
+    zoomLayout->addWidget(depthBox);
     
     // Add the components to the layout
     QVBoxLayout* parseTreeLayout = qobject_cast<QVBoxLayout*>(ui->parseTreeWidget->layout());
@@ -99,7 +184,7 @@ MainWindow::MainWindow(QWidget *parent)
         ui->parseTree->setVisible(false);
         
         // Add the graphical tree view
-        parseTreeLayout->addWidget(parseTreeGraphical);
+        parseTreeLayout->addWidget(graphicalPane);
     }
 
     // Set initial splitter sizes
@@ -110,6 +195,14 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // The worker refers to this window; let it stop before tearing down
+    if (activeAnalysis) {
+        activeAnalysis->cancel();
+    }
+    analysisPool.waitForDone();
+    cancelRun();
+    runPool.waitForDone();
+    SyntaxAnalyzer::deleteTree(displayedTree);
     delete ui;
 }
 
@@ -133,16 +226,59 @@ void MainWindow::switchTreeView(bool useGraphicalView)
     
     // Add the new view
     if (useGraphicalView) {
-        parseTreeLayout->addWidget(parseTreeGraphical);
-        parseTreeGraphical->setVisible(true);
+        parseTreeLayout->addWidget(graphicalPane);
+        graphicalPane->setVisible(true);
     } else {
         parseTreeLayout->addWidget(ui->parseTree);
         ui->parseTree->setVisible(true);
     }
 }
 
+void MainWindow::showBlockErrors(const std::vector<SyntaxError>& errors)
+{
+    // Errors inside a block only surface once it has been parsed
+    for (const auto& err : errors) {
+        ui->syntaxErrorOutput->appendPlainText(QString("[Line %1:%2] Syntax Error: %3")
+            .arg(err.line)
+            .arg(err.column)
+            .arg(QString::fromStdString(err.message)));
+    }
+}
+
 void MainWindow::analyze()
 {
+    startAnalysis(false);
+}
+
+void MainWindow::scheduleLiveAnalysis()
+{
+    if (!ui->autoAnalyzeCheck->isChecked()) return;
+    lastEditAt = editClock.elapsed();
+    liveTimer.start();
+
+    // Whatever is being analyzed now is already out of date
+    if (activeAnalysis) {
+        activeAnalysis->cancel();
+        activeAnalysis.reset();
+        ++analysisGeneration;
+    }
+}
+
+void MainWindow::setAutoAnalyze(bool enabled)
+{
+    liveTimer.stop();
+    liveLatencies.clear();
+    nextLatency = 0;
+    // A run waiting for the debounce would otherwise never start
+    if (enabled || runPending) {
+        startAnalysis(false);
+    }
+}
+
+void MainWindow::startAnalysis(bool live)
+{
+    liveTimer.stop();
+
     // Get the input code from the GUI
     QString code = ui->codeInput->toPlainText();
 
@@ -151,66 +287,82 @@ void MainWindow::analyze()
         code += '\n';
     }
 
-    std::string codeStr = code.toStdString();
+    // A new request supersedes the one in flight. The pool has one thread,
+    // so runs never overlap on the shared folder; a cancelled run returns
+    // at its next poll and the new one starts right after it.
+    if (activeAnalysis) {
+        activeAnalysis->cancel();
+    }
+    auto cancel = std::make_shared<CancellationToken>();
+    activeAnalysis = cancel;
+    const uint64_t generation = ++analysisGeneration;
+    requestEditAt = live ? lastEditAt : -1;
+    if (!live) {
+        statusBar()->showMessage("Analyzing...");
+    }
 
-    // Create a new PythonLexer instance for this analysis
-    PythonLexer lexer(codeStr);
-    auto [tokens, lexicalErrors] = lexer.tokenize();
+    // Live runs skip the debug trace on stdout, which costs more than
+    // parsing itself
+    analysisPool.start([this, codeStr = code.toStdString(), cancel, generation, live, compile = runPending]() {
+        std::shared_ptr<AnalysisResult> result;
+        try {
+            result = analyzeSource(codeStr, *cancel, folder, !live, compile);
+        } catch (const std::exception& e) {
+            result = std::make_shared<AnalysisResult>();
+            result->hasLexicalErrors = true;
+            result->lexicalErrorOutput = QString("Analysis failed: %1\n").arg(e.what());
+        }
+        result->generation = generation;
+        emit analysisReady(result);
+    });
+}
 
-    // Debug: Print all tokens
-    std::cout << "\nAll tokens:" << std::endl;
-    for (const auto& token : tokens) {
-        std::cout << "[Line " << token.line << ":" << token.column << "] "
-                  << tokenTypeToString(token.type) << ": '" << token.lexeme << "'" << std::endl;
+void MainWindow::showAnalysis(std::shared_ptr<AnalysisResult> result)
+{
+    // Results of superseded requests are dropped
+    if (result->cancelled || result->generation != analysisGeneration) {
+        SyntaxAnalyzer::deleteTree(result->tree);
+        return;
     }
+    activeAnalysis.reset();
 
-    // Display tokens with line numbers
-    QString tokenOutput;
-    for (const auto& token : tokens) {
-        tokenOutput += QString("[Line %1:%2] '%3' (%4)\n")
-            .arg(token.line)
-            .arg(token.column)
-            .arg(QString::fromStdString(token.lexeme))
-            .arg(QString::fromStdString(tokenTypeToString(token.type)));
+    displayAnalysis(*result);
+    if (requestEditAt >= 0) {
+        recordLiveLatency(editClock.elapsed() - requestEditAt);
     }
-    ui->tokenOutput->setPlainText(tokenOutput);
-
-    // Display lexical errors with line numbers
-    QString lexicalErrorOutput;
-    for (const auto& error : lexicalErrors) {
-        lexicalErrorOutput += QString("[Line %1:%2] Lexical Error: %3\n")
-            .arg(error.line)
-            .arg(error.column)
-            .arg(QString::fromStdString(error.message));
+    if (result->compileRequested) {
+        runPending = false;
+        runCompiled(*result);
+    }
+}
+
+void MainWindow::displayAnalysis(AnalysisResult& result)
+{
+    if (!result.pipelineStatus.isEmpty()) {
+        statusBar()->showMessage(result.pipelineStatus);
+    } else {
+        statusBar()->showMessage(QString("Analyzed in %1 ms").arg(result.elapsedMs));
     }
-    ui->lexicalErrorOutput->setPlainText(lexicalErrorOutput);
 
-    // Clear any existing parse tree
-    ui->parseTree->clear();
+    tokenModel->setTokens(result.tokens);
+    ui->lexicalErrorOutput->setPlainText(result.lexicalErrorOutput);
+
+    // Clear any existing parse tree; the views no longer refer to it
+    parseTreeModel->setRoot(nullptr);
     parseTreeGraphical->clear();
+    SyntaxAnalyzer::deleteTree(displayedTree);
+    displayedTree = result.tree;
 
-    // If there are lexical errors, don't proceed with parsing
-    if (!lexicalErrors.empty()) {
+    if (result.hasLexicalErrors) {
         ui->syntaxErrorOutput->setPlainText("Parse tree not displayed due to lexical errors.");
         return;
     }
-
-    // Filter out comment tokens before parsing
-    std::vector<Token> parseTokens;
-    parseTokens.reserve(tokens.size());
-    for (const auto& token : tokens) {
-        if (token.type != TokenType::COMMENT) {
-            parseTokens.push_back(token);
-        }
-    }
-
-    // Create and run the syntax analyzer with filtered tokens
-    SyntaxAnalyzer parser(parseTokens);
-    ParseNode* tree = parser.parseProgram();
+    parseTokens = result.parseTokens;
+    ParseNode* tree = result.tree;
 
     // Display syntax errors
     QString syntaxErrorOutput;
-    const auto& syntaxErrors = parser.getErrors();
+    const auto& syntaxErrors = result.syntaxErrors;
     for (const auto& err : syntaxErrors) {
         syntaxErrorOutput += QString("[Line %1:%2] Syntax Error: %3\n")
             .arg(err.line)
@@ -226,7 +378,9 @@ void MainWindow::analyze()
         
         // Update the appropriate tree view
         if (!graphicalViewActive) {
-            parser.populateTree(ui->parseTree);
+            // Only the top-level statements are fetched up front
+            parseTreeModel->setRoot(tree);
+            ui->parseTree->expand(parseTreeModel->index(0, 0));
         } else {
             parseTreeGraphical->setParseTree(tree);
         }
@@ -237,56 +391,62 @@ void MainWindow::analyze()
         }
     }
 
-    // Display symbol table
-    const auto& symbols = lexer.getSymbolTable().getSymbols();
-    std::vector<std::string> identifiers;
-    for (const auto& entry : symbols) {
-        identifiers.push_back(entry.first);
+    for (const auto& warning : result.warnings) {
+        ui->syntaxErrorOutput->appendPlainText(QString("[Line %1:%2] Warning: %3")
+            .arg(warning.line)
+            .arg(warning.column)
+            .arg(QString::fromStdString(warning.message)));
     }
 
-    // Sort by ID
-    std::sort(identifiers.begin(), identifiers.end(),
-              [&lexer](const auto& a, const auto& b) {
-                  return lexer.getSymbolTable().getId(a) < lexer.getSymbolTable().getId(b);
-              });
-
-    // Populate the table with ID, Identifier, Data Type, and Value
-    ui->symbolTable->setRowCount(identifiers.size());
-    for (size_t i = 0; i < identifiers.size(); ++i) {
-        const auto& identifier = identifiers[i];
-        const auto& symbolTable = lexer.getSymbolTable();
-
-        // ID column
-        QTableWidgetItem* idItem = new QTableWidgetItem(QString::number(symbolTable.getId(identifier)));
-        idItem->setFlags(idItem->flags() ^ Qt::ItemIsEditable);
-        ui->symbolTable->setItem(i, 0, idItem);
-
-        // Identifier column
-        QTableWidgetItem* identItem = new QTableWidgetItem(QString::fromStdString(identifier));
-        identItem->setFlags(identItem->flags() ^ Qt::ItemIsEditable);
-        ui->symbolTable->setItem(i, 1, identItem);
-
-        // Data Type column
-        QTableWidgetItem* typeItem = new QTableWidgetItem(QString::fromStdString(symbolTable.getDataType(identifier)));
-        typeItem->setFlags(typeItem->flags() ^ Qt::ItemIsEditable);
-        ui->symbolTable->setItem(i, 2, typeItem);
-
-        // Value column
-        QTableWidgetItem* valueItem = new QTableWidgetItem(QString::fromStdString(symbolTable.getValue(identifier)));
-        valueItem->setFlags(valueItem->flags() ^ Qt::ItemIsEditable);
-        ui->symbolTable->setItem(i, 3, valueItem);
+    // Display symbol table; rows an edit did not affect are left alone
+    symbolModel->update(std::move(result.symbolTable));
+}
+
+// The status bar shows the latest latency and the 95th percentile of the
+// recent ones against the budget
+void MainWindow::recordLiveLatency(qint64 ms)
+{
+    if (liveLatencies.size() < LIVE_LATENCY_SAMPLES) {
+        liveLatencies.push_back(ms);
+    } else {
+        liveLatencies[nextLatency] = ms;
     }
+    nextLatency = (nextLatency + 1) % LIVE_LATENCY_SAMPLES;
+
+    std::vector<qint64> sorted = liveLatencies;
+    const size_t rank = (sorted.size() * 95 + 99) / 100 - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    const qint64 p95 = sorted[rank];
+
+    statusBar()->showMessage(QString("Live: %1 ms; p95 %2 ms over %3 edits (budget %4 ms)%5")
+                                 .arg(ms)
+                                 .arg(p95)
+                                 .arg(sorted.size())
+                                 .arg(LIVE_LATENCY_BUDGET_MS)
+                                 .arg(p95 > LIVE_LATENCY_BUDGET_MS ? " - over budget" : ""));
 }
 
 void MainWindow::clear()
 {
+    // Whatever is still being analyzed would refill the views
+    if (activeAnalysis) {
+        activeAnalysis->cancel();
+    }
+    ++analysisGeneration;
+    runPending = false;
+    cancelRun();
+
     ui->codeInput->clear();
-    ui->tokenOutput->clear();
+    liveTimer.stop();
+    tokenModel->setTokens(nullptr);
     ui->lexicalErrorOutput->clear();
     ui->syntaxErrorOutput->clear();
-    ui->parseTree->clear();
+    parseTreeModel->setRoot(nullptr);
     parseTreeGraphical->clear();
-    ui->symbolTable->setRowCount(0);
+    SyntaxAnalyzer::deleteTree(displayedTree);
+    displayedTree = nullptr;
+    symbolModel->update(SymbolTable());
+    ui->executionOutput->clear();
 }
 
 void MainWindow::openFile()
@@ -307,3 +467,107 @@ void MainWindow::openFile()
     ui->codeInput->setPlainText(in.readAll());
     file.close();
 }
+
+void MainWindow::runProgram()
+{
+    // The analysis compiles the tree it shows; the run starts once it is in
+    runPending = true;
+    startAnalysis(false);
+    statusBar()->showMessage("Compiling...");
+}
+
+void MainWindow::runCompiled(const AnalysisResult& analysis)
+{
+    // A new run replaces the one still going; with one thread, it starts
+    // once the old one has noticed
+    cancelRun();
+
+    // The lexer's diagnostics stay on the lexical tab; the parser and the
+    // compiler reject anything that cannot be executed
+    QString result;
+    if (analysis.hasLexicalErrors) {
+        ui->executionOutput->setPlainText("Program not run due to lexical errors.");
+        ui->analysisTabWidget->setCurrentWidget(ui->executionTab);
+        return;
+    }
+    if (!analysis.syntaxErrors.empty()) {
+        for (const auto& err : analysis.syntaxErrors) {
+            result += QString("[Line %1:%2] Syntax Error: %3\n")
+                .arg(err.line)
+                .arg(err.column)
+                .arg(QString::fromStdString(err.message));
+        }
+        ui->executionOutput->setPlainText(result + "\nProgram not run due to syntax errors.");
+        ui->analysisTabWidget->setCurrentWidget(ui->executionTab);
+        return;
+    }
+    if (!analysis.program) {
+        for (const auto& err : analysis.compileErrors) {
+            result += QString("[Line %1] Compile Error: %2\n")
+                .arg(err.line)
+                .arg(QString::fromStdString(err.message));
+        }
+        ui->executionOutput->setPlainText(result + "\nProgram not run due to compile errors.");
+        ui->analysisTabWidget->setCurrentWidget(ui->executionTab);
+        return;
+    }
+
+    auto cancel = std::make_shared<CancellationToken>();
+    activeRun = cancel;
+    const uint64_t generation = ++runGeneration;
+    statusBar()->showMessage("Running...");
+
+    runPool.start([this, program = analysis.program, cancel, generation, profile = ui->profileCheck->isChecked()]() {
+        auto result = std::make_shared<RunResult>();
+        result->generation = generation;
+        VirtualMachine vm(*program);
+        vm.setProfiling(profile);
+        vm.setInstructionBudget(VM_INSTRUCTION_BUDGET);
+        vm.setCancellation(cancel.get());
+        result->ok = vm.run();
+        if (cancel->isCancelled()) return;
+        result->output = vm.getOutput();
+        result->error = vm.getError();
+        result->instructions = vm.getProfile().instructions;
+        result->seconds = vm.getProfile().seconds;
+        if (profile) {
+            result->profileReport = vm.profileReport();
+        }
+        emit runReady(result);
+    });
+}
+
+void MainWindow::cancelRun()
+{
+    if (activeRun) {
+        activeRun->cancel();
+        activeRun.reset();
+    }
+    ++runGeneration;
+}
+
+void MainWindow::showRun(std::shared_ptr<RunResult> run)
+{
+    if (run->generation != runGeneration) return;
+    activeRun.reset();
+
+    QString result = QString::fromStdString(run->output);
+    if (!run->ok) {
+        result += QString("[Line %1] Runtime Error: %2\n")
+            .arg(run->error.line)
+            .arg(QString::fromStdString(run->error.message));
+    }
+    if (!run->profileReport.empty()) {
+        result += "\n" + QString::fromStdString(run->profileReport);
+    }
+    ui->executionOutput->setPlainText(result);
+    ui->analysisTabWidget->setCurrentWidget(ui->executionTab);
+
+    if (run->profileReport.empty()) {
+        statusBar()->showMessage(QString("Ran in %1 ms").arg(run->seconds * 1000.0, 0, 'f', 2));
+    } else {
+        statusBar()->showMessage(QString("Ran %1 bytecode instructions in %2 ms")
+                                     .arg(run->instructions)
+                                     .arg(run->seconds * 1000.0, 0, 'f', 2));
+    }
+}
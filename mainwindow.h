@@ -2,8 +2,33 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QThreadPool>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "analysis.h"
 #include "syntaxanalyzer.h"
+#include "constantfolder.h"
 #include "parsetreedisplay.h"
+#include "parsetreemodel.h"
+#include "symboltablemodel.h"
+#include "tokentablemodel.h"
+#include "vm.h"
+
+// Output of a program run on the run worker
+struct RunResult {
+    uint64_t generation = 0;    // run this answers; older ones are stale
+    bool ok = true;
+    std::string output;
+    RuntimeError error;
+    uint64_t instructions = 0;  // counted only when profiling
+    double seconds = 0.0;
+    std::string profileReport;  // empty unless profiling
+};
+
+Q_DECLARE_METATYPE(std::shared_ptr<RunResult>)
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -19,22 +44,93 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+signals:
+    // Emitted from the analysis worker thread
+    void analysisReady(std::shared_ptr<AnalysisResult> result);
+    // Emitted from the run worker thread
+    void runReady(std::shared_ptr<RunResult> result);
+
 private slots:
+    // Start analyzing the input in the background, cancelling any analysis
+    // still running
     void analyze();
+    // Auto-analyze: restart the debounce timer on every edit
+    void scheduleLiveAnalysis();
+    void setAutoAnalyze(bool enabled);
+    // Show a finished analysis unless a newer one was requested since
+    void showAnalysis(std::shared_ptr<AnalysisResult> result);
+    // Show the output of a finished run unless it was cancelled since
+    void showRun(std::shared_ptr<RunResult> result);
     void clear();
     void openFile();
+
+    // Analyze the program, compiling it to bytecode, and run it on the VM
+    // once the analysis is in
+    void runProgram();
     
     // New method to switch between tree views
     void switchTreeView(bool useGraphicalView);
 
+    // Report errors in a block parsed when its tree row was expanded
+    void showBlockErrors(const std::vector<SyntaxError>& errors);
+
 private:
     Ui::MainWindow *ui;
     
-    // ParseTreeDisplay for graphical view
+    // ParseTreeDisplay for graphical view, and the pane holding it with
+    // its minimap
     ParseTreeDisplay* parseTreeGraphical;
+    QWidget* graphicalPane;
+
+    // Rows of the text view, fetched as the user expands them
+    ParseTreeModel* parseTreeModel;
     
     // Flag to track which view is active
     bool graphicalViewActive;
+
+    // Tokens and symbols of the last analysis, for their views
+    TokenTableModel* tokenModel;
+    SymbolTableModel* symbolModel;
+
+    // Tree of the last analysis shown, owned here; both views point into it
+    ParseNode* displayedTree = nullptr;
+
+    // Tokens of the last analysis; unparsed blocks in the tree point into it
+    std::shared_ptr<std::vector<Token>> parseTokens;
+
+    // Kept between analyses so that after an edit only the statements it
+    // affects are folded again; only the analysis worker touches it
+    ConstantFolder folder;
+
+    QThreadPool analysisPool;
+    std::shared_ptr<CancellationToken> activeAnalysis;  // request in flight
+    uint64_t analysisGeneration = 0;                    // latest request
+
+    // Run was pressed; every analysis compiles until one is shown, so an
+    // edit that supersedes the request does not lose the run
+    bool runPending = false;
+
+    // The program runs on its own worker, so a long run neither blocks the
+    // window nor holds up the analyses started while it goes on
+    QThreadPool runPool;
+    std::shared_ptr<CancellationToken> activeRun;       // run in flight
+    uint64_t runGeneration = 0;                         // latest run
+
+    // Auto-analyze: an analysis starts once edits pause for the debounce
+    // interval. Latency runs from the last edit the analyzed text includes
+    // to the moment its results are in the views.
+    QTimer liveTimer;
+    QElapsedTimer editClock;
+    qint64 lastEditAt = -1;
+    qint64 requestEditAt = -1;              // of the latest request; -1 unless live
+    std::vector<qint64> liveLatencies;      // most recent samples, as a ring
+    size_t nextLatency = 0;
+
+    void startAnalysis(bool live);
+    void displayAnalysis(AnalysisResult& result);
+    void runCompiled(const AnalysisResult& result);
+    void cancelRun();
+    void recordLiveLatency(qint64 ms);
 };
 
 #endif // MAINWINDOW_H
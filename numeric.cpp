@@ -0,0 +1,629 @@
+// numeric.cpp
+#include "numeric.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// Results of ** with more bits than this are refused rather than computed;
+// schoolbook multiplication makes anything larger painfully slow
+const size_t MAX_POW_BITS = 1 << 17;
+
+int leadingZeros32(uint32_t x) {
+    int n = 0;
+    while (!(x & 0x80000000u)) {
+        x <<= 1;
+        ++n;
+    }
+    return n;
+}
+
+int digitValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 99;
+}
+
+} // namespace
+
+std::string formatFloat(double d) {
+    if (std::isnan(d)) return "nan";
+    if (std::isinf(d)) return d < 0 ? "-inf" : "inf";
+
+    char buf[40];
+    for (int precision = 1; precision <= 17; ++precision) {
+        std::snprintf(buf, sizeof(buf), "%.*e", precision - 1, d);
+        if (std::strtod(buf, nullptr) == d) break;
+    }
+
+    // buf is [-]d[.ddd]e±xx
+    std::string text(buf);
+    std::string sign;
+    if (text[0] == '-') {
+        sign = "-";
+        text.erase(0, 1);
+    }
+    const size_t ePos = text.find('e');
+    const int exponent = std::atoi(text.c_str() + ePos + 1);
+    std::string digits;
+    for (size_t i = 0; i < ePos; ++i) {
+        if (text[i] != '.') digits += text[i];
+    }
+    while (digits.size() > 1 && digits.back() == '0') digits.pop_back();
+
+    if (exponent >= -4 && exponent < 16) {
+        std::string fixed;
+        if (exponent >= 0) {
+            if (digits.size() <= size_t(exponent) + 1) {
+                fixed = digits + std::string(exponent + 1 - digits.size(), '0') + ".0";
+            } else {
+                fixed = digits.substr(0, exponent + 1) + "." + digits.substr(exponent + 1);
+            }
+        } else {
+            fixed = "0." + std::string(-exponent - 1, '0') + digits;
+        }
+        return sign + fixed;
+    }
+
+    std::string mantissa = digits.substr(0, 1);
+    if (digits.size() > 1) mantissa += "." + digits.substr(1);
+    char exp[16];
+    std::snprintf(exp, sizeof(exp), "e%c%02d", exponent < 0 ? '-' : '+', std::abs(exponent));
+    return sign + mantissa + exp;
+}
+
+//——— BigInt ———
+
+BigInt::BigInt(int64_t value) {
+    negative = value < 0;
+    uint64_t magnitude = negative ? 0 - uint64_t(value) : uint64_t(value);
+    while (magnitude) {
+        limbs.push_back(uint32_t(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+void BigInt::trim() {
+    while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+    if (limbs.empty()) negative = false;
+}
+
+bool BigInt::parse(const std::string& digits, int base, BigInt& out) {
+    out = BigInt();
+    if (digits.empty()) return false;
+    for (char c : digits) {
+        const int d = digitValue(c);
+        if (d >= base) return false;
+
+        // magnitude = magnitude * base + d
+        uint64_t carry = uint64_t(d);
+        for (uint32_t& limb : out.limbs) {
+            const uint64_t cur = uint64_t(limb) * uint64_t(base) + carry;
+            limb = uint32_t(cur);
+            carry = cur >> 32;
+        }
+        if (carry) out.limbs.push_back(uint32_t(carry));
+    }
+    out.trim();
+    return true;
+}
+
+std::string BigInt::toString() const {
+    if (limbs.empty()) return "0";
+
+    // Peel off nine decimal digits at a time
+    Limbs rest = limbs;
+    std::vector<uint32_t> chunks;
+    while (!rest.empty()) {
+        uint64_t remainder = 0;
+        for (size_t i = rest.size(); i-- > 0;) {
+            const uint64_t cur = (remainder << 32) | rest[i];
+            rest[i] = uint32_t(cur / 1000000000u);
+            remainder = cur % 1000000000u;
+        }
+        chunks.push_back(uint32_t(remainder));
+        while (!rest.empty() && rest.back() == 0) rest.pop_back();
+    }
+
+    std::string out = negative ? "-" : "";
+    out += std::to_string(chunks.back());
+    char buf[16];
+    for (size_t i = chunks.size() - 1; i-- > 0;) {
+        std::snprintf(buf, sizeof(buf), "%09u", unsigned(chunks[i]));
+        out += buf;
+    }
+    return out;
+}
+
+bool BigInt::fitsInt64() const {
+    if (limbs.size() > 2) return false;
+    uint64_t magnitude = 0;
+    for (size_t i = limbs.size(); i-- > 0;) magnitude = (magnitude << 32) | limbs[i];
+    return negative ? magnitude <= (uint64_t(1) << 63) : magnitude <= uint64_t(std::numeric_limits<int64_t>::max());
+}
+
+int64_t BigInt::toInt64() const {
+    uint64_t magnitude = 0;
+    for (size_t i = limbs.size(); i-- > 0;) magnitude = (magnitude << 32) | limbs[i];
+    return negative ? int64_t(0 - magnitude) : int64_t(magnitude);
+}
+
+double BigInt::toDouble() const {
+    const size_t bits = bitLength();
+    if (bits <= 64) {
+        uint64_t magnitude = 0;
+        for (size_t i = limbs.size(); i-- > 0;) magnitude = (magnitude << 32) | limbs[i];
+        return negative ? -double(magnitude) : double(magnitude);
+    }
+
+    // Keep the top 64 bits and fold the rest into a sticky low bit, so the
+    // single uint64-to-double conversion rounds like Python does
+    const size_t shift = bits - 64;
+    const size_t k = shift / 32;
+    const int offset = int(shift % 32);
+    const uint64_t low = limbs[k] | (uint64_t(limbs[k + 1]) << 32);
+    const uint64_t high = k + 2 < limbs.size() ? limbs[k + 2] : 0;
+    uint64_t top = offset ? (low >> offset) | (high << (64 - offset)) : low;
+
+    bool sticky = offset && (limbs[k] & ((uint32_t(1) << offset) - 1)) != 0;
+    for (size_t i = 0; i < k && !sticky; ++i) sticky = limbs[i] != 0;
+    if (sticky) top |= 1;
+
+    const double magnitude = shift > 2048 ? HUGE_VAL : std::ldexp(double(top), int(shift));
+    return negative ? -magnitude : magnitude;
+}
+
+size_t BigInt::bitLength() const {
+    if (limbs.empty()) return 0;
+    return limbs.size() * 32 - size_t(leadingZeros32(limbs.back()));
+}
+
+int BigInt::compareMagnitude(const Limbs& a, const Limbs& b) {
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (size_t i = a.size(); i-- > 0;) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+int BigInt::compare(const BigInt& a, const BigInt& b) {
+    if (a.negative != b.negative) return a.negative ? -1 : 1;
+    const int magnitude = compareMagnitude(a.limbs, b.limbs);
+    return a.negative ? -magnitude : magnitude;
+}
+
+BigInt::Limbs BigInt::addMagnitude(const Limbs& a, const Limbs& b) {
+    const Limbs& longer = a.size() >= b.size() ? a : b;
+    const Limbs& shorter = a.size() >= b.size() ? b : a;
+    Limbs sum(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        const uint64_t cur = uint64_t(longer[i]) + (i < shorter.size() ? shorter[i] : 0) + carry;
+        sum[i] = uint32_t(cur);
+        carry = cur >> 32;
+    }
+    sum[longer.size()] = uint32_t(carry);
+    return sum;
+}
+
+BigInt::Limbs BigInt::subMagnitude(const Limbs& a, const Limbs& b) {
+    Limbs difference(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        int64_t cur = int64_t(a[i]) - (i < b.size() ? int64_t(b[i]) : 0) - borrow;
+        borrow = cur < 0;
+        if (cur < 0) cur += int64_t(1) << 32;
+        difference[i] = uint32_t(cur);
+    }
+    return difference;
+}
+
+BigInt::Limbs BigInt::mulMagnitude(const Limbs& a, const Limbs& b) {
+    Limbs product(a.size() + b.size(), 0);
+    for (size_t i = 0; i < a.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < b.size(); ++j) {
+            const uint64_t cur = uint64_t(a[i]) * b[j] + product[i + j] + carry;
+            product[i + j] = uint32_t(cur);
+            carry = cur >> 32;
+        }
+        product[i + b.size()] = uint32_t(carry);
+    }
+    return product;
+}
+
+// Truncating division of magnitudes (Knuth, TAOCP vol. 2, algorithm D)
+void BigInt::divModMagnitude(const Limbs& a, const Limbs& b, Limbs& q, Limbs& r) {
+    if (compareMagnitude(a, b) < 0) {
+        q.clear();
+        r = a;
+        return;
+    }
+
+    if (b.size() == 1) {
+        q.assign(a.size(), 0);
+        uint64_t remainder = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            const uint64_t cur = (remainder << 32) | a[i];
+            q[i] = uint32_t(cur / b[0]);
+            remainder = cur % b[0];
+        }
+        r.clear();
+        if (remainder) r.push_back(uint32_t(remainder));
+        return;
+    }
+
+    // Normalize so the divisor's top limb has its high bit set
+    const size_t n = b.size();
+    const size_t m = a.size() - n;
+    const int s = leadingZeros32(b.back());
+    Limbs v(n), u(a.size() + 1);
+    for (size_t i = n - 1; i > 0; --i) {
+        v[i] = (b[i] << s) | (s ? b[i - 1] >> (32 - s) : 0);
+    }
+    v[0] = b[0] << s;
+    u[a.size()] = s ? a.back() >> (32 - s) : 0;
+    for (size_t i = a.size() - 1; i > 0; --i) {
+        u[i] = (a[i] << s) | (s ? a[i - 1] >> (32 - s) : 0);
+    }
+    u[0] = a[0] << s;
+
+    const uint64_t base = uint64_t(1) << 32;
+    q.assign(m + 1, 0);
+    for (size_t j = m + 1; j-- > 0;) {
+        // Estimate the quotient digit from the top two limbs
+        const uint64_t numerator = (uint64_t(u[j + n]) << 32) | u[j + n - 1];
+        uint64_t qhat = numerator / v[n - 1];
+        uint64_t rhat = numerator % v[n - 1];
+        while (qhat >= base || qhat * v[n - 2] > ((rhat << 32) | u[j + n - 2])) {
+            --qhat;
+            rhat += v[n - 1];
+            if (rhat >= base) break;
+        }
+
+        // Multiply and subtract
+        int64_t borrow = 0;
+        int64_t t = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const uint64_t p = qhat * v[i];
+            t = int64_t(u[i + j]) - borrow - int64_t(p & 0xFFFFFFFFu);
+            u[i + j] = uint32_t(t);
+            borrow = int64_t(p >> 32) - (t >> 32);
+        }
+        t = int64_t(u[j + n]) - borrow;
+        u[j + n] = uint32_t(t);
+
+        q[j] = uint32_t(qhat);
+        if (t < 0) {
+            // The estimate was one too large; add the divisor back
+            q[j]--;
+            uint64_t carry = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const uint64_t cur = uint64_t(u[i + j]) + v[i] + carry;
+                u[i + j] = uint32_t(cur);
+                carry = cur >> 32;
+            }
+            u[j + n] = uint32_t(uint64_t(u[j + n]) + carry);
+        }
+    }
+
+    // Unnormalize the remainder
+    r.assign(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        r[i] = (u[i] >> s) | (s ? u[i + 1] << (32 - s) : 0);
+    }
+}
+
+BigInt BigInt::signedSum(const BigInt& a, const BigInt& b, bool negateB) {
+    const bool bNegative = b.isZero() ? false : b.negative != negateB;
+    BigInt result;
+    if (a.negative == bNegative) {
+        result.limbs = addMagnitude(a.limbs, b.limbs);
+        result.negative = a.negative;
+    } else if (compareMagnitude(a.limbs, b.limbs) >= 0) {
+        result.limbs = subMagnitude(a.limbs, b.limbs);
+        result.negative = a.negative;
+    } else {
+        result.limbs = subMagnitude(b.limbs, a.limbs);
+        result.negative = bNegative;
+    }
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::shiftLeft(const BigInt& a, size_t bits) {
+    if (a.isZero()) return a;
+    BigInt result;
+    const size_t whole = bits / 32;
+    const int offset = int(bits % 32);
+    result.limbs.assign(whole, 0);
+    uint32_t carry = 0;
+    for (uint32_t limb : a.limbs) {
+        result.limbs.push_back(offset ? (limb << offset) | carry : limb);
+        carry = offset ? limb >> (32 - offset) : 0;
+    }
+    if (carry) result.limbs.push_back(carry);
+    result.negative = a.negative;
+    return result;
+}
+
+BigInt BigInt::negate(const BigInt& a) {
+    BigInt result = a;
+    if (!result.isZero()) result.negative = !result.negative;
+    return result;
+}
+
+BigInt BigInt::add(const BigInt& a, const BigInt& b) { return signedSum(a, b, false); }
+BigInt BigInt::sub(const BigInt& a, const BigInt& b) { return signedSum(a, b, true); }
+
+BigInt BigInt::mul(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    result.limbs = mulMagnitude(a.limbs, b.limbs);
+    result.negative = a.negative != b.negative;
+    result.trim();
+    return result;
+}
+
+void BigInt::divMod(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder) {
+    BigInt q, r;
+    divModMagnitude(a.limbs, b.limbs, q.limbs, r.limbs);
+    q.negative = a.negative != b.negative;
+    r.negative = a.negative;
+    q.trim();
+    r.trim();
+
+    // Truncation rounds toward zero; Python floors
+    if (!r.isZero() && r.negative != b.negative) {
+        q = sub(q, BigInt(1));
+        r = add(r, b);
+    }
+    quotient = std::move(q);
+    remainder = std::move(r);
+}
+
+//——— Integer ———
+
+Integer::Integer(const BigInt& value) {
+    if (value.fitsInt64()) {
+        small = value.toInt64();
+    } else {
+        big = std::make_shared<const BigInt>(value);
+    }
+}
+
+bool Integer::parse(const std::string& digits, int base, Integer& out) {
+    if (digits.empty()) return false;
+    errno = 0;
+    char* end = nullptr;
+    const long long value = std::strtoll(digits.c_str(), &end, base);
+    if (errno != ERANGE && end == digits.c_str() + digits.size() && digitValue(digits[0]) < base) {
+        out = Integer(int64_t(value));
+        return true;
+    }
+    BigInt wide;
+    if (!BigInt::parse(digits, base, wide)) return false;
+    out = Integer(wide);
+    return true;
+}
+
+std::string Integer::toString() const {
+    return big ? big->toString() : std::to_string(small);
+}
+
+double Integer::toDouble() const {
+    return big ? big->toDouble() : double(small);
+}
+
+size_t Integer::bitLength() const {
+    if (big) return big->bitLength();
+    uint64_t magnitude = small < 0 ? 0 - uint64_t(small) : uint64_t(small);
+    size_t bits = 0;
+    while (magnitude) {
+        ++bits;
+        magnitude >>= 1;
+    }
+    return bits;
+}
+
+int Integer::compare(const Integer& a, const Integer& b) {
+    if (!a.big && !b.big) return (a.small > b.small) - (a.small < b.small);
+    return BigInt::compare(a.toBigInt(), b.toBigInt());
+}
+
+Integer Integer::mod(const Integer& a, const Integer& b) {
+    if (!a.big && !b.big) return Integer(floorMod(a.small, b.small));
+    BigInt quotient, remainder;
+    BigInt::divMod(a.toBigInt(), b.toBigInt(), quotient, remainder);
+    return Integer(remainder);
+}
+
+bool Integer::pow(const Integer& base, const Integer& exponent, Integer& out) {
+    if (exponent.isZero() || (base.isSmall() && base.smallValue() == 1)) {
+        out = Integer(1);
+        return true;
+    }
+    if (base.isSmall() && (base.smallValue() == 0 || base.smallValue() == -1)) {
+        const bool odd = exponent.big ? exponent.big->toString().back() % 2 : exponent.small % 2;
+        out = Integer(base.smallValue() == 0 ? 0 : (odd ? -1 : 1));
+        return true;
+    }
+    if (!exponent.isSmall() || uint64_t(exponent.smallValue()) > MAX_POW_BITS ||
+        (base.bitLength() - 1) * uint64_t(exponent.smallValue()) > MAX_POW_BITS) {
+        return false;
+    }
+
+    // Square and multiply; stays inline until a step overflows
+    uint64_t e = uint64_t(exponent.smallValue());
+    Integer result(1);
+    Integer factor = base;
+    while (true) {
+        if (e & 1) result = result * factor;
+        e >>= 1;
+        if (!e) break;
+        factor = factor * factor;
+    }
+    out = std::move(result);
+    return true;
+}
+
+//——— Mixed arithmetic ———
+
+namespace {
+
+// int / int rounded once, as Python does, rather than after converting
+// both operands (b != 0)
+bool trueDivide(const Integer& a, const Integer& b, double& out, std::string& error) {
+    const int64_t exact = int64_t(1) << 53;
+    if (a.isSmall() && b.isSmall() && a.smallValue() <= exact && a.smallValue() >= -exact &&
+        b.smallValue() <= exact && b.smallValue() >= -exact) {
+        out = double(a.smallValue()) / double(b.smallValue());
+        return true;
+    }
+
+    // Scale so the integer quotient has 55 or 56 bits; a non-zero remainder
+    // becomes a sticky bit below the rounding position
+    const bool negative = a.isNegative() != b.isNegative();
+    BigInt x = a.toBigInt(), y = b.toBigInt();
+    if (x.isNegative()) x = BigInt::negate(x);
+    if (y.isNegative()) y = BigInt::negate(y);
+    const long exponent = long(x.bitLength()) - long(y.bitLength()) - 55;
+    if (exponent >= 0) {
+        y = BigInt::shiftLeft(y, size_t(exponent));
+    } else {
+        x = BigInt::shiftLeft(x, size_t(-exponent));
+    }
+    BigInt quotient, remainder;
+    BigInt::divMod(x, y, quotient, remainder);
+    uint64_t mantissa = uint64_t(quotient.toInt64());
+    if (!remainder.isZero()) mantissa |= 1;
+
+    if (exponent > 1100) {
+        error = "integer division result too large for a float";
+        return false;
+    }
+    out = exponent < -1200 ? 0.0 : std::ldexp(double(mantissa), int(exponent));
+    if (std::isinf(out)) {
+        error = "integer division result too large for a float";
+        return false;
+    }
+    if (negative) out = -out;
+    return true;
+}
+
+bool toFloat(const Numeric& n, double& out, std::string& error) {
+    out = n.isFloat ? n.f : n.i.toDouble();
+    if (!n.isFloat && std::isinf(out)) {
+        error = "int too large to convert to float";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool applyArithmetic(ArithOp op, const Numeric& a, const Numeric& b, Numeric& out, std::string& error) {
+    if (!a.isFloat && !b.isFloat) {
+        const Integer& x = a.i;
+        const Integer& y = b.i;
+        switch (op) {
+        case ArithOp::Add: out = Numeric::integer(x + y); return true;
+        case ArithOp::Sub: out = Numeric::integer(x - y); return true;
+        case ArithOp::Mul: out = Numeric::integer(x * y); return true;
+        case ArithOp::Mod:
+            if (y.isZero()) {
+                error = "integer modulo by zero";
+                return false;
+            }
+            out = Numeric::integer(Integer::mod(x, y));
+            return true;
+        case ArithOp::Div: {
+            if (y.isZero()) {
+                error = "division by zero";
+                return false;
+            }
+            double quotient = 0.0;
+            if (!trueDivide(x, y, quotient, error)) return false;
+            out = Numeric::real(quotient);
+            return true;
+        }
+        case ArithOp::Pow: {
+            if (!y.isNegative()) {
+                Integer result;
+                if (!Integer::pow(x, y, result)) {
+                    error = "integer result of ** too large";
+                    return false;
+                }
+                out = Numeric::integer(std::move(result));
+                return true;
+            }
+            break;  // a negative exponent gives a float
+        }
+        }
+    }
+
+    double x = 0.0, y = 0.0;
+    if (!toFloat(a, x, error) || !toFloat(b, y, error)) return false;
+
+    switch (op) {
+    case ArithOp::Add: out = Numeric::real(x + y); return true;
+    case ArithOp::Sub: out = Numeric::real(x - y); return true;
+    case ArithOp::Mul: out = Numeric::real(x * y); return true;
+    case ArithOp::Div:
+        if (y == 0.0) {
+            error = "float division by zero";
+            return false;
+        }
+        out = Numeric::real(x / y);
+        return true;
+    case ArithOp::Mod: {
+        if (y == 0.0) {
+            error = "float modulo";
+            return false;
+        }
+        double m = std::fmod(x, y);
+        if (m != 0.0) {
+            if ((m < 0) != (y < 0)) m += y;
+        } else {
+            m = std::copysign(0.0, y);
+        }
+        out = Numeric::real(m);
+        return true;
+    }
+    case ArithOp::Pow: {
+        if (x == 0.0 && y < 0.0) {
+            error = "0.0 cannot be raised to a negative power";
+            return false;
+        }
+        if (x < 0.0 && std::isfinite(y) && y != std::floor(y)) {
+            error = "negative number cannot be raised to a fractional power";
+            return false;
+        }
+        const double result = std::pow(x, y);
+        if (std::isinf(result) && std::isfinite(x) && std::isfinite(y)) {
+            error = "Numerical result out of range";
+            return false;
+        }
+        out = Numeric::real(result);
+        return true;
+    }
+    }
+    return false;
+}
+
+int compareNumeric(const Numeric& a, const Numeric& b, bool& unordered) {
+    unordered = false;
+    if (!a.isFloat && !b.isFloat) return Integer::compare(a.i, b.i);
+
+    // Huge ints convert to +-inf, which still orders them against floats
+    const double x = a.isFloat ? a.f : a.i.toDouble();
+    const double y = b.isFloat ? b.f : b.i.toDouble();
+    if (std::isnan(x) || std::isnan(y)) {
+        unordered = true;
+        return 0;
+    }
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,169 @@
+// numeric.h
+#ifndef NUMERIC_H
+#define NUMERIC_H
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 64-bit integer arithmetic that reports overflow instead of wrapping
+inline bool addOverflows(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_add_overflow(a, b, &out);
+#else
+    if ((b > 0 && a > std::numeric_limits<int64_t>::max() - b) ||
+        (b < 0 && a < std::numeric_limits<int64_t>::min() - b)) return true;
+    out = a + b;
+    return false;
+#endif
+}
+
+inline bool subOverflows(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_sub_overflow(a, b, &out);
+#else
+    if ((b < 0 && a > std::numeric_limits<int64_t>::max() + b) ||
+        (b > 0 && a < std::numeric_limits<int64_t>::min() + b)) return true;
+    out = a - b;
+    return false;
+#endif
+}
+
+inline bool mulOverflows(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_mul_overflow(a, b, &out);
+#else
+    if (a != 0 && b != 0) {
+        if (a == -1 || b == -1) {
+            if (a == std::numeric_limits<int64_t>::min() || b == std::numeric_limits<int64_t>::min()) return true;
+        } else if ((a < 0 ? -a : a) > std::numeric_limits<int64_t>::max() / (b < 0 ? -b : b)) {
+            return true;
+        }
+    }
+    out = a * b;
+    return false;
+#endif
+}
+
+// Python's %: the result takes the sign of the divisor (b != 0)
+inline int64_t floorMod(int64_t a, int64_t b) {
+    if (b == -1) return 0;
+    int64_t r = a % b;
+    if (r != 0 && ((r < 0) != (b < 0))) r += b;
+    return r;
+}
+
+// Python repr() of a float: the shortest text that reads back as `d`
+std::string formatFloat(double d);
+
+// Arbitrary-precision signed integer: a sign and a magnitude in base 2^32
+// limbs, least significant first, with no leading zero limbs
+class BigInt {
+public:
+    BigInt() = default;
+    explicit BigInt(int64_t value);
+
+    // `digits` holds digits of `base` (2 to 16) only: no sign or prefix
+    static bool parse(const std::string& digits, int base, BigInt& out);
+    std::string toString() const;
+
+    bool isZero() const { return limbs.empty(); }
+    bool isNegative() const { return negative; }
+    bool fitsInt64() const;
+    int64_t toInt64() const;    // only when fitsInt64()
+    double toDouble() const;    // correctly rounded; +-inf beyond the double range
+    size_t bitLength() const;
+
+    static int compare(const BigInt& a, const BigInt& b);
+    static BigInt add(const BigInt& a, const BigInt& b);
+    static BigInt sub(const BigInt& a, const BigInt& b);
+    static BigInt mul(const BigInt& a, const BigInt& b);
+    static BigInt shiftLeft(const BigInt& a, size_t bits);
+    static BigInt negate(const BigInt& a);
+    // Floor division and modulo as in Python; b must not be zero
+    static void divMod(const BigInt& a, const BigInt& b, BigInt& quotient, BigInt& remainder);
+
+private:
+    using Limbs = std::vector<uint32_t>;
+    Limbs limbs;
+    bool negative = false;
+
+    void trim();
+    static int compareMagnitude(const Limbs& a, const Limbs& b);
+    static Limbs addMagnitude(const Limbs& a, const Limbs& b);
+    static Limbs subMagnitude(const Limbs& a, const Limbs& b);   // |a| >= |b|
+    static Limbs mulMagnitude(const Limbs& a, const Limbs& b);
+    static void divModMagnitude(const Limbs& a, const Limbs& b, Limbs& q, Limbs& r);
+    static BigInt signedSum(const BigInt& a, const BigInt& b, bool negateB);
+};
+
+// Python int. Values that fit in 64 bits are stored inline and their
+// arithmetic is done in place; only results that overflow are promoted to
+// a (shared, immutable) BigInt, so small-int operations never allocate.
+class Integer {
+public:
+    Integer(int64_t value = 0) : small(value) {}
+    explicit Integer(const BigInt& value);
+
+    static bool parse(const std::string& digits, int base, Integer& out);
+
+    bool isSmall() const { return !big; }
+    int64_t smallValue() const { return small; }
+    BigInt toBigInt() const { return big ? *big : BigInt(small); }
+
+    std::string toString() const;
+    double toDouble() const;
+    bool isZero() const { return !big && small == 0; }
+    bool isNegative() const { return big ? big->isNegative() : small < 0; }
+    size_t bitLength() const;
+
+    static int compare(const Integer& a, const Integer& b);
+
+    friend Integer operator+(const Integer& a, const Integer& b) {
+        int64_t r;
+        if (!a.big && !b.big && !addOverflows(a.small, b.small, r)) return Integer(r);
+        return Integer(BigInt::add(a.toBigInt(), b.toBigInt()));
+    }
+    friend Integer operator-(const Integer& a, const Integer& b) {
+        int64_t r;
+        if (!a.big && !b.big && !subOverflows(a.small, b.small, r)) return Integer(r);
+        return Integer(BigInt::sub(a.toBigInt(), b.toBigInt()));
+    }
+    friend Integer operator*(const Integer& a, const Integer& b) {
+        int64_t r;
+        if (!a.big && !b.big && !mulOverflows(a.small, b.small, r)) return Integer(r);
+        return Integer(BigInt::mul(a.toBigInt(), b.toBigInt()));
+    }
+    // Python %; b must not be zero
+    static Integer mod(const Integer& a, const Integer& b);
+    // Python ** for exponent >= 0; false if the result would be too large
+    static bool pow(const Integer& base, const Integer& exponent, Integer& out);
+
+private:
+    int64_t small = 0;
+    std::shared_ptr<const BigInt> big;  // set only when the value needs more than 64 bits
+};
+
+// An int or a float operand of Python arithmetic
+struct Numeric {
+    bool isFloat = false;
+    Integer i;
+    double f = 0.0;
+
+    static Numeric integer(Integer v) { Numeric n; n.i = std::move(v); return n; }
+    static Numeric real(double v)     { Numeric n; n.isFloat = true; n.f = v; return n; }
+};
+
+enum class ArithOp { Add, Sub, Mul, Div, Mod, Pow };
+
+// Applies `op` with Python semantics (int op int stays exact except for
+// '/', a float on either side gives a float). Returns false with Python's
+// message where Python would raise.
+bool applyArithmetic(ArithOp op, const Numeric& a, const Numeric& b, Numeric& out, std::string& error);
+
+// -1, 0 or 1; `unordered` is set instead when a NaN is involved
+int compareNumeric(const Numeric& a, const Numeric& b, bool& unordered);
+
+#endif // NUMERIC_H
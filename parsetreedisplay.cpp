@@ -6,18 +6,33 @@
 #include <QDebug>
 #include <QScrollBar>
 #include <QApplication>
+#include <vector>
+#include <algorithm>
+#include <QFontMetricsF>
+#include <QHash>
+#include <QElapsedTimer>
+#include "treelayout.h"
+
+// Longest stretch the GUI thread spends copying a tree before it lets
+// other events through
+static const qint64 SNAPSHOT_SLICE_MS = 8;
 
 ParseTreeDisplay::ParseTreeDisplay(QWidget* parent)
-    : QGraphicsView(parent), root(nullptr), zoomFactor(1.0)
+    : QGraphicsView(parent), collapseBelow(DEFAULT_COLLAPSE_DEPTH), zoomFactor(1.0)
 {
-    // Create a new scene
+    // Create a new scene; it holds one item, so it needs no index
     scene = new QGraphicsScene(this);
+    scene->setItemIndexMethod(QGraphicsScene::NoIndex);
     setScene(scene);
+    treeItem = new ParseTreeItem();
+    scene->addItem(treeItem);
 
-    // Configure view
+    // Configure view; the item paints only what is exposed, so scrolling
+    // repaints just the strip that comes into view
     setRenderHint(QPainter::Antialiasing);
     setDragMode(QGraphicsView::ScrollHandDrag);
-    setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+    setOptimizationFlag(QGraphicsView::DontSavePainterState);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
     setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
 
@@ -26,22 +41,72 @@ ParseTreeDisplay::ParseTreeDisplay(QWidget* parent)
 
     // Enable focus to receive key events
     setFocusPolicy(Qt::StrongFocus);
+
+    // Busy indicator in the corner of the view while a tree is prepared
+    progress = new QProgressBar(viewport());
+    progress->setRange(0, 0);
+    progress->setFixedWidth(160);
+    progress->setTextVisible(false);
+    progress->hide();
+
+    // The copy runs one slice per pass of the event loop
+    snapshotTimer.setInterval(0);
+    connect(&snapshotTimer, &QTimer::timeout, this, &ParseTreeDisplay::snapshotSlice);
+
+    // One worker, so a superseded layout finishes (or notices it was
+    // cancelled) before the next one starts
+    qRegisterMetaType<std::shared_ptr<LaidOutTree>>();
+    layoutPool.setMaxThreadCount(1);
+    connect(this, &ParseTreeDisplay::layoutReady, this, &ParseTreeDisplay::showLayout, Qt::QueuedConnection);
+}
+
+ParseTreeDisplay::~ParseTreeDisplay()
+{
+    // The worker refers to this view; let it stop before tearing down
+    if (activeLayout) {
+        activeLayout->cancel();
+    }
+    layoutPool.waitForDone();
 }
 
 void ParseTreeDisplay::setParseTree(ParseNode* rootNode)
 {
     clear();
+    if (!rootNode) return;
+
     root = rootNode;
-    if (root) {
-        layoutTree();
-    }
+    snapshot.nodeHeight = NODE_HEIGHT;
+    snapshot.levelHeight = NODE_HEIGHT + VERTICAL_SPACING;
+    snapshotStack.emplace_back(rootNode, -1);
+    progress->show();
+    snapshotTimer.start();
 }
 
 void ParseTreeDisplay::clear()
 {
-    scene->clear();
-    nodeMap.clear();
+    // Whatever is still being prepared would replace the empty view
+    snapshotTimer.stop();
+    snapshotStack.clear();
+    snapshot = TreeGeometry();
+    snapshotNodes.clear();
+    if (activeLayout) {
+        activeLayout->cancel();
+        activeLayout.reset();
+    }
+    ++layoutGeneration;
+    progress->hide();
+    treeItem->setGeometry(TreeGeometry(), TreeIndex());
+    shownNodes.clear();
     root = nullptr;
+    emit treeChanged();
+}
+
+void ParseTreeDisplay::setCollapseDepth(int depth)
+{
+    depth = std::max(1, depth);
+    if (depth == collapseBelow) return;
+    collapseBelow = depth;
+    if (root) setParseTree(root);
 }
 
 void ParseTreeDisplay::zoomIn()
@@ -53,6 +118,7 @@ void ParseTreeDisplay::zoomIn()
         QTransform transform;
         transform.scale(zoomFactor, zoomFactor);
         setTransform(transform);
+        emit viewChanged();
     }
 }
 
@@ -65,6 +131,7 @@ void ParseTreeDisplay::zoomOut()
         QTransform transform;
         transform.scale(zoomFactor, zoomFactor);
         setTransform(transform);
+        emit viewChanged();
     }
 }
 
@@ -77,9 +144,10 @@ void ParseTreeDisplay::resetZoom()
     setTransform(transform);
 
     // Reset view
-    if (scene->items().count() > 0) {
-        fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
+    if (hasTree()) {
+        fitInView(treeItem->boundingRect(), Qt::KeepAspectRatio);
     }
+    emit viewChanged();
 }
 
 void ParseTreeDisplay::wheelEvent(QWheelEvent* event)
@@ -144,104 +212,215 @@ void ParseTreeDisplay::keyPressEvent(QKeyEvent* event)
     QGraphicsView::keyPressEvent(event);
 }
 
+void ParseTreeDisplay::mousePressEvent(QMouseEvent* event)
+{
+    pressPos = event->position().toPoint();
+    QGraphicsView::mousePressEvent(event);
+}
+
+void ParseTreeDisplay::mouseReleaseEvent(QMouseEvent* event)
+{
+    QGraphicsView::mouseReleaseEvent(event);
+    if (event->button() == Qt::LeftButton &&
+        (event->position().toPoint() - pressPos).manhattanLength() < QApplication::startDragDistance()) {
+        toggleNode(treeItem->nodeAt(mapToScene(event->position().toPoint())));
+    }
+}
+
 void ParseTreeDisplay::resizeEvent(QResizeEvent* event)
 {
     QGraphicsView::resizeEvent(event);
-    if (scene->items().count() > 0) {
+    progress->move(8, 8);
+    if (hasTree()) {
         // Fit the view to the scene contents when resized
-        fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
+        fitInView(treeItem->boundingRect(), Qt::KeepAspectRatio);
         // Restore the current zoom factor after fitting
         QTransform transform;
         transform.scale(zoomFactor, zoomFactor);
         setTransform(transform);
     }
+    emit viewChanged();
 }
 
-void ParseTreeDisplay::layoutTree()
+void ParseTreeDisplay::scrollContentsBy(int dx, int dy)
 {
-    if (!root) return;
+    QGraphicsView::scrollContentsBy(dx, dy);
+    emit viewChanged();
+}
 
-    // First pass: calculate node positions
-    qreal maxWidth = 0;
-    calculateNodePositions(root, maxWidth);
+void ParseTreeDisplay::snapshotSlice()
+{
+    QElapsedTimer slice;
+    slice.start();
+    if (!copyNodes(snapshotStack, snapshot, snapshotNodes, &slice)) return;
 
-    // Second pass: create visual representations
-    renderNode(root);
+    snapshotTimer.stop();
+    startLayout();
+}
 
-    // Third pass: create edges
-    createEdges();
+// Pre-order walk with an explicit stack, so parents come before their
+// children, resumed where the last call stopped; returns false if `slice`
+// ran out first. Nodes collapseBelow levels under the first one, and
+// blocks the parser skipped, are copied collapsed, without their children.
+bool ParseTreeDisplay::copyNodes(std::vector<std::pair<ParseNode*, int>>& stack, TreeGeometry& geometry,
+                                 std::vector<ParseNode*>& nodes, const QElapsedTimer* slice) const
+{
+    int visited = 0;
+    while (!stack.empty()) {
+        if (slice && ++visited % 1024 == 0 && slice->elapsed() >= SNAPSHOT_SLICE_MS) return false;
+
+        auto [node, parent] = stack.back();
+        stack.pop_back();
+        if (!node) continue;
+
+        const int index = int(geometry.size());
+        const int depth = parent < 0 ? 0 : geometry.depth[size_t(parent)] + 1;
+        geometry.parent.push_back(parent);
+        geometry.depth.push_back(depth);
+        geometry.label.push_back(nodeLabel(node));
+        nodes.push_back(node);
+
+        const bool hasChildren = std::any_of(node->children.begin(), node->children.end(),
+                                             [](const ParseNode* child) { return child != nullptr; });
+        const bool collapsed = node->lazy || (hasChildren && depth >= collapseBelow);
+        geometry.collapsed.push_back(collapsed);
+        if (collapsed) continue;
+
+        // Children are pushed in reverse so they are numbered in order
+        for (int i = node->children.size() - 1; i >= 0; --i) {
+            stack.emplace_back(node->children[i], index);
+        }
+    }
+    return true;
+}
 
-    // Fit scene in view
-    scene->setSceneRect(scene->itemsBoundingRect().adjusted(-50, -50, 50, 50));
-    fitInView(scene->itemsBoundingRect(), Qt::KeepAspectRatio);
+void ParseTreeDisplay::startLayout()
+{
+    auto cancel = std::make_shared<CancellationToken>();
+    activeLayout = cancel;
+    const uint64_t generation = layoutGeneration;
+    auto geometry = std::make_shared<TreeGeometry>(std::move(snapshot));
+    snapshot = TreeGeometry();
+
+    // The parse nodes stay here, for expanding and collapsing once shown
+    shownNodes = std::move(snapshotNodes);
+    snapshotNodes.clear();
+
+    // Only the copied arrays and constants are touched from here on, never
+    // the parse tree, which the caller may free as soon as this returns
+    layoutPool.start([this, geometry, cancel, generation, font = treeItem->font()]() {
+        measureWidths(*geometry, font, *cancel);
+        if (cancel->isCancelled()) return;
+
+        // Siblings sit closer together than cousins, so families stay apparent
+        layoutTidyTree(*geometry, HORIZONTAL_SPACING, 2 * HORIZONTAL_SPACING);
+        if (cancel->isCancelled()) return;
+
+        auto result = std::make_shared<LaidOutTree>();
+        result->generation = generation;
+        result->index = TreeIndex::build(*geometry);
+        if (cancel->isCancelled()) return;
+        result->geometry = std::move(*geometry);
+        emit layoutReady(result);
+    });
 }
 
-void ParseTreeDisplay::calculateNodePositions(ParseNode* node, qreal& maxWidth, int depth)
+void ParseTreeDisplay::showLayout(std::shared_ptr<LaidOutTree> tree)
 {
-    if (!node) return;
+    // A newer tree was requested since this one started
+    if (tree->generation != layoutGeneration) return;
+    activeLayout.reset();
+    progress->hide();
 
-    GraphNode* gNode = new GraphNode();
-    nodeMap[node] = gNode;
+    treeItem->setGeometry(std::move(tree->geometry), std::move(tree->index));
 
-    // Determine node position based on children
-    if (node->children.isEmpty()) {
-        // Leaf node
-        gNode->pos = QPointF(maxWidth, depth * (NODE_HEIGHT + VERTICAL_SPACING));
-        maxWidth += NODE_WIDTH + HORIZONTAL_SPACING;
-    } else {
-        QList<QPointF> childPositions;
-        // First position all children
-        for (auto* child : node->children) {
-            calculateNodePositions(child, maxWidth, depth + 1);
-            if (nodeMap.contains(child)) {
-                childPositions.append(nodeMap[child]->pos);
-            }
-        }
+    // Fit scene in view
+    scene->setSceneRect(treeItem->boundingRect().adjusted(-50, -50, 50, 50));
+    fitInView(treeItem->boundingRect(), Qt::KeepAspectRatio);
+    emit treeChanged();
+    emit viewChanged();
+}
 
-        // Skip if no children were successfully positioned
-        if (childPositions.isEmpty()) {
-            gNode->pos = QPointF(maxWidth, depth * (NODE_HEIGHT + VERTICAL_SPACING));
-            maxWidth += NODE_WIDTH + HORIZONTAL_SPACING;
-            return;
+void ParseTreeDisplay::toggleNode(int node)
+{
+    // Nothing to toggle on a leaf, or while a tree is being prepared
+    if (node < 0 || snapshotTimer.isActive() || activeLayout) return;
+    const TreeGeometry& current = treeItem->geometry();
+    const bool expand = current.collapsed[size_t(node)];
+    const bool collapse = size_t(node) + 1 < current.size() && current.parent[size_t(node) + 1] == node;
+    if (!expand && !collapse) return;
+
+    // The new subtree of the node: down to collapseBelow levels when
+    // expanding, the node alone when collapsing
+    ParseNode* parseNode = shownNodes[size_t(node)];
+    TreeGeometry subtree;
+    subtree.nodeHeight = current.nodeHeight;
+    subtree.levelHeight = current.levelHeight;
+    std::vector<ParseNode*> nodes;
+    if (expand) {
+        if (parseNode->lazy) {
+            std::vector<SyntaxError> errors;
+            SyntaxAnalyzer::materialize(parseNode, &errors);
+            if (!errors.empty()) emit blockParsed(errors);
         }
+        std::vector<std::pair<ParseNode*, int>> stack{ { parseNode, -1 } };
+        copyNodes(stack, subtree, nodes, nullptr);
+    } else {
+        subtree.parent.push_back(-1);
+        subtree.depth.push_back(0);
+        subtree.label.push_back(current.label[size_t(node)]);
+        subtree.collapsed.push_back(true);
+        nodes.push_back(parseNode);
+    }
+    measureWidths(subtree, treeItem->font(), CancellationToken());
+    layoutTidyTree(subtree, HORIZONTAL_SPACING, 2 * HORIZONTAL_SPACING);
+
+    // Only the new subtree is laid out; the rest of the tree is fitted
+    // around it
+    const QPointF before(current.x[size_t(node)], current.y(node));
+    const QPoint viewPos = mapFromScene(before);
+    TreeGeometry next = replaceSubtree(current, treeItem->treeIndex(), node, subtree,
+                                       HORIZONTAL_SPACING, 2 * HORIZONTAL_SPACING);
+    const size_t removed = current.size() + subtree.size() - next.size();
+    shownNodes.erase(shownNodes.begin() + node, shownNodes.begin() + node + std::ptrdiff_t(removed));
+    shownNodes.insert(shownNodes.begin() + node, nodes.begin(), nodes.end());
+    const QPointF after(next.x[size_t(node)], next.y(node));
+    TreeIndex nextIndex = TreeIndex::build(next);
+    treeItem->setGeometry(std::move(next), std::move(nextIndex));
+    scene->setSceneRect(treeItem->boundingRect().adjusted(-50, -50, 50, 50));
+
+    // Keep the clicked node under the pointer
+    const QPoint drift = mapFromScene(after) - viewPos;
+    horizontalScrollBar()->setValue(horizontalScrollBar()->value() + drift.x());
+    verticalScrollBar()->setValue(verticalScrollBar()->value() + drift.y());
+    emit treeChanged();
+}
 
-        // Node is positioned at the horizontal center of its children
-        qreal leftmostX = childPositions.first().x();
-        qreal rightmostX = childPositions.last().x();
-        qreal centerX = leftmostX + (rightmostX - leftmostX) / 2;
-
-        // Ensure minimum width between siblings
-        if (rightmostX - leftmostX < NODE_WIDTH && childPositions.size() > 1) {
-            // Adjust positions to ensure minimum spacing
-            qreal totalWidth = (childPositions.size() - 1) * (NODE_WIDTH + HORIZONTAL_SPACING);
-            qreal startX = centerX - totalWidth / 2;
-
-            for (int i = 0; i < childPositions.size(); i++) {
-                ParseNode* child = node->children[i];
-                if (nodeMap.contains(child)) {
-                    GraphNode* childNode = nodeMap[child];
-                    QPointF newPos(startX + i * (NODE_WIDTH + HORIZONTAL_SPACING),
-                                   childNode->pos.y());
-                    childNode->pos = newPos;
-                }
-            }
-
-            // Recalculate center based on new positions
-            leftmostX = nodeMap[node->children.first()]->pos.x();
-            rightmostX = nodeMap[node->children.last()]->pos.x();
-            centerX = leftmostX + (rightmostX - leftmostX) / 2;
+void ParseTreeDisplay::measureWidths(TreeGeometry& geometry, const QFont& font, const CancellationToken& cancel) const
+{
+    // An ellipse holds its label when the label's corners lie inside it;
+    // widths are measured once per distinct label
+    const QFontMetricsF metrics(font);
+    const qreal textHalfHeight = std::min(metrics.height() / NODE_HEIGHT, 0.9);
+    const qreal widthPerAdvance = 1 / std::sqrt(1 - textHalfHeight * textHalfHeight);
+    QHash<QString, qreal> labelWidths;
+
+    geometry.x.assign(geometry.size(), 0);
+    geometry.width.resize(geometry.size());
+    for (size_t i = 0; i < geometry.size(); ++i) {
+        if (i % 4096 == 0 && cancel.isCancelled()) return;
+        const QString& label = geometry.label[i];
+        auto width = labelWidths.find(label);
+        if (width == labelWidths.end()) {
+            const qreal needed = metrics.horizontalAdvance(label) * widthPerAdvance + LABEL_PADDING;
+            width = labelWidths.insert(label, std::max(MIN_NODE_WIDTH, needed));
         }
-
-        gNode->pos = QPointF(centerX, depth * (NODE_HEIGHT + VERTICAL_SPACING));
+        geometry.width[i] = width.value();
     }
 }
 
-void ParseTreeDisplay::renderNode(ParseNode* node)
+QString ParseTreeDisplay::nodeLabel(const ParseNode* node)
 {
-    if (!node || !nodeMap.contains(node)) return;
-
-    GraphNode* gNode = nodeMap[node];
-
     // Create visual representation with clearer labeling
     QString label;
 
@@ -266,114 +445,5 @@ void ParseTreeDisplay::renderNode(ParseNode* node)
     if (label.isEmpty()) {
         label = "Unknown";
     }
-
-    createNodeShape(gNode, label);
-
-    // Recursively render children
-    for (auto* child : node->children) {
-        renderNode(child);
-    }
-}
-
-void ParseTreeDisplay::createNodeShape(GraphNode* gNode, const QString& label)
-{
-    // Create ellipse shape
-    QPen outlinePen(Qt::black, 2);
-    QBrush fillBrush(Qt::white);
-
-    gNode->shape = scene->addEllipse(
-        gNode->pos.x() - NODE_WIDTH/2,
-        gNode->pos.y() - NODE_HEIGHT/2,
-        NODE_WIDTH,
-        NODE_HEIGHT,
-        outlinePen,
-        fillBrush
-        );
-
-    // Add text label with black color and proper font
-    QFont labelFont("Arial", 10, QFont::Bold);
-    gNode->text = scene->addText(label, labelFont);
-    gNode->text->setDefaultTextColor(Qt::black);
-
-    // Center text in the ellipse
-    QRectF textRect = gNode->text->boundingRect();
-    gNode->text->setPos(
-        gNode->pos.x() - textRect.width()/2,
-        gNode->pos.y() - textRect.height()/2
-        );
-}
-
-void ParseTreeDisplay::createEdges()
-{
-    // Create edges between nodes
-    for (auto it = nodeMap.begin(); it != nodeMap.end(); ++it) {
-        ParseNode* node = it.key();
-        GraphNode* gNode = it.value();
-
-        for (auto* child : node->children) {
-            if (nodeMap.contains(child)) {
-                GraphNode* childGNode = nodeMap[child];
-
-                // Get the positions of the parent and child nodes
-                QPointF parentPos = gNode->pos;
-                QPointF childPos = childGNode->pos;
-
-                // Calculate the angle between the centers
-                qreal dx = childPos.x() - parentPos.x();
-                qreal dy = childPos.y() - parentPos.y();
-                qreal angle = std::atan2(dy, dx);
-
-                // For ellipses, we need to account for the different widths and heights
-                // We use parametric form where x = a*cos(t), y = b*sin(t)
-                // and find the t value where the line from center intersects
-
-                // Calculate the starting point (edge of parent ellipse)
-                // For an ellipse: (x/a)² + (y/b)² = 1
-                // Using the angle, we find the point on the ellipse in that direction
-                qreal a = NODE_WIDTH / 2;  // semi-major axis (half width)
-                qreal b = NODE_HEIGHT / 2; // semi-minor axis (half height)
-
-                // t is the parameter where the ray intersects the ellipse
-                // For an ellipse, we can find t where the ray intersects using:
-                qreal startRatio = 1.0 / std::sqrt((cos(angle)*cos(angle))/(a*a) + (sin(angle)*sin(angle))/(b*b));
-                qreal startX = parentPos.x() + startRatio * cos(angle);
-                qreal startY = parentPos.y() + startRatio * sin(angle);
-
-                // Calculate the endpoint (edge of child ellipse)
-                // We use π + angle to get the opposite direction
-                qreal endAngle = angle + M_PI;
-                qreal endRatio = 1.0 / std::sqrt((cos(endAngle)*cos(endAngle))/(a*a) + (sin(endAngle)*sin(endAngle))/(b*b));
-                qreal endX = childPos.x() + endRatio * cos(endAngle);
-                qreal endY = childPos.y() + endRatio * sin(endAngle);
-
-                // Create the edge connecting the ellipse boundaries
-                QLineF line(startX, startY, endX, endY);
-                QPen edgePen(Qt::black, 1.5);
-
-                QGraphicsLineItem* edge = scene->addLine(line, edgePen);
-
-                // Add arrowhead at the child's end - make it larger and more visible
-                const qreal arrowSize = 12;  // Slightly larger arrows
-
-                // Calculate angle of the edge line itself
-                qreal edgeAngle = std::atan2(line.dy(), line.dx());
-
-                QPointF arrowP1 = line.p2() - QPointF(cos(edgeAngle + M_PI/6) * arrowSize,
-                                                      sin(edgeAngle + M_PI/6) * arrowSize);
-                QPointF arrowP2 = line.p2() - QPointF(cos(edgeAngle - M_PI/6) * arrowSize,
-                                                      sin(edgeAngle - M_PI/6) * arrowSize);
-
-                QPolygonF arrowHead;
-                arrowHead.append(line.p2());
-                arrowHead.append(arrowP1);
-                arrowHead.append(arrowP2);
-
-                // Add the filled arrow head
-                scene->addPolygon(arrowHead, edgePen, QBrush(Qt::black));
-
-                // Store the edge
-                gNode->edges.append(edge);
-            }
-        }
-    }
+    return label;
 }
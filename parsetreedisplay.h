@@ -3,49 +3,102 @@
 
 #include <QGraphicsView>
 #include <QGraphicsScene>
-#include <QGraphicsEllipseItem>
-#include <QGraphicsTextItem>
-#include <QGraphicsLineItem>
-#include <QMap>
 #include <QWheelEvent>
 #include <QKeyEvent>
+#include <QMouseEvent>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QProgressBar>
+#include <QThreadPool>
+#include <QTimer>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cancellation.h"
+#include "parsetreeitem.h"
 #include "syntaxanalyzer.h" // For ParseNode
 
-// Node representation in the graphical display
-struct GraphNode {
-    QGraphicsEllipseItem* shape;
-    QGraphicsTextItem* text;
-    QPointF pos;
-    QList<QGraphicsLineItem*> edges;
+// A tree laid out by the layout worker, ready to be painted
+struct LaidOutTree {
+    uint64_t generation = 0;    // request this answers; older ones are stale
+    TreeGeometry geometry;
+    TreeIndex index;
 };
 
+Q_DECLARE_METATYPE(std::shared_ptr<LaidOutTree>)
+
 class ParseTreeDisplay : public QGraphicsView {
     Q_OBJECT
 
 public:
     explicit ParseTreeDisplay(QWidget* parent = nullptr);
+    ~ParseTreeDisplay();
 
-    // Set the root node of the parse tree to display
+    // Start showing the parse tree below `rootNode`, replacing whatever is
+    // shown or still being laid out. The tree is copied in slices between
+    // events and laid out on a worker thread. Clicking a node expands or
+    // collapses it, which reads the tree again, so it must stay alive until
+    // clear() is called.
     void setParseTree(ParseNode* rootNode);
 
-    // Clear the display
+    // Clear the display, cancelling a layout in progress
     void clear();
 
+    // Levels shown below the root, and below a node when it is expanded;
+    // deeper nodes start out collapsed. Changing it lays the tree out again.
+    void setCollapseDepth(int depth);
+    int collapseDepth() const { return collapseBelow; }
+
+    // The tree shown, laid out, and the scene rectangle it covers
+    const TreeGeometry& treeGeometry() const { return treeItem->geometry(); }
+    QRectF treeBounds() const { return treeItem->boundingRect(); }
+
     // Zoom functions
     void zoomIn();
     void zoomOut();
     void resetZoom();
 
+signals:
+    // Emitted from the layout worker thread
+    void layoutReady(std::shared_ptr<LaidOutTree> tree);
+
+    // Expanding an unparsed block parsed it and found these
+    void blockParsed(const std::vector<SyntaxError>& errors);
+
+    // The tree shown was replaced or changed shape
+    void treeChanged();
+
+    // The part of the scene in view moved or was zoomed
+    void viewChanged();
+
 private:
     QGraphicsScene* scene;
-    ParseNode* root;
-    QMap<ParseNode*, GraphNode*> nodeMap;
+    ParseTreeItem* treeItem;    // paints the whole tree
+    QProgressBar* progress;     // shown while a tree is being prepared
+
+    // The tree shown, and the parse node behind each node of the geometry
+    ParseNode* root = nullptr;
+    std::vector<ParseNode*> shownNodes;
+    int collapseBelow;
+    QPoint pressPos;            // a click toggles, a drag scrolls
+
+    // A new tree is copied into flat arrays a slice at a time on the GUI
+    // thread, then measured, laid out and indexed on the worker
+    QTimer snapshotTimer;
+    std::vector<std::pair<ParseNode*, int>> snapshotStack;  // node, index of its parent
+    TreeGeometry snapshot;
+    std::vector<ParseNode*> snapshotNodes;
+    QThreadPool layoutPool;
+    std::shared_ptr<CancellationToken> activeLayout;     // layout in flight
+    uint64_t layoutGeneration = 0;                      // latest request
 
     // Constants for layout
-    const qreal NODE_WIDTH = 150;
+    const qreal MIN_NODE_WIDTH = 60;    // nodes are as wide as their label needs
+    const qreal LABEL_PADDING = 20;
     const qreal NODE_HEIGHT = 50;
     const qreal VERTICAL_SPACING = 80;
     const qreal HORIZONTAL_SPACING = 20;
+    const int DEFAULT_COLLAPSE_DEPTH = 6;
 
     // Zoom settings
     qreal zoomFactor;
@@ -54,22 +107,34 @@ private:
     const qreal MAX_ZOOM = 5.0;
     const qreal MIN_ZOOM = 0.1;
 
-    // Calculate positions and layout tree
-    void layoutTree();
-    void calculateNodePositions(ParseNode* node, qreal& maxWidth, int depth = 0);
-    void renderNode(ParseNode* node);
-    void createNodeShape(GraphNode* gNode, const QString& label);
-    void createEdges();
+    void snapshotSlice();
+    bool copyNodes(std::vector<std::pair<ParseNode*, int>>& stack, TreeGeometry& geometry,
+                   std::vector<ParseNode*>& nodes, const QElapsedTimer* slice) const;
+    void startLayout();
+    void showLayout(std::shared_ptr<LaidOutTree> tree);
+    void toggleNode(int node);
+    bool hasTree() const { return treeItem->geometry().size() > 0; }
+
+    // Runs on the worker
+    void measureWidths(TreeGeometry& geometry, const QFont& font, const CancellationToken& cancel) const;
+    static QString nodeLabel(const ParseNode* node);
 
 protected:
     // Handle resize events
     void resizeEvent(QResizeEvent* event) override;
 
+    // Scrolling, by any means, moves the part in view
+    void scrollContentsBy(int dx, int dy) override;
+
     // Mouse wheel event for zooming
     void wheelEvent(QWheelEvent* event) override;
 
     // Key press event for keyboard zoom controls
     void keyPressEvent(QKeyEvent* event) override;
+
+    // A click on a node expands or collapses it
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
 };
 
 #endif // PARSETREEDISPLAY_H
@@ -0,0 +1,373 @@
+// parsetreeitem.cpp
+#include "parsetreeitem.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+
+// Node height on screen below which labels are left out
+static const qreal LABEL_MIN_PIXELS = 14;
+
+// Nodes or levels closer than this on screen are shaded by density instead
+static const qreal DENSITY_PIXELS = 4;
+
+// Levels looked at per shaded band of levels, and the faintest shade
+static const int MAX_SAMPLED_LEVELS = 4;
+static const int MIN_DENSITY_ALPHA = 48;
+
+// Labels are laid out once per distinct text; past this many the cache is
+// dropped rather than kept for labels long scrolled away
+static const int MAX_CACHED_LABELS = 20000;
+
+// Fill of a node whose children are hidden
+static const QColor COLLAPSED_FILL(215, 215, 215);
+
+ParseTreeItem::ParseTreeItem(QGraphicsItem* parent)
+    : QGraphicsItem(parent), labelFont("Arial", 10, QFont::Bold)
+{
+    // paint() needs the exposed rectangle to skip what is out of view
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+TreeIndex TreeIndex::build(const TreeGeometry& tree)
+{
+    TreeIndex index;
+    const size_t count = tree.size();
+    if (count == 0) return index;
+
+    std::vector<int>& levelStart = index.levelStart;
+    std::vector<int>& byLevel = index.byLevel;
+    std::vector<qreal>& levelX = index.levelX;
+    std::vector<qreal>& levelHalfWidth = index.levelHalfWidth;
+
+    // Bucket the nodes by level, then order each level by x. Pre-order
+    // numbering already leaves a tidy layout sorted, so most levels are
+    // only checked.
+    int levels = 0;
+    for (int d : tree.depth) levels = std::max(levels, d + 1);
+    levelStart.assign(size_t(levels) + 1, 0);
+    for (int d : tree.depth) ++levelStart[size_t(d) + 1];
+    for (int d = 0; d < levels; ++d) levelStart[size_t(d) + 1] += levelStart[size_t(d)];
+
+    byLevel.resize(count);
+    std::vector<int> next(levelStart.begin(), levelStart.end() - 1);
+    for (size_t i = 0; i < count; ++i) byLevel[size_t(next[size_t(tree.depth[i])]++)] = int(i);
+
+    levelX.resize(count);
+    levelHalfWidth.assign(size_t(levels), 0);
+    qreal left = tree.x[0];
+    qreal right = tree.x[0];
+    for (int d = 0; d < levels; ++d) {
+        auto begin = byLevel.begin() + levelStart[size_t(d)];
+        auto end = byLevel.begin() + levelStart[size_t(d) + 1];
+        const auto byX = [&tree](int a, int b) { return tree.x[size_t(a)] < tree.x[size_t(b)]; };
+        if (!std::is_sorted(begin, end, byX)) std::stable_sort(begin, end, byX);
+        for (auto it = begin; it != end; ++it) {
+            const size_t node = size_t(*it);
+            const qreal half = tree.width[node] / 2;
+            levelX[size_t(it - byLevel.begin())] = tree.x[node];
+            levelHalfWidth[size_t(d)] = std::max(levelHalfWidth[size_t(d)], half);
+            left = std::min(left, tree.x[node] - half);
+            right = std::max(right, tree.x[node] + half);
+        }
+    }
+    const QRectF bounds(left, -tree.nodeHeight / 2, right - left, (levels - 1) * tree.levelHeight + tree.nodeHeight);
+
+    // Running extents of the edges into each level; in a tidy layout both
+    // ends move right along a level, but nothing here relies on it
+    std::vector<qreal>& edgeMaxRight = index.edgeMaxRight;
+    std::vector<qreal>& edgeMinLeft = index.edgeMinLeft;
+    edgeMaxRight.resize(count);
+    edgeMinLeft.resize(count);
+    for (int d = 0; d < levels; ++d) {
+        const int begin = levelStart[size_t(d)];
+        const int end = levelStart[size_t(d) + 1];
+        qreal maxRight = bounds.left();
+        for (int i = begin; i < end; ++i) {
+            const size_t child = size_t(byLevel[size_t(i)]);
+            const int parent = tree.parent[child];
+            const qreal edgeRight = parent < 0 ? tree.x[child] : std::max(tree.x[child], tree.x[size_t(parent)]);
+            maxRight = std::max(maxRight, edgeRight);
+            edgeMaxRight[size_t(i)] = maxRight;
+        }
+        qreal minLeft = bounds.right();
+        for (int i = end - 1; i >= begin; --i) {
+            const size_t child = size_t(byLevel[size_t(i)]);
+            const int parent = tree.parent[child];
+            const qreal edgeLeft = parent < 0 ? tree.x[child] : std::min(tree.x[child], tree.x[size_t(parent)]);
+            minLeft = std::min(minLeft, edgeLeft);
+            edgeMinLeft[size_t(i)] = minLeft;
+        }
+    }
+
+    index.bounds = bounds;
+    return index;
+}
+
+void ParseTreeItem::setGeometry(TreeGeometry geometry, TreeIndex newIndex)
+{
+    prepareGeometryChange();
+    tree = std::move(geometry);
+    index = std::move(newIndex);
+    if (labelTexts.size() > MAX_CACHED_LABELS) labelTexts.clear();
+    update();
+}
+
+QRectF ParseTreeItem::boundingRect() const
+{
+    return index.bounds;
+}
+
+int ParseTreeItem::nodeAt(const QPointF& pos) const
+{
+    const int levels = int(index.levelStart.size()) - 1;
+    const int level = int(std::lround(pos.y() / tree.levelHeight));
+    if (level < 0 || level >= levels) return -1;
+    const qreal dy = (pos.y() - level * tree.levelHeight) / (tree.nodeHeight / 2);
+    if (std::abs(dy) > 1) return -1;
+
+    // Only nodes within the widest half-width of the level can be hit
+    const qreal margin = index.levelHalfWidth[size_t(level)];
+    const auto begin = index.levelX.begin() + index.levelStart[size_t(level)];
+    const auto end = index.levelX.begin() + index.levelStart[size_t(level) + 1];
+    for (auto it = std::lower_bound(begin, end, pos.x() - margin); it != end && *it <= pos.x() + margin; ++it) {
+        const int node = index.byLevel[size_t(it - index.levelX.begin())];
+        const qreal dx = (pos.x() - *it) / (tree.width[size_t(node)] / 2);
+        if (dx * dx + dy * dy <= 1) return node;
+    }
+    return -1;
+}
+
+const QStaticText& ParseTreeItem::labelText(const QString& label) const
+{
+    auto it = labelTexts.find(label);
+    if (it == labelTexts.end()) {
+        QStaticText text(label);
+        text.setTextFormat(Qt::PlainText);
+        text.setPerformanceHint(QStaticText::AggressiveCaching);
+        text.prepare(QTransform(), labelFont);
+        it = labelTexts.insert(label, text);
+    }
+    return it.value();
+}
+
+void ParseTreeItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget*)
+{
+    if (tree.size() == 0) return;
+
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    const qreal pixel = 1 / scale;  // scene units per device pixel
+    const QRectF exposed = option->exposedRect;
+    const qreal halfHeight = tree.nodeHeight / 2;
+    const int levels = int(index.levelStart.size()) - 1;
+
+    int firstLevel = std::max(0, int(std::floor((exposed.top() - halfHeight) / tree.levelHeight)));
+    const int lastLevel = std::min(levels - 1, int(std::ceil((exposed.bottom() + halfHeight) / tree.levelHeight)));
+    if (firstLevel > lastLevel) return;
+
+    painter->save();
+
+    // Levels closer than a few pixels: bands of levels, shaded
+    const int levelStep = int(std::ceil(DENSITY_PIXELS * pixel / tree.levelHeight));
+    if (levelStep > 1) {
+        painter->setRenderHint(QPainter::Antialiasing, false);
+        firstLevel -= firstLevel % levelStep;
+        for (int d = firstLevel; d <= lastLevel; d += levelStep) {
+            paintDensity(painter, d, d + levelStep, exposed, pixel);
+        }
+        painter->restore();
+        return;
+    }
+
+    // Nodes of each level in view, and whether there are too many of them
+    // to draw one by one
+    struct LevelRange {
+        int first;
+        int last;
+        bool dense;
+    };
+    std::vector<LevelRange> ranges;
+    const qreal exposedPixels = exposed.width() * scale;
+    for (int d = firstLevel; d <= lastLevel; ++d) {
+        const qreal margin = index.levelHalfWidth[size_t(d)];
+        auto begin = index.levelX.begin() + index.levelStart[size_t(d)];
+        auto end = index.levelX.begin() + index.levelStart[size_t(d) + 1];
+        const int first = int(std::lower_bound(begin, end, exposed.left() - margin) - index.levelX.begin());
+        const int last = int(std::upper_bound(begin, end, exposed.right() + margin) - index.levelX.begin());
+        ranges.push_back({ first, last, (last - first) * DENSITY_PIXELS > exposedPixels });
+    }
+
+    const bool labels = tree.nodeHeight * scale >= LABEL_MIN_PIXELS;
+    painter->setRenderHint(QPainter::Antialiasing, labels);
+
+    // Edges first, so nodes are drawn over their ends. Edges into a level
+    // span the gap above it, which may be in view when the level is not.
+    const int lastEdgeLevel = std::min(levels - 1, lastLevel + 1);
+    for (int d = std::max(1, firstLevel); d <= lastEdgeLevel; ++d) {
+        const bool parentsDense = d - 1 >= firstLevel && ranges[size_t(d - 1 - firstLevel)].dense;
+        const bool childrenDense = d <= lastLevel && ranges[size_t(d - firstLevel)].dense;
+        if (parentsDense || childrenDense) continue;
+        paintEdges(painter, d, exposed, labels, pixel);
+    }
+
+    for (int d = firstLevel; d <= lastLevel; ++d) {
+        const LevelRange& range = ranges[size_t(d - firstLevel)];
+        if (range.dense) {
+            paintDensity(painter, d, d + 1, exposed, pixel);
+        } else if (range.first < range.last) {
+            paintNodes(painter, d, range.first, range.last, labels);
+        }
+    }
+
+    painter->restore();
+}
+
+void ParseTreeItem::paintNodes(QPainter* painter, int level, int first, int last, bool labels) const
+{
+    const qreal y = level * tree.levelHeight;
+    const qreal halfHeight = tree.nodeHeight / 2;
+
+    if (!labels) {
+        // Plain boxes in one call per fill
+        QVector<QRectF> boxes;
+        QVector<QRectF> collapsedBoxes;
+        boxes.reserve(last - first);
+        for (int i = first; i < last; ++i) {
+            const size_t node = size_t(index.byLevel[size_t(i)]);
+            const qreal width = tree.width[node];
+            const QRectF box(index.levelX[size_t(i)] - width / 2, y - halfHeight, width, tree.nodeHeight);
+            (tree.collapsed[node] ? collapsedBoxes : boxes).append(box);
+        }
+        painter->setPen(QPen(Qt::black, 0));
+        painter->setBrush(Qt::white);
+        painter->drawRects(boxes.constData(), int(boxes.size()));
+        painter->setBrush(COLLAPSED_FILL);
+        painter->drawRects(collapsedBoxes.constData(), int(collapsedBoxes.size()));
+        return;
+    }
+
+    painter->setPen(QPen(Qt::black, 2));
+    for (int i = first; i < last; ++i) {
+        const size_t node = size_t(index.byLevel[size_t(i)]);
+        painter->setBrush(tree.collapsed[node] ? COLLAPSED_FILL : QColor(Qt::white));
+        painter->drawEllipse(QPointF(index.levelX[size_t(i)], y), tree.width[node] / 2, halfHeight);
+    }
+
+    painter->setFont(labelFont);
+    for (int i = first; i < last; ++i) {
+        const QStaticText& text = labelText(tree.label[size_t(index.byLevel[size_t(i)])]);
+        const QSizeF size = text.size();
+        painter->drawStaticText(QPointF(index.levelX[size_t(i)] - size.width() / 2, y - size.height() / 2), text);
+    }
+}
+
+// Point where the ray from the center of an ellipse at `angle` leaves it
+static QPointF ellipseBoundary(const QPointF& center, qreal a, qreal b, qreal angle)
+{
+    const qreal c = std::cos(angle);
+    const qreal s = std::sin(angle);
+    const qreal r = 1.0 / std::sqrt((c * c) / (a * a) + (s * s) / (b * b));
+    return center + QPointF(r * c, r * s);
+}
+
+void ParseTreeItem::paintEdges(QPainter* painter, int level, const QRectF& exposed, bool arrows, qreal pixel) const
+{
+    // Edges that lie wholly left or right of the view form a prefix and a
+    // suffix of the running extents
+    const auto rightBegin = index.edgeMaxRight.begin();
+    const auto leftBegin = index.edgeMinLeft.begin();
+    const int first = int(std::lower_bound(rightBegin + index.levelStart[size_t(level)],
+                                           rightBegin + index.levelStart[size_t(level) + 1], exposed.left()) - rightBegin);
+    const int last = int(std::upper_bound(leftBegin + first, leftBegin + index.levelStart[size_t(level) + 1],
+                                          exposed.right()) - leftBegin);
+    if (first >= last) return;
+
+    // A fan of more edges than there are pixels is thinned out
+    const int stride = std::max(1, int((last - first) * pixel / std::max(exposed.width(), pixel)));
+
+    const qreal halfHeight = tree.nodeHeight / 2;
+    const qreal childY = level * tree.levelHeight;
+    const qreal parentY = childY - tree.levelHeight;
+    QVector<QLineF> lines;
+    lines.reserve((last - first) / stride + 1);
+    painter->setPen(arrows ? QPen(Qt::black, 1.5) : QPen(Qt::black, 0));
+    painter->setBrush(Qt::black);
+
+    for (int i = first; i < last; i += stride) {
+        const size_t child = size_t(index.byLevel[size_t(i)]);
+        const size_t parent = size_t(tree.parent[child]);
+        const QPointF from(tree.x[parent], parentY);
+        const QPointF to(tree.x[child], childY);
+        if (!arrows) {
+            lines.append(QLineF(from + QPointF(0, halfHeight), to - QPointF(0, halfHeight)));
+            continue;
+        }
+
+        // From the rim of the parent's ellipse to the rim of the child's
+        const qreal angle = std::atan2(to.y() - from.y(), to.x() - from.x());
+        const QLineF line(ellipseBoundary(from, tree.width[parent] / 2, halfHeight, angle),
+                          ellipseBoundary(to, tree.width[child] / 2, halfHeight, angle + M_PI));
+        lines.append(line);
+
+        const qreal arrowSize = 12;
+        const qreal edgeAngle = std::atan2(line.dy(), line.dx());
+        const QPointF head[3] = {
+            line.p2(),
+            line.p2() - QPointF(std::cos(edgeAngle + M_PI / 6) * arrowSize, std::sin(edgeAngle + M_PI / 6) * arrowSize),
+            line.p2() - QPointF(std::cos(edgeAngle - M_PI / 6) * arrowSize, std::sin(edgeAngle - M_PI / 6) * arrowSize),
+        };
+        painter->drawPolygon(head, 3);
+    }
+    painter->drawLines(lines.constData(), int(lines.size()));
+}
+
+void ParseTreeItem::paintDensity(QPainter* painter, int firstLevel, int lastLevel, const QRectF& exposed,
+                                 qreal pixel) const
+{
+    // A few levels stand in for all the levels of the band
+    struct Sample {
+        std::vector<qreal>::const_iterator from;
+        std::vector<qreal>::const_iterator to;
+        qreal nodeWidth;
+    };
+    std::vector<Sample> samples;
+    const int levels = int(index.levelStart.size()) - 1;
+    lastLevel = std::min(lastLevel, levels);
+    const int sampleStep = std::max(1, (lastLevel - firstLevel) / MAX_SAMPLED_LEVELS);
+    for (int d = firstLevel; d < lastLevel; d += sampleStep) {
+        if (index.levelStart[size_t(d)] == index.levelStart[size_t(d) + 1]) continue;
+        samples.push_back({ index.levelX.begin() + index.levelStart[size_t(d)], index.levelX.begin() + index.levelStart[size_t(d) + 1],
+                            2 * index.levelHalfWidth[size_t(d)] });
+    }
+    if (samples.empty()) return;
+
+    // Buckets a few pixels wide, aligned so they do not shimmer when panning
+    const qreal bucket = DENSITY_PIXELS * pixel;
+    const qreal top = firstLevel * tree.levelHeight - tree.nodeHeight / 2;
+    const qreal height = std::max((lastLevel - firstLevel - 1) * tree.levelHeight + tree.nodeHeight, pixel);
+    painter->setPen(Qt::NoPen);
+
+    qreal runStart = 0;
+    int runAlpha = 0;
+    for (qreal x = std::floor(exposed.left() / bucket) * bucket; x < exposed.right() + bucket; x += bucket) {
+        qreal coverage = 0;
+        for (Sample& sample : samples) {
+            sample.from = std::lower_bound(sample.from, sample.to, x - sample.nodeWidth / 2);
+            const auto upto = std::lower_bound(sample.from, sample.to, x + bucket + sample.nodeWidth / 2);
+            coverage += (upto - sample.from) * sample.nodeWidth / bucket;
+        }
+        // Nodes far below a pixel still leave a trace
+        int alpha = int(255 * (1 - std::exp(-coverage)));
+        if (coverage > 0) alpha = std::max(alpha, MIN_DENSITY_ALPHA);
+
+        // Neighbouring buckets of the same shade are filled as one
+        if (alpha != runAlpha) {
+            if (runAlpha > 0) painter->fillRect(QRectF(runStart, top, x - runStart, height), QColor(0, 0, 0, runAlpha));
+            runStart = x;
+            runAlpha = alpha;
+        }
+    }
+    if (runAlpha > 0) {
+        painter->fillRect(QRectF(runStart, top, exposed.right() + bucket - runStart, height), QColor(0, 0, 0, runAlpha));
+    }
+}
@@ -0,0 +1,90 @@
+// parsetreeitem.h
+#ifndef PARSETREEITEM_H
+#define PARSETREEITEM_H
+
+#include <QGraphicsItem>
+#include <QFont>
+#include <QHash>
+#include <QStaticText>
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include <vector>
+
+// A laid-out tree as flat arrays indexed by node. Node 0 is the root and
+// every parent comes before its children.
+struct TreeGeometry {
+    std::vector<int> parent;        // -1 for the root
+    std::vector<int> depth;
+    std::vector<qreal> x;           // horizontal center of the node
+    std::vector<qreal> width;
+    std::vector<QString> label;
+    std::vector<uint8_t> collapsed; // has children that are not shown
+    qreal nodeHeight = 50;
+    qreal levelHeight = 130;        // distance between the centers of two levels
+
+    size_t size() const { return parent.size(); }
+    qreal y(int node) const { return depth[size_t(node)] * levelHeight; }
+};
+
+// Lookup tables a ParseTreeItem paints from. Nodes are indexed by level
+// and sorted by x within each level; edges into each level keep running
+// extents so that those out of view can be skipped. Building them is the
+// slow part of showing a big tree, and needs nothing but the geometry, so
+// it can run on a worker thread.
+struct TreeIndex {
+    // Nodes of each level by x: byLevel[levelStart[d]] .. byLevel[levelStart[d + 1]]
+    std::vector<int> levelStart;
+    std::vector<int> byLevel;
+    std::vector<qreal> levelX;          // x of byLevel[i]
+    std::vector<qreal> levelHalfWidth;  // widest node of each level, halved
+
+    // Edges into each level, in the order of byLevel; left and right extent
+    // of the edges up to / from each position, for finding those in view
+    std::vector<qreal> edgeMaxRight;    // max over the edges before and at i
+    std::vector<qreal> edgeMinLeft;     // min over the edges at and after i
+
+    QRectF bounds;
+
+    static TreeIndex build(const TreeGeometry& tree);
+};
+
+// Paints a whole tree as a single graphics item.
+//
+// Nodes are indexed by level and sorted by x within each level, so a paint
+// only visits the nodes and edges inside the exposed rectangle and its
+// cost follows the size of the viewport, not of the tree. How much is drawn
+// depends on the zoom: ellipses with labels and arrows when labels are
+// legible, plain boxes and lines below that, and once nodes are closer
+// than a few pixels, each level as a band shaded by node density. Collapsed
+// nodes are shaded so they stand out from leaves.
+class ParseTreeItem : public QGraphicsItem {
+public:
+    explicit ParseTreeItem(QGraphicsItem* parent = nullptr);
+
+    // `index` must have been built from `geometry`
+    void setGeometry(TreeGeometry geometry, TreeIndex index);
+    const TreeGeometry& geometry() const { return tree; }
+    const TreeIndex& treeIndex() const { return index; }
+    const QFont& font() const { return labelFont; }
+
+    // Node whose shape contains `pos`, or -1
+    int nodeAt(const QPointF& pos) const;
+
+    QRectF boundingRect() const override;
+    void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) override;
+
+private:
+    TreeGeometry tree;
+    TreeIndex index;
+
+    QFont labelFont;
+    mutable QHash<QString, QStaticText> labelTexts;
+
+    const QStaticText& labelText(const QString& label) const;
+    void paintNodes(QPainter* painter, int level, int first, int last, bool labels) const;
+    void paintEdges(QPainter* painter, int level, const QRectF& exposed, bool arrows, qreal pixel) const;
+    void paintDensity(QPainter* painter, int firstLevel, int lastLevel, const QRectF& exposed, qreal pixel) const;
+};
+
+#endif // PARSETREEITEM_H
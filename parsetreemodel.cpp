@@ -0,0 +1,112 @@
+// parsetreemodel.cpp
+#include "parsetreemodel.h"
+
+// Children made into rows per fetchMore(); the view asks again when the
+// user scrolls to the last of them
+static const int FETCH_BATCH = 512;
+
+ParseTreeModel::ParseTreeModel(QObject* parent)
+    : QAbstractItemModel(parent) {}
+
+void ParseTreeModel::setRoot(ParseNode* newRoot) {
+    beginResetModel();
+    entries.clear();
+    root = newRoot;
+    if (root) {
+        Entry& top = entries[nullptr];
+        top.rows.push_back(root);
+        top.scanned = 1;
+        entries[root];
+    }
+    endResetModel();
+}
+
+ParseNode* ParseTreeModel::nodeOf(const QModelIndex& index) {
+    return index.isValid() ? static_cast<ParseNode*>(index.internalPointer()) : nullptr;
+}
+
+const ParseTreeModel::Entry* ParseTreeModel::entryOf(const QModelIndex& index) const {
+    auto it = entries.find(nodeOf(index));
+    return it == entries.end() ? nullptr : &it->second;
+}
+
+QModelIndex ParseTreeModel::index(int row, int column, const QModelIndex& parent) const {
+    const Entry* entry = entryOf(parent);
+    if (!entry || row < 0 || row >= int(entry->rows.size()) || column != 0) return QModelIndex();
+    return createIndex(row, column, entry->rows[size_t(row)]);
+}
+
+QModelIndex ParseTreeModel::parent(const QModelIndex& child) const {
+    const Entry* entry = entryOf(child);
+    if (!entry || !entry->parent) return QModelIndex();
+    const ParseNode* parentNode = entry->parent;
+    return createIndex(entries.at(parentNode).row, 0, const_cast<ParseNode*>(parentNode));
+}
+
+int ParseTreeModel::rowCount(const QModelIndex& parent) const {
+    if (parent.column() > 0) return 0;
+    const Entry* entry = entryOf(parent);
+    return entry ? int(entry->rows.size()) : 0;
+}
+
+int ParseTreeModel::columnCount(const QModelIndex&) const {
+    return 1;
+}
+
+// Answered from the node itself, so unfetched nodes still get an expander
+bool ParseTreeModel::hasChildren(const QModelIndex& parent) const {
+    const ParseNode* node = nodeOf(parent);
+    if (!node) return root != nullptr && !parent.isValid();
+    return node->lazy || !node->children.isEmpty();
+}
+
+bool ParseTreeModel::canFetchMore(const QModelIndex& parent) const {
+    const ParseNode* node = nodeOf(parent);
+    const Entry* entry = entryOf(parent);
+    if (!node || !entry) return false;
+    return node->lazy || entry->scanned < node->children.size();
+}
+
+void ParseTreeModel::fetchMore(const QModelIndex& parent) {
+    ParseNode* node = nodeOf(parent);
+    if (!node || entries.find(node) == entries.end()) return;
+
+    if (node->lazy) {
+        std::vector<SyntaxError> errors;
+        SyntaxAnalyzer::materialize(node, &errors);
+        emit dataChanged(parent, parent, { Qt::DisplayRole });
+        if (!errors.empty()) emit blockParsed(errors);
+    }
+
+    Entry& entry = entries[node];
+    std::vector<ParseNode*> batch;
+    while (entry.scanned < node->children.size() && int(batch.size()) < FETCH_BATCH) {
+        if (ParseNode* child = node->children[entry.scanned]) batch.push_back(child);
+        ++entry.scanned;
+    }
+    if (batch.empty()) return;
+
+    const int first = int(entry.rows.size());
+    beginInsertRows(parent, first, first + int(batch.size()) - 1);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Entry& childEntry = entries[batch[i]];
+        childEntry.parent = node;
+        childEntry.row = first + int(i);
+    }
+    // `entry` survives the insertions above; map nodes never move
+    entry.rows.insert(entry.rows.end(), batch.begin(), batch.end());
+    endInsertRows();
+}
+
+QVariant ParseTreeModel::data(const QModelIndex& index, int role) const {
+    const ParseNode* node = nodeOf(index);
+    if (!node || role != Qt::DisplayRole) return QVariant();
+    return node->value.isEmpty() ? node->name : node->name + ": " + node->value;
+}
+
+QVariant ParseTreeModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section == 0) {
+        return QString("Parse Tree");
+    }
+    return QAbstractItemModel::headerData(section, orientation, role);
+}
@@ -0,0 +1,58 @@
+// parsetreemodel.h
+#ifndef PARSETREEMODEL_H
+#define PARSETREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <unordered_map>
+#include <vector>
+#include "syntaxanalyzer.h"
+
+// Parse tree of the last analysis for a QTreeView.
+//
+// The model wraps the parser's own nodes rather than copying them. A node's
+// children become rows only when the view asks for them (canFetchMore and
+// fetchMore, i.e. when the node is expanded or scrolled to the end of its
+// rows), a batch at a time, so showing a tree costs the same whatever its
+// size. Blocks the parser left unparsed are parsed on first expansion.
+class ParseTreeModel : public QAbstractItemModel {
+    Q_OBJECT
+
+public:
+    explicit ParseTreeModel(QObject* parent = nullptr);
+
+    // Show the tree below `root`, which stays owned by the caller and must
+    // outlive its use here; nullptr empties the view
+    void setRoot(ParseNode* root);
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& child) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+signals:
+    // Errors in a block that was parsed on expansion; they only surface now
+    void blockParsed(const std::vector<SyntaxError>& errors);
+
+private:
+    // A node that has been shown as a row. The invisible root is the entry
+    // keyed by nullptr, with the tree's root as its only row.
+    struct Entry {
+        const ParseNode* parent = nullptr;
+        int row = 0;
+        std::vector<ParseNode*> rows;   // children fetched so far, nulls skipped
+        int scanned = 0;                // children looked at so far
+    };
+
+    ParseNode* root = nullptr;
+    std::unordered_map<const ParseNode*, Entry> entries;
+
+    static ParseNode* nodeOf(const QModelIndex& index);
+    const Entry* entryOf(const QModelIndex& index) const;
+};
+
+#endif // PARSETREEMODEL_H
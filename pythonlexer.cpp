@@ -2,10 +2,7 @@
 #include <cctype>
 #include <algorithm>
 #include <string>
-#include <cmath>
-#include <stack>
 #include <vector>
-#include <stdexcept>
 // Move using declarations to file scope
 using std::string;
 using std::isalpha;
@@ -22,7 +19,10 @@ std::string toLower(const std::string& str) {
     return result;
 }
 
-PythonLexer::PythonLexer(const std::string& input) : source(input), addedBuiltins() {}
+PythonLexer::PythonLexer(const std::string& input) : source(input) {
+    for (const auto& keyword : keywords) lowerKeywords.insert(toLower(keyword));
+    for (const auto& builtin : builtinFunctions) lowerBuiltins.insert(toLower(builtin));
+}
 
 void PythonLexer::advance() {
     if (current() == '\n') {
@@ -35,7 +35,53 @@ void PythonLexer::advance() {
 }
 
 void PythonLexer::addToken(const std::string& lexeme, TokenType type) {
+    // Blocks are matched in the parser's stream, which has no comments
+    const size_t parseIndex = tokens.size() - commentTokens;
+    switch (type) {
+    case TokenType::COMMENT:
+        commentTokens++;
+        break;
+    case TokenType::INDENT:
+        openBlocks.push_back(blocks.size());
+        blocks.push_back({ parseIndex, parseIndex });
+        break;
+    case TokenType::DEDENT:
+        if (!openBlocks.empty()) {
+            blocks[openBlocks.back()].dedent = parseIndex;
+            openBlocks.pop_back();
+        }
+        break;
+    case TokenType::ENDOFFILE:
+        for (size_t open : openBlocks) {
+            blocks[open].dedent = parseIndex;
+        }
+        openBlocks.clear();
+        break;
+    default:
+        break;
+    }
     tokens.push_back({ lexeme, type, line, column - static_cast<int>(lexeme.length()) });
+    if (tokenSink && tokens.size() - publishedTokens >= sinkBatchSize) {
+        publishTokens();
+    }
+}
+
+void PythonLexer::setTokenSink(TokenRing* ring, size_t batchSize) {
+    tokenSink = ring;
+    sinkBatchSize = batchSize ? batchSize : 1;
+    publishedTokens = tokens.size();
+}
+
+// Tokens are never modified once added, so a batch can be handed over as
+// soon as it is full
+void PythonLexer::publishTokens() {
+    if (publishedTokens == tokens.size()) return;
+    TokenBatch batch(tokens.begin() + publishedTokens, tokens.end());
+    publishedTokens = tokens.size();
+    if (!tokenSink->push(std::move(batch))) {
+        // The consumer closed the ring; keep lexing without publishing
+        tokenSink = nullptr;
+    }
 }
 
 bool PythonLexer::isOperatorChar(char c) {
@@ -464,38 +510,17 @@ void PythonLexer::processIdentifier() {
     }
 
     std::string lowerIdent = toLower(ident);
+    const bool isKeyword = lowerKeywords.count(lowerIdent) != 0;
+    const bool isBuiltinFunction = lowerBuiltins.count(lowerIdent) != 0;
 
-    // Check if the identifier is a keyword
-    std::string keywordMatch;
-    for (const auto& keyword : keywords) {
-        std::string lowerKeyword = toLower(keyword);
-        if (lowerIdent == lowerKeyword) {
-            keywordMatch = keyword;
-            break;
-        }
-    }
-
-    // Check if the identifier is a built-in function
-    bool isBuiltinFunction = false;
-    std::string builtinMatch;
-    for (const auto& builtin : builtinFunctions) {
-        std::string lowerBuiltin = toLower(builtin);
-        if (lowerIdent == lowerBuiltin) {
-            isBuiltinFunction = true;
-            builtinMatch = builtin;
-            break;
-        }
-    }
-
-    if (!keywordMatch.empty()) {
+    if (isKeyword) {
         addToken(ident, TokenType::KEYWORD);
     } else if (isBuiltinFunction) {
         addToken(ident, TokenType::IDENTIFIER);
         // Add to symbol table if not already added
-        if (addedBuiltins.find(ident) == addedBuiltins.end()) {
-            int id = symbolTable.addIdentifier(ident, line);
-            symbolTable.setIdentifierInfo(ident, "function", "built-in");
-            addedBuiltins.insert(ident); // Mark as added
+        const SymbolId id = symbolTable.addIdentifier(ident);
+        if (symbolTable.dataType(id) != DataType::Function) {
+            symbolTable.setInfo(id, DataType::Function, "built-in");
         }
     } else {
         size_t tempPos = pos;
@@ -508,7 +533,7 @@ void PythonLexer::processIdentifier() {
         column = tempColumn;
 
         if (!isFunctionCall) {
-            symbolTable.addIdentifier(ident, line);
+            symbolTable.addIdentifier(ident);
         }
         addToken(ident, TokenType::IDENTIFIER);
     }
@@ -556,7 +581,6 @@ void PythonLexer::processComment() {
     }
 }
 void PythonLexer::handleIndentation() {
-    static std::vector<int> indentStack = {0}; // Track indentation levels
     int currentIndent = 0;
 
     // Count spaces or tabs for indentation
@@ -565,6 +589,11 @@ void PythonLexer::handleIndentation() {
         advance();
     }
 
+    // Blank and comment-only lines do not open or close a block
+    if (current() == '\n' || current() == '\r' || current() == '#' || current() == '\0') {
+        return;
+    }
+
     // Handle increasing indent
     if (currentIndent > indentStack.back()) {
         indentStack.push_back(currentIndent);
@@ -786,7 +815,7 @@ bool PythonLexer::processTypeAnnotation() {
             if (typeHints.count(lowerTypeName)) {
                 typeAnnotations[ident] = lowerTypeName;
                 addToken(ident, TokenType::IDENTIFIER);
-                symbolTable.addIdentifier(ident, line);
+                symbolTable.addIdentifier(ident);
                 return true;
             }
         }
@@ -798,166 +827,8 @@ bool PythonLexer::processTypeAnnotation() {
 }
 
 
-// Convert infix tokens to Reverse Polish Notation (RPN) using the Shunting-Yard algorithm
-std::vector<Token> PythonLexer::toRPN(const std::vector<Token>& input) {
-    std::vector<Token> output;
-    std::stack<Token> ops;
-
-    auto precedence = [&](const Token& t) {
-        switch (t.type) {
-        case TokenType::POWEROPERATOR:      return 4;
-        case TokenType::MULTIPLYOPERATOR:
-        case TokenType::DIVIDEOPERATOR:
-        case TokenType::PERCENTAGEOPERATOR: return 3;
-        case TokenType::ADDOPERATOR:
-        case TokenType::MINUSOPERATOR:      return 2;
-        default:                            return 0;
-        }
-    };
-    auto isLeftAssoc = [&](const Token& t) {
-        return t.type != TokenType::POWEROPERATOR;
-    };
-
-    for (size_t i = 0; i < input.size(); ++i) {
-        const Token& t = input[i];
-
-        // <<<— updated operand check:
-        if (t.type == TokenType::NUMBER        ||
-            t.type == TokenType::HexadecimalNumber ||
-            t.type == TokenType::BinaryNumber  ||
-            t.type == TokenType::OCTALNUMBER   ||
-            t.type == TokenType::IDENTIFIER    ||
-            t.type == TokenType::KEYWORD
-            )
-        {
-            output.push_back(t);
-        }
-        else if (t.type == TokenType::ADDOPERATOR   ||
-                 t.type == TokenType::MINUSOPERATOR ||
-                 t.type == TokenType::MULTIPLYOPERATOR ||
-                 t.type == TokenType::DIVIDEOPERATOR   ||
-                 t.type == TokenType::PERCENTAGEOPERATOR||
-                 t.type == TokenType::POWEROPERATOR) {
-            // (same unary minus + precedence logic as before)
-            Token op = t;
-            bool unary = (t.type == TokenType::MINUSOPERATOR) &&
-                         (i == 0 || input[i-1].lexeme == "(" ||
-                          input[i-1].type == TokenType::ADDOPERATOR ||
-                          input[i-1].type == TokenType::MINUSOPERATOR ||
-                          input[i-1].type == TokenType::MULTIPLYOPERATOR ||
-                          input[i-1].type == TokenType::DIVIDEOPERATOR ||
-                          input[i-1].type == TokenType::PERCENTAGEOPERATOR ||
-                          input[i-1].type == TokenType::POWEROPERATOR);
-            if (unary) op.type = TokenType::MINUSOPERATOR;
-            while (!ops.empty()) {
-                const Token& top = ops.top();
-                if ((isLeftAssoc(op) && precedence(op) <= precedence(top)) ||
-                    (!isLeftAssoc(op) && precedence(op) <  precedence(top))) {
-                    output.push_back(top);
-                    ops.pop();
-                } else break;
-            }
-            ops.push(op);
-        }
-        else if (t.lexeme == "(") {
-            ops.push(t);
-        }
-        else if (t.lexeme == ")") {
-            while (!ops.empty() && ops.top().lexeme != "(") {
-                output.push_back(ops.top());
-                ops.pop();
-            }
-            if (ops.empty()) throw std::runtime_error("Mismatched parentheses");
-            ops.pop();
-        }
-        // ignore other token types
-    }
-
-    while (!ops.empty()) {
-        if (ops.top().lexeme == "(" || ops.top().lexeme == ")")
-            throw std::runtime_error("Mismatched parentheses");
-        output.push_back(ops.top());
-        ops.pop();
-    }
-    return output;
-}
-// Evaluate an RPN token sequence; looks up identifiers in symbolTable
-double PythonLexer::evalRPN(const std::vector<Token>& rpn) {
-    std::stack<double> st;
-    for (const Token& t : rpn) {
-        if (t.type == TokenType::NUMBER) {
-            st.push(std::stod(t.lexeme));
-        }
-        else if (t.type == TokenType::HexadecimalNumber) {
-            st.push(static_cast<double>(std::stoll(t.lexeme, nullptr, 16)));
-        }
-        else if (t.type == TokenType::BinaryNumber) {
-            st.push(static_cast<double>(std::stoll(t.lexeme.substr(2), nullptr, 2)));
-        }
-        else if (t.type == TokenType::OCTALNUMBER) {
-            st.push(static_cast<double>(std::stoll(t.lexeme.substr(2), nullptr, 8)));
-        }
-        else if (t.type == TokenType::IDENTIFIER) {
-            if (!symbolTable.getSymbols().count(t.lexeme))
-                throw std::runtime_error("Undefined identifier: " + t.lexeme);
-            
-            // Get the value and type from symbol table
-            auto value = symbolTable.getValue(t.lexeme);
-            auto type = symbolTable.getDataType(t.lexeme);
-            
-            // Check if the variable is uninitialized or unknown
-            if (type == "unknown" || value == "N/A") {
-                throw std::runtime_error("Cannot perform operation with uninitialized variable: " + t.lexeme);
-            }
-            
-            // Only try to convert to number if it's a numeric type
-            if (type != "int" && type != "float") {
-                throw std::runtime_error("Cannot perform numeric operation with " + type + " variable: " + t.lexeme);
-            }
-            
-            try {
-                st.push(std::stod(value));
-            } catch (const std::exception& e) {
-                throw std::runtime_error("Invalid numeric value for variable " + t.lexeme + ": " + value);
-            }
-        }
-        else if (t.type == TokenType::KEYWORD) {
-            std::string val = toLower(t.lexeme);
-            if (val == "true") st.push(1.0);
-            else if (val == "false") st.push(0.0);
-            else throw std::runtime_error("Unexpected keyword in expression: " + t.lexeme);
-        }
-        else {
-            if (t.type == TokenType::MINUSOPERATOR && st.size() == 1) {
-                double a = st.top(); st.pop();
-                st.push(-a);
-            } else {
-                if (st.size() < 2) throw std::runtime_error("Invalid expression");
-                double b = st.top(); st.pop();
-                double a = st.top(); st.pop();
-                double res;
-                switch (t.type) {
-                case TokenType::ADDOPERATOR:       res = a + b; break;
-                case TokenType::MINUSOPERATOR:     res = a - b; break;
-                case TokenType::MULTIPLYOPERATOR:  res = a * b; break;
-                case TokenType::DIVIDEOPERATOR:
-                    if (b == 0) throw std::runtime_error("Division by zero");
-                    res = a / b; break;
-                case TokenType::PERCENTAGEOPERATOR:
-                    if (b == 0) throw std::runtime_error("Modulo by zero");
-                    res = std::fmod(a, b); break;
-                case TokenType::POWEROPERATOR:     res = std::pow(a, b); break;
-                default:  throw std::runtime_error("Unknown operator");
-                }
-                st.push(res);
-            }
-        }
-    }
-    if (st.size() != 1) return 0.0;
-    return st.top();
-}
-
-// Refactored assignment processing: delegates expression parsing and evaluation
+// Reject assignments to an expression like `-x = ...`. Assigned values are
+// no longer evaluated here: ConstantFolder works them out on the parse tree.
 void PythonLexer::processAssignments() {
     size_t i = 0;
     while (i < tokens.size()) {
@@ -972,99 +843,16 @@ void PythonLexer::processAssignments() {
             i += 3; continue;
         }
 
-        // identifier = …
+        // identifier = …: skip the right-hand side
         if (tokens[i].type == TokenType::IDENTIFIER &&
             i + 1 < tokens.size() &&
             tokens[i+1].type == TokenType::EQUALOPERATOR) {
-            std::string lhs   = tokens[i].lexeme;
-            int         line  = tokens[i].line;
-            std::vector<Token> expr;
-            size_t     j = i + 2;
-
-            // collect RHS
-            while (j < tokens.size() &&
-                   tokens[j].type != TokenType::NEWLINE &&
-                   tokens[j].type != TokenType::ENDOFFILE) {
-                expr.push_back(tokens[j++]);
-            }
-
-            // If *any* lexical error happened between the assignment's start and its end, bail
-            int startLine = tokens[i].line;
-            // tokens[j] is the NEWLINE or ENDOFFILE after the RHS
-            int endLine   = (j < tokens.size() ? tokens[j].line : tokens.back().line);
-
-            bool bad = false;
-            for (const auto &err : errors) {
-                if (err.line >= startLine && err.line <= endLine) {
-                    bad = true;
-                    break;
-                }
-            }
-            if (bad) {
-                symbolTable.setIdentifierInfo(lhs, "unknown", "N/A");
-                i = j;
-                continue;
-            }
-
-            // now your existing single-token shortcuts…
-            if (expr.size() == 1) {
-                const Token &t = expr[0];
-                switch (t.type) {
-                case TokenType::STRING:
-                    symbolTable.setIdentifierInfo(lhs, "string", t.lexeme);
-                    i = j; continue;
-                case TokenType::KEYWORD: {
-                    auto v = toLower(t.lexeme);
-                    if (v=="true"||v=="false") {
-                        symbolTable.setIdentifierInfo(lhs, "bool", v);
-                        i = j; continue;
-                    }
-                    break;
-                }
-                case TokenType::HexadecimalNumber:
-                case TokenType::BinaryNumber:
-                case TokenType::OCTALNUMBER:
-                    symbolTable.setIdentifierInfo(lhs, "int", t.lexeme);
-                    i = j; continue;
-                case TokenType::NUMBER: {
-                    bool isF = t.lexeme.find('.')!=std::string::npos
-                               || t.lexeme.find('e')!=std::string::npos
-                               || t.lexeme.find('E')!=std::string::npos;
-                    symbolTable.setIdentifierInfo(lhs,
-                                                  isF?"float":"int", t.lexeme);
-                    i = j; continue;
-                }
-                case TokenType::IDENTIFIER: {
-                    if (symbolTable.getSymbols().count(t.lexeme)) {
-                        auto v  = symbolTable.getValue(t.lexeme);
-                        auto dt = symbolTable.getDataType(t.lexeme);
-                        symbolTable.setIdentifierInfo(lhs, dt, v);
-                    } else {
-                        addError("Undefined identifier in assignment: " + t.lexeme);
-                    }
-                    i = j; continue;
-                }
-                default: break;
-                }
+            i += 2;
+            while (i < tokens.size() &&
+                   tokens[i].type != TokenType::NEWLINE &&
+                   tokens[i].type != TokenType::ENDOFFILE) {
+                ++i;
             }
-
-            // General RPN case
-            try {
-                auto   rpn    = toRPN(expr);
-                double result = evalRPN(rpn);
-                bool   isInt  = (std::floor(result)==result);
-                std::string dtype = isInt ? "int" : "float";
-                std::string sval  = isInt
-                                       ? std::to_string((long long)result)
-                                       : std::to_string(result);
-                symbolTable.setIdentifierInfo(lhs, dtype, sval);
-            } catch (const std::exception& e) {
-                addError(e.what());
-                // treat as unknown on any evaluation exception
-                symbolTable.setIdentifierInfo(lhs, "unknown", "N/A");
-            }
-
-            i = j;
         }
         else {
             ++i;
@@ -1072,15 +860,12 @@ void PythonLexer::processAssignments() {
     }
 }
 
-
-
-
 void PythonLexer::addError(const std::string& message) {
     errors.push_back({ message, line, column });
 }
 
 std::pair<std::vector<Token>, std::vector<LexicalError>> PythonLexer::tokenize() {
-    while (current() != '\0') {
+    while (current() != '\0' && !(cancellation && cancellation->isCancelled())) {
         char c = current();
         switch (c) {
         // 1) Newline
@@ -1167,8 +952,20 @@ std::pair<std::vector<Token>, std::vector<LexicalError>> PythonLexer::tokenize()
         }
     }
 
+    // Close the blocks still open, so every INDENT has its DEDENT
+    if (!(cancellation && cancellation->isCancelled())) {
+        while (indentStack.size() > 1) {
+            indentStack.pop_back();
+            addToken("", TokenType::DEDENT);
+        }
+    }
     addToken("", TokenType::ENDOFFILE);
-    processAssignments();
+    if (tokenSink) {
+        // The parser can finish while the assignments below are checked
+        publishTokens();
+        if (tokenSink) tokenSink->close();
+    }
+    if (!(cancellation && cancellation->isCancelled())) processAssignments();
     return { tokens, errors };
 }
 
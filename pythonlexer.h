@@ -5,7 +5,9 @@
 #include <vector>
 #include <unordered_set>
 #include <unordered_map>
-#include <optional>
+#include "cancellation.h"
+#include "symboltable.h"
+#include "tokenring.h"
 
 enum class TokenType {
     KEYWORD, IDENTIFIER, HexadecimalNumber, BinaryNumber, OCTALNUMBER, NUMBER, COMPLEX_NUMBER, STRING, OPERATOR,
@@ -21,61 +23,22 @@ struct Token {
     int column;
 };
 
+// Tokens travel from the lexer to a pipelined parser in batches
+using TokenBatch = std::vector<Token>;
+using TokenRing = SpscRing<TokenBatch>;
+
 struct LexicalError {
     std::string message;
     int line;
     int column;
 };
 
-class SymbolTable {
-private:
-    struct SymbolEntry {
-        int id;
-        std::string dataType;
-        std::string value;
-    };
-
-    std::unordered_map<std::string, SymbolEntry> symbols;
-    int current_id = 1;
-
-public:
-    int addIdentifier(const std::string& identifier, int line) {
-        if (!symbols.count(identifier)) {
-            symbols[identifier] = { current_id++, "unknown", "N/A" };
-        }
-        return symbols[identifier].id;
-    }
-
-    void setIdentifierInfo(const std::string& identifier, const std::string& dataType, const std::string& value) {
-        if (symbols.count(identifier)) {
-            symbols[identifier].dataType = dataType;
-            symbols[identifier].value = value;
-        }
-    }
-
-    std::optional<int> lookup(const std::string& identifier) const {
-        auto it = symbols.find(identifier);
-        return it != symbols.end() ? std::optional<int>(it->second.id) : std::nullopt;
-    }
-
-    const std::unordered_map<std::string, SymbolEntry>& getSymbols() const {
-        return symbols;
-    }
-
-    int getId(const std::string& identifier) const {
-        auto it = symbols.find(identifier);
-        return it != symbols.end() ? it->second.id : -1;
-    }
-
-    std::string getDataType(const std::string& identifier) const {
-        auto it = symbols.find(identifier);
-        return it != symbols.end() ? it->second.dataType : "unknown";
-    }
-
-    std::string getValue(const std::string& identifier) const {
-        auto it = symbols.find(identifier);
-        return it != symbols.end() ? it->second.value : "N/A";
-    }
+// An indented block: its INDENT and the DEDENT (or ENDOFFILE) that closes
+// it, as indices into the token stream without comments, which is what
+// the parser reads
+struct BlockSpan {
+    size_t indent;
+    size_t dedent;
 };
 
 class PythonLexer {
@@ -89,10 +52,16 @@ private:
     std::vector<LexicalError> errors;
     std::unordered_map<std::string, std::string> typeAnnotations;
     bool isFunctionCall = false;
-    std::unordered_set<std::string> addedBuiltins; // Track added built-in functions
-    std::vector<int> indentStack;  // Stack of indentation levels
+    std::vector<int> indentStack = {0};  // Stack of indentation levels
     int currentIndent = 0;         // Current indentation level
     bool atStartOfLine = true;     // Flag for start of line
+    TokenRing* tokenSink = nullptr; // Pipeline mode: tokens are also published here
+    const CancellationToken* cancellation = nullptr;
+    size_t sinkBatchSize = 0;
+    size_t publishedTokens = 0;    // tokens already pushed to tokenSink
+    std::vector<BlockSpan> blocks; // in INDENT order
+    std::vector<size_t> openBlocks; // blocks whose DEDENT is still to come
+    size_t commentTokens = 0;
 
     const std::unordered_set<std::string> keywords = {
         "False", "None", "True", "and", "as", "assert", "async", "await",
@@ -110,6 +79,11 @@ private:
         "int", "float", "str", "bool", "complex"
     };
 
+    // Identifiers match keywords and builtins regardless of case; these
+    // hold the two sets above lowercased, for one lookup per identifier
+    std::unordered_set<std::string> lowerKeywords;
+    std::unordered_set<std::string> lowerBuiltins;
+
     char current() const { return pos < source.size() ? source[pos] : '\0'; }
     char peek() const { return pos + 1 < source.size() ? source[pos + 1] : '\0'; }
 
@@ -125,15 +99,26 @@ private:
     void processIdentifier();
     void processComment();
     void processOperator();
-    double evalRPN(const std::vector<Token>& rpn);
-    std::vector<Token> toRPN(const std::vector<Token>& input);
     void processAssignments();
     bool processTypeAnnotation();
     void handleIndentation();
+    void publishTokens();
 public:
     PythonLexer(const std::string& input);
     std::pair<std::vector<Token>, std::vector<LexicalError>> tokenize();
     const SymbolTable& getSymbolTable() const { return symbolTable; }
+
+    // Every block of the last tokenize(), matched while lexing so the
+    // parser can skip a block without scanning for its end
+    const std::vector<BlockSpan>& getBlocks() const { return blocks; }
+
+    // Pipeline mode: tokenize() also pushes every `batchSize` new tokens to
+    // `ring` (waiting while it is full) and closes it after ENDOFFILE
+    void setTokenSink(TokenRing* ring, size_t batchSize = 1024);
+
+    // Stop at the next character once `token` is cancelled; the token
+    // stream then ends early
+    void setCancellation(const CancellationToken* token) { cancellation = token; }
 };
 
 std::string tokenTypeToString(TokenType type);
@@ -0,0 +1,171 @@
+// scoperesolver.cpp
+#include "scoperesolver.h"
+
+namespace {
+
+// Builtins the VM implements; any other unbound name is a (missing) global
+const char* const BUILTIN_NAMES[] = { "print", "len", "input", "range" };
+
+} // namespace
+
+int32_t ScopeResolver::openScope(Scope::Kind kind, int32_t parent, const ParseNode* node, const std::string& name) {
+    Scope scope;
+    scope.kind = kind;
+    scope.parent = parent;
+    scope.node = node;
+    scope.name = name;
+    scopes.push_back(std::move(scope));
+    bindings.emplace_back();
+    pending.emplace_back();
+    return int32_t(scopes.size() - 1);
+}
+
+int32_t ScopeResolver::bind(int32_t scope, SymbolId name) {
+    auto inserted = bindings[scope].emplace(name, int32_t(scopes[scope].names.size()));
+    if (inserted.second) scopes[scope].names.push_back(name);
+    return inserted.first->second;
+}
+
+// A binding occurrence: the name is local to `scope` from now on
+void ScopeResolver::declare(int32_t scope, const ParseNode* node) {
+    if (!node) return;
+    const SymbolId name = names.intern(node->value.toStdString());
+    nodeSlots[node] = { scope, bind(scope, name) };
+}
+
+// A use: resolved when `scope` closes, since a later binding in the same
+// scope still makes the name local
+void ScopeResolver::use(int32_t scope, const ParseNode* node) {
+    pending[scope].push_back({ node, names.intern(node->value.toStdString()) });
+}
+
+void ScopeResolver::closeScope(int32_t scope) {
+    std::vector<Reference> references;
+    references.swap(pending[scope]);
+    const bool isModule = scopes[scope].kind == Scope::Kind::Module;
+
+    for (const Reference& ref : references) {
+        auto local = bindings[scope].find(ref.name);
+        if (local != bindings[scope].end()) {
+            nodeSlots[ref.node] = { scope, local->second };
+        } else if (!isModule) {
+            pending[scopes[scope].parent].push_back(ref);
+        } else {
+            auto builtin = bindings[BUILTIN_SCOPE].find(ref.name);
+            if (builtin != bindings[BUILTIN_SCOPE].end()) {
+                nodeSlots[ref.node] = { BUILTIN_SCOPE, builtin->second };
+            } else {
+                nodeSlots[ref.node] = { scope, bind(scope, ref.name) };
+            }
+        }
+    }
+}
+
+void ScopeResolver::run(ParseNode* root) {
+    names = StringInterner();
+    scopes.clear();
+    bindings.clear();
+    pending.clear();
+    nodeSlots.clear();
+    functionScopes.clear();
+    errors.clear();
+
+    openScope(Scope::Kind::Builtin, -1, nullptr, "<builtins>");
+    for (const char* builtin : BUILTIN_NAMES) {
+        bind(BUILTIN_SCOPE, names.intern(builtin));
+    }
+    openScope(Scope::Kind::Module, BUILTIN_SCOPE, root, "<module>");
+
+    // Explicit stack; a task with a null node closes its scope, and is
+    // pushed before the scope's body so it runs after it
+    struct Task {
+        ParseNode* node;
+        int32_t scope;
+        bool close;
+    };
+    std::vector<Task> stack;
+    stack.push_back({ nullptr, MODULE_SCOPE, true });
+    if (root) stack.push_back({ root, MODULE_SCOPE, false });
+
+    auto pushChildren = [&stack](ParseNode* node, int first, int32_t scope) {
+        for (int i = node->children.size() - 1; i >= first; --i) {
+            stack.push_back({ node->children[i], scope, false });
+        }
+    };
+
+    while (!stack.empty()) {
+        const Task task = stack.back();
+        stack.pop_back();
+        if (task.close) {
+            closeScope(task.scope);
+            continue;
+        }
+        ParseNode* node = task.node;
+        if (!node) continue;
+        if (node->lazy) {
+            if (!materializeBlocks) continue;
+            std::vector<SyntaxError> blockErrors;
+            SyntaxAnalyzer::materialize(node, &blockErrors);
+            for (const auto& err : blockErrors) {
+                errors.push_back({ err.message, err.line });
+            }
+        }
+
+        const QString& kind = node->name;
+        if (kind == "Identifier") {
+            use(task.scope, node);
+        } else if (kind == "FuncCall") {
+            use(task.scope, node);
+            pushChildren(node, 0, task.scope);
+        } else if (kind == "Assignment") {
+            declare(task.scope, node->children.value(0));
+            pushChildren(node, 1, task.scope);
+        } else if (kind == "ForStmt") {
+            if (ParseNode* targets = node->children.value(0)) {
+                for (ParseNode* target : targets->children) {
+                    declare(task.scope, target);
+                }
+            }
+            pushChildren(node, 1, task.scope);
+        } else if (kind == "FuncDef") {
+            ParseNode* nameNode = node->children.value(0);
+            declare(task.scope, nameNode);
+
+            const int32_t function = openScope(Scope::Kind::Function, task.scope, node,
+                                               nameNode ? nameNode->value.toStdString() : std::string());
+            functionScopes[node] = function;
+            stack.push_back({ nullptr, function, true });
+
+            for (int i = 1; i < node->children.size(); ++i) {
+                ParseNode* child = node->children[i];
+                if (!child || child->name != "ParamList") continue;
+                for (ParseNode* param : child->children) {
+                    const SymbolId name = names.intern(param->value.toStdString());
+                    if (bindings[function].count(name)) {
+                        errors.push_back({ "duplicate argument '" + param->value.toStdString() +
+                                           "' in function definition", node->line });
+                    }
+                    declare(function, param);
+                }
+            }
+            scopes[function].params = uint16_t(scopes[function].names.size());
+
+            for (int i = node->children.size() - 1; i >= 1; --i) {
+                ParseNode* child = node->children[i];
+                if (child && child->name != "ParamList") stack.push_back({ child, function, false });
+            }
+        } else {
+            pushChildren(node, 0, task.scope);
+        }
+    }
+}
+
+const Slot* ScopeResolver::slotOf(const ParseNode* node) const {
+    auto it = nodeSlots.find(node);
+    return it != nodeSlots.end() ? &it->second : nullptr;
+}
+
+int32_t ScopeResolver::scopeOf(const ParseNode* funcDef) const {
+    auto it = functionScopes.find(funcDef);
+    return it != functionScopes.end() ? it->second : -1;
+}
@@ -0,0 +1,85 @@
+// scoperesolver.h
+#ifndef SCOPERESOLVER_H
+#define SCOPERESOLVER_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "symboltable.h"
+#include "syntaxanalyzer.h"
+
+// Where a name lives: slot `index` of scope `scope`
+struct Slot {
+    int32_t scope = -1;
+    int32_t index = -1;
+};
+
+// One namespace of the program. Slots are numbered in order of binding:
+// for a function its parameters first, then its other locals; for the
+// module its globals, then names that are read but never bound there.
+struct Scope {
+    enum class Kind : uint8_t { Builtin, Module, Function };
+    Kind kind = Kind::Module;
+    int32_t parent = -1;
+    const ParseNode* node = nullptr;    // FuncDef, or the program root
+    std::string name;
+    uint16_t params = 0;
+    std::vector<SymbolId> names;        // indexed by slot
+};
+
+struct ResolveError {
+    std::string message;
+    int line;
+};
+
+// Resolves every name reference of a parse tree to a Slot with Python's
+// rules: a name bound anywhere in a function (parameter, assignment or for
+// target, nested def) is local to the whole function; any other name is
+// looked up in the enclosing functions, then the module, then the
+// builtins. Runs in one traversal: references wait in their scope until
+// the scope is closed, and those it does not bind move to its parent.
+class ScopeResolver {
+public:
+    static constexpr int32_t BUILTIN_SCOPE = 0;
+    static constexpr int32_t MODULE_SCOPE = 1;
+
+    // Parse unparsed Block nodes of a lazily parsed tree as they are
+    // reached; otherwise names inside them stay unresolved
+    void setMaterializeBlocks(bool enabled) { materializeBlocks = enabled; }
+
+    void run(ParseNode* root);
+
+    // Slot of an Identifier node, or of the callee of a FuncCall node;
+    // null for nodes that are not name references
+    const Slot* slotOf(const ParseNode* node) const;
+    // Function scope opened by a FuncDef node, or -1
+    int32_t scopeOf(const ParseNode* funcDef) const;
+
+    const std::vector<Scope>& getScopes() const { return scopes; }
+    std::string_view nameOf(const Slot& slot) const { return names.view(scopes[slot.scope].names[slot.index]); }
+    const std::vector<ResolveError>& getErrors() const { return errors; }
+
+private:
+    struct Reference {
+        const ParseNode* node;
+        SymbolId name;
+    };
+
+    bool materializeBlocks = false;
+    StringInterner names;
+    std::vector<Scope> scopes;
+    std::vector<std::unordered_map<SymbolId, int32_t>> bindings;   // per scope: name -> slot
+    std::vector<std::vector<Reference>> pending;                   // per scope: unresolved uses
+    std::unordered_map<const ParseNode*, Slot> nodeSlots;
+    std::unordered_map<const ParseNode*, int32_t> functionScopes;
+    std::vector<ResolveError> errors;
+
+    int32_t openScope(Scope::Kind kind, int32_t parent, const ParseNode* node, const std::string& name);
+    int32_t bind(int32_t scope, SymbolId name);
+    void declare(int32_t scope, const ParseNode* node);
+    void use(int32_t scope, const ParseNode* node);
+    void closeScope(int32_t scope);
+};
+
+#endif // SCOPERESOLVER_H
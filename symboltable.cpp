@@ -0,0 +1,79 @@
+// symboltable.cpp
+#include "symboltable.h"
+
+//——— StringInterner ———
+
+// FNV-1a
+uint64_t StringInterner::hashOf(std::string_view text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Slot holding `text`, or the empty slot where it would go
+size_t StringInterner::probe(std::string_view text, uint64_t hash) const {
+    const size_t mask = buckets.size() - 1;
+    size_t i = size_t(hash) & mask;
+    while (buckets[i] != EMPTY) {
+        const Span& span = spans[buckets[i]];
+        if (span.hash == hash && view(buckets[i]) == text) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+SymbolId StringInterner::find(std::string_view text) const {
+    return buckets[probe(text, hashOf(text))];
+}
+
+SymbolId StringInterner::intern(std::string_view text) {
+    const uint64_t hash = hashOf(text);
+    size_t slot = probe(text, hash);
+    if (buckets[slot] != EMPTY) return buckets[slot];
+
+    const SymbolId id = SymbolId(spans.size());
+    spans.push_back({ uint32_t(chars.size()), uint32_t(text.size()), hash });
+    chars.append(text.data(), text.size());
+    buckets[slot] = id;
+    if (spans.size() * 2 > buckets.size()) grow();
+    return id;
+}
+
+void StringInterner::grow() {
+    std::vector<SymbolId> old(buckets.size() * 2, EMPTY);
+    old.swap(buckets);
+    const size_t mask = buckets.size() - 1;
+    for (SymbolId id = 0; id < spans.size(); ++id) {
+        size_t i = size_t(spans[id].hash) & mask;
+        while (buckets[i] != EMPTY) i = (i + 1) & mask;
+        buckets[i] = id;
+    }
+}
+
+//——— SymbolTable ———
+
+const char* dataTypeName(DataType type) {
+    switch (type) {
+    case DataType::Int:      return "int";
+    case DataType::Float:    return "float";
+    case DataType::Str:      return "str";
+    case DataType::Bool:     return "bool";
+    case DataType::Function: return "function";
+    case DataType::None:     return "NoneType";
+    default:                 return "unknown";
+    }
+}
+
+SymbolId SymbolTable::addIdentifier(std::string_view identifier) {
+    const SymbolId id = names.intern(identifier);
+    if (id == entries.size()) entries.emplace_back();
+    return id;
+}
+
+const std::string& SymbolTable::value(SymbolId id) const {
+    static const std::string notAvailable = "N/A";
+    return entries[id].value.empty() ? notAvailable : entries[id].value;
+}
@@ -0,0 +1,84 @@
+// symboltable.h
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Dense index of an interned string or symbol: 0, 1, 2, ... in order of
+// first appearance
+using SymbolId = uint32_t;
+constexpr SymbolId NO_SYMBOL = UINT32_MAX;
+
+// Hands out one SymbolId per distinct string. The characters live back to
+// back in one buffer and the index is an open-addressing table of ids
+// (linear probing, at most half full), so a lookup hashes once and never
+// allocates.
+class StringInterner {
+public:
+    StringInterner() : buckets(16, EMPTY) {}
+
+    SymbolId intern(std::string_view text);
+    SymbolId find(std::string_view text) const;     // NO_SYMBOL if absent
+
+    // Valid until the next intern()
+    std::string_view view(SymbolId id) const {
+        return std::string_view(chars.data() + spans[id].offset, spans[id].length);
+    }
+    size_t size() const { return spans.size(); }
+
+private:
+    struct Span {
+        uint32_t offset;
+        uint32_t length;
+        uint64_t hash;      // kept so growing the table never rehashes text
+    };
+
+    static constexpr SymbolId EMPTY = NO_SYMBOL;
+
+    std::string chars;
+    std::vector<Span> spans;        // indexed by SymbolId
+    std::vector<SymbolId> buckets;  // power-of-two sized hash table
+
+    static uint64_t hashOf(std::string_view text);
+    size_t probe(std::string_view text, uint64_t hash) const;
+    void grow();
+};
+
+// Python types the analysis can tell apart
+enum class DataType : uint8_t { Unknown, Int, Float, Str, Bool, Function, None };
+
+const char* dataTypeName(DataType type);
+
+// Identifiers of one program with what is known about them. Entries are
+// stored flat, indexed by the SymbolId the interner gave their name, so
+// everything after the name lookup is an array access.
+class SymbolTable {
+public:
+    SymbolId addIdentifier(std::string_view identifier);
+    SymbolId lookup(std::string_view identifier) const { return names.find(identifier); }
+
+    void setInfo(SymbolId id, DataType type, std::string value) {
+        entries[id].type = type;
+        entries[id].value = std::move(value);
+    }
+    void setDataType(SymbolId id, DataType type) { entries[id].type = type; }
+
+    size_t size() const { return entries.size(); }
+    std::string_view name(SymbolId id) const { return names.view(id); }
+    DataType dataType(SymbolId id) const { return entries[id].type; }
+    const std::string& value(SymbolId id) const;    // "N/A" until set
+
+private:
+    struct Entry {
+        DataType type = DataType::Unknown;
+        std::string value;      // empty while unknown
+    };
+
+    StringInterner names;
+    std::vector<Entry> entries;
+};
+
+#endif // SYMBOLTABLE_H
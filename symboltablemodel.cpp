@@ -0,0 +1,167 @@
+// symboltablemodel.cpp
+#include "symboltablemodel.h"
+#include <algorithm>
+#include <cstring>
+
+SymbolTableModel::SymbolTableModel(QObject* parent)
+    : QAbstractTableModel(parent) {}
+
+// IDs are given in order of appearance, so an edit below the first use of
+// every name leaves the rows above it, and usually most rows, unchanged
+void SymbolTableModel::update(SymbolTable next) {
+    const size_t oldCount = symbols.size();
+    const size_t newCount = next.size();
+    std::vector<SymbolId> changed;
+    for (SymbolId id = 0; id < std::min(oldCount, newCount); ++id) {
+        if (symbols.name(id) != next.name(id) || symbols.dataType(id) != next.dataType(id) ||
+            symbols.value(id) != next.value(id)) {
+            changed.push_back(id);
+        }
+    }
+
+    if (inIdOrder()) {
+        if (newCount < oldCount) {
+            beginRemoveRows(QModelIndex(), int(newCount), int(oldCount) - 1);
+            symbols = std::move(next);
+            endRemoveRows();
+        } else if (newCount > oldCount) {
+            beginInsertRows(QModelIndex(), int(oldCount), int(newCount) - 1);
+            symbols = std::move(next);
+            endInsertRows();
+        } else {
+            symbols = std::move(next);
+        }
+    } else if (newCount != oldCount) {
+        // Rows come and go all over a sorted view; start over
+        beginResetModel();
+        symbols = std::move(next);
+        order = sortedOrder(symbols);
+        endResetModel();
+        return;
+    } else {
+        if (changed.empty()) {
+            symbols = std::move(next);
+            return;
+        }
+        applyOrder(sortedOrder(next), &next);
+    }
+
+    // One signal per run of adjacent changed rows
+    std::vector<int> rows;
+    rows.reserve(changed.size());
+    if (order.empty()) {
+        rows.assign(changed.begin(), changed.end());
+    } else {
+        std::vector<int> rowOf(order.size());
+        for (size_t row = 0; row < order.size(); ++row) rowOf[order[row]] = int(row);
+        for (SymbolId id : changed) rows.push_back(rowOf[id]);
+        std::sort(rows.begin(), rows.end());
+    }
+    for (size_t i = 0; i < rows.size();) {
+        size_t j = i + 1;
+        while (j < rows.size() && rows[j] == rows[j - 1] + 1) ++j;
+        emit dataChanged(index(rows[i], 0), index(rows[j - 1], ColumnCount - 1), { Qt::DisplayRole });
+        i = j;
+    }
+}
+
+int SymbolTableModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : int(symbols.size());
+}
+
+int SymbolTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant SymbolTableModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || role != Qt::DisplayRole) return QVariant();
+    const SymbolId id = symbolAt(index.row());
+    switch (index.column()) {
+    case IdColumn:
+        return int(id + 1);
+    case NameColumn: {
+        const std::string_view name = symbols.name(id);
+        return QString::fromUtf8(name.data(), int(name.size()));
+    }
+    case TypeColumn:
+        return QString::fromLatin1(dataTypeName(symbols.dataType(id)));
+    case ValueColumn:
+        return QString::fromStdString(symbols.value(id));
+    default:
+        return QVariant();
+    }
+}
+
+QVariant SymbolTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case IdColumn:    return QString("ID");
+    case NameColumn:  return QString("Identifier");
+    case TypeColumn:  return QString("Data Type");
+    case ValueColumn: return QString("Value");
+    default:          return QVariant();
+    }
+}
+
+void SymbolTableModel::sort(int column, Qt::SortOrder order) {
+    if (column < 0 || column >= ColumnCount) return;
+    sortColumn = column;
+    sortOrder = order;
+    applyOrder(sortedOrder(symbols));
+}
+
+// Stable, so ties stay in ID order; empty for ID order itself
+std::vector<SymbolId> SymbolTableModel::sortedOrder(const SymbolTable& table) const {
+    std::vector<SymbolId> ids;
+    if (inIdOrder()) return ids;
+    ids.resize(table.size());
+    for (SymbolId id = 0; id < ids.size(); ++id) ids[id] = id;
+
+    auto less = [this, &table](SymbolId a, SymbolId b) {
+        switch (sortColumn) {
+        case NameColumn:
+            return table.name(a) < table.name(b);
+        case TypeColumn:
+            return std::strcmp(dataTypeName(table.dataType(a)), dataTypeName(table.dataType(b))) < 0;
+        case ValueColumn:
+            return table.value(a) < table.value(b);
+        default:
+            return a < b;
+        }
+    };
+    if (sortOrder == Qt::AscendingOrder) {
+        std::stable_sort(ids.begin(), ids.end(), less);
+    } else {
+        std::stable_sort(ids.begin(), ids.end(), [&less](SymbolId a, SymbolId b) { return less(b, a); });
+    }
+    return ids;
+}
+
+// Move the rows to a new order, keeping selections and the current row on
+// the same symbols. A `table` of the same size is swapped in only after the
+// view has been told, so it never paints new contents in the old layout.
+void SymbolTableModel::applyOrder(std::vector<SymbolId> next, SymbolTable* table) {
+    if (next == order) {
+        if (table) symbols = std::move(*table);
+        return;
+    }
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    if (table) symbols = std::move(*table);
+
+    std::vector<int> rowOf(symbols.size());
+    for (size_t row = 0; row < rowOf.size(); ++row) {
+        rowOf[next.empty() ? row : next[row]] = int(row);
+    }
+    const QModelIndexList from = persistentIndexList();
+    QModelIndexList to;
+    to.reserve(from.size());
+    for (const QModelIndex& index : from) {
+        to.append(createIndex(rowOf[symbolAt(index.row())], index.column()));
+    }
+    order = std::move(next);
+    changePersistentIndexList(from, to);
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
@@ -0,0 +1,46 @@
+// symboltablemodel.h
+#ifndef SYMBOLTABLEMODEL_H
+#define SYMBOLTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <cstdint>
+#include <vector>
+#include "symboltable.h"
+
+// Symbol table of the last analysis for a QTableView.
+//
+// Rows are the table's entries in SymbolId order, which is the order of
+// first appearance, so that order needs no index. A new analysis only
+// signals the rows whose name, type or value differ from the previous one;
+// the view repaints those and leaves the rest alone. Sorting by another
+// column is done only when the view asks for it.
+class SymbolTableModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { IdColumn, NameColumn, TypeColumn, ValueColumn, ColumnCount };
+
+    explicit SymbolTableModel(QObject* parent = nullptr);
+
+    // Replace the table, announcing only what changed
+    void update(SymbolTable next);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+    SymbolTable symbols;
+    std::vector<SymbolId> order;    // symbol in each row; empty in SymbolId order
+    int sortColumn = IdColumn;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+
+    SymbolId symbolAt(int row) const { return order.empty() ? SymbolId(row) : order[row]; }
+    bool inIdOrder() const { return sortColumn == IdColumn && sortOrder == Qt::AscendingOrder; }
+    std::vector<SymbolId> sortedOrder(const SymbolTable& table) const;
+    void applyOrder(std::vector<SymbolId> next, SymbolTable* table = nullptr);
+};
+
+#endif // SYMBOLTABLEMODEL_H
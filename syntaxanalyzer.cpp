@@ -1,58 +1,352 @@
 // syntaxanalyzer.cpp
 #include "syntaxanalyzer.h"
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <limits>
 using namespace std;
 
-SyntaxAnalyzer::~SyntaxAnalyzer() {
-    // Ideally delete all nodes; omitted for brevity
-}
-
 ParseNode* SyntaxAnalyzer::parseProgram() {
     ParseNode* root = new ParseNode("Program");
 
+    if (tokenRing) {
+        // The stream is still arriving; parse until ENDOFFILE
+        fillTo(pos + 1);
+        parseStatementsUntil(std::numeric_limits<size_t>::max(), root->children);
+        // A cancelled parse stops the lexer too, which may be waiting on a full ring
+        if (tokenRing && cancellation && cancellation->isCancelled()) tokenRing->close();
+        return root;
+    }
+
     // Debug: Print token stream
-    std::cout << "Token stream:" << std::endl;
-    for (size_t i = 0; i < tokens.size(); i++) {
-        std::cout << "Token " << i << ": type=" << tokenTypeToString(tokens[i].type)
-        << ", lexeme='" << tokens[i].lexeme
-        << "', line=" << tokens[i].line
-        << ", col=" << tokens[i].column << std::endl;
+    if (trace) printTokenStream();
+
+    parseStatementsUntil(tokens.size(), root->children);
+
+    return root;
+}
+
+void SyntaxAnalyzer::parseStatementsUntil(size_t end, QVector<ParseNode*>& out) {
+    while (!isAtEnd() && pos < end && !(cancellation && cancellation->isCancelled())) {
+        ParseNode* stmt = parseTopLevelStep();
+
+        // Only push if a valid node was returned
+        if (stmt) {
+            out.push_back(stmt);
+        }
     }
-    std::cout << std::endl;
+}
+
+ParseNode* SyntaxAnalyzer::parseTopLevelStep() {
+    // Skip blank lines
+    if (currentToken().type == TokenType::NEWLINE) {
+        advance();
+        return nullptr;
+    }
+
+    size_t startPos = pos;
+    ParseNode* stmt = parseStmt();
+
+    // ——— SAFETY: always ensure progress ———
+    if (pos == startPos) {
+        advance(); // move forward to escape the loop
+    }
+    return stmt;
+}
+
+//——— Streaming (statement callback) parsing ———
+
+namespace {
 
+// Tokens behind the parser are dropped once this many have piled up, so
+// each token kept is moved only once per this many consumed
+const size_t STREAM_DROP_TOKENS = 4096;
+
+} // namespace
+
+size_t SyntaxAnalyzer::parseStreaming(const StatementVisitor& visitor) {
+    size_t visited = 0;
+    fillTo(pos + 1);
     while (!isAtEnd()) {
-        // Skip blank lines
-        if (currentToken().type == TokenType::NEWLINE) {
-            advance();
-            continue;
+        // Fed from the ring, nothing refers back to finished statements;
+        // the last token stays, as a body looks back at its INDENT
+        if (&tokens == &streamedTokens && pos >= STREAM_DROP_TOKENS) {
+            streamedTokens.erase(streamedTokens.begin(), streamedTokens.begin() + ptrdiff_t(pos - 1));
+            pos = 1;
         }
 
-        size_t startPos = pos;
-        ParseNode* stmt = parseStmt();
+        ParseNode* stmt = parseTopLevelStep();
+        if (!stmt) continue;
 
-        // Only push if a valid node was returned
-        if (stmt) {
-            root->children.push_back(stmt);
+        visitor(stmt);
+        deleteTree(stmt);
+        visited++;
+    }
+    return visited;
+}
+
+void SyntaxAnalyzer::deleteTree(ParseNode* node) {
+    std::vector<ParseNode*> pending;
+    if (node) pending.push_back(node);
+
+    while (!pending.empty()) {
+        ParseNode* current = pending.back();
+        pending.pop_back();
+        for (auto* child : current->children) {
+            if (child) pending.push_back(child);
         }
+        delete current;
+    }
+}
+
+//——— Parallel top-level parsing ———
+
+namespace {
+
+// Below this many tokens the thread start-up costs more than it saves
+const size_t MIN_PARALLEL_TOKENS = 8192;
+// Smallest run of tokens handed to a single worker
+const size_t MIN_SEGMENT_TOKENS = 2048;
+
+struct Segment {
+    size_t begin = 0;
+    size_t end = 0;
+    size_t stopPos = 0;               // where the worker's parser actually stopped
+    QVector<ParseNode*> statements;
+    std::vector<SyntaxError> errors;
+};
+
+} // namespace
 
-        // ——— SAFETY: always ensure progress ———
-        if (pos == startPos) {
-            advance(); // move forward to escape the loop
+std::vector<size_t> SyntaxAnalyzer::findTopLevelBoundaries() const {
+    std::vector<size_t> boundaries;
+    int depth = 0;
+    bool atLineStart = true;
+
+    for (size_t i = pos; i < tokens.size(); ++i) {
+        const Token& tok = tokens[i];
+        switch (tok.type) {
+        case TokenType::NEWLINE:
+            atLineStart = true;
+            break;
+        case TokenType::INDENT:
+            depth++;
+            break;
+        case TokenType::DEDENT:
+            if (depth > 0) depth--;
+            break;
+        case TokenType::ENDOFFILE:
+            return boundaries;
+        default:
+            // 'elif'/'else' continue the preceding if statement
+            if (atLineStart && depth == 0 && i > pos &&
+                tok.lexeme != "elif" && tok.lexeme != "else") {
+                boundaries.push_back(i);
+            }
+            atLineStart = false;
+            break;
+        }
+    }
+    return boundaries;
+}
+
+ParseNode* SyntaxAnalyzer::parseProgramParallel(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // Workers would interleave their trace output, so tracing parses sequentially
+    if (trace || tokenRing || threadCount == 1 || tokens.size() - pos < MIN_PARALLEL_TOKENS) {
+        return parseProgram();
+    }
+
+    ParseNode* root = new ParseNode("Program");
+
+    // 1) Group top-level boundaries into segments of a useful size
+    std::vector<Segment> segments;
+    size_t segmentBegin = pos;
+    for (size_t boundary : findTopLevelBoundaries()) {
+        if (boundary - segmentBegin >= MIN_SEGMENT_TOKENS) {
+            Segment seg;
+            seg.begin = segmentBegin;
+            seg.end = boundary;
+            segments.push_back(std::move(seg));
+            segmentBegin = boundary;
+        }
+    }
+    Segment last;
+    last.begin = segmentBegin;
+    last.end = tokens.size();
+    segments.push_back(std::move(last));
+
+    // 2) Parse every segment independently on the pool
+    std::atomic<size_t> nextSegment{0};
+    auto worker = [this, &segments, &nextSegment]() {
+        for (size_t i = nextSegment++; i < segments.size(); i = nextSegment++) {
+            Segment& seg = segments[i];
+            SyntaxAnalyzer sub(tokens);
+            sub.lazyBlocks = lazyBlocks;
+            sub.blocks = blocks;
+            sub.cancellation = cancellation;
+            sub.trace = false;
+            sub.pos = seg.begin;
+            sub.parseStatementsUntil(seg.end, seg.statements);
+            seg.stopPos = sub.pos;
+            seg.errors = std::move(sub.syntaxErrors);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    unsigned workers = static_cast<unsigned>(std::min<size_t>(threadCount, segments.size()));
+    for (unsigned t = 1; t < workers; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& th : pool) {
+        th.join();
+    }
+
+    // 3) Stitch the segments in order. A statement that ran past its segment
+    // (e.g. during error recovery) invalidates the speculative parse of the
+    // next one, which is then redone sequentially from where it really starts.
+    for (Segment& seg : segments) {
+        if (pos == seg.begin) {
+            for (auto* stmt : seg.statements) {
+                root->children.push_back(stmt);
+            }
+            syntaxErrors.insert(syntaxErrors.end(), seg.errors.begin(), seg.errors.end());
+            pos = seg.stopPos;
+        } else {
+            for (auto* stmt : seg.statements) {
+                SyntaxAnalyzer::deleteTree(stmt);
+            }
+            if (pos < seg.end) {
+                parseStatementsUntil(seg.end, root->children);
+            }
         }
     }
 
     return root;
 }
 
-void SyntaxAnalyzer::populateTree(QTreeWidget* tree) {
-    tree->clear();
-    ParseNode* root = parseProgram();
-    // Display parse tree
-    QTreeWidgetItem* rootItem = new QTreeWidgetItem(tree);
-    rootItem->setText(0, root->name);
-    buildTree(rootItem, root);
-    tree->addTopLevelItem(rootItem);
-    tree->expandAll();
+//——— Lazy blocks ———
+
+void SyntaxAnalyzer::setLazyBlocks(bool enabled, std::shared_ptr<const std::vector<BlockSpan>> index) {
+    lazyBlocks = enabled && !tokenRing;
+    if (!lazyBlocks) return;
+    if (index) {
+        blocks = std::move(index);
+        return;
+    }
+    if (blocks) return;
+
+    // The same matching the lexer does: every INDENT with the DEDENT that
+    // closes it; blocks still open at the end are closed by ENDOFFILE
+    auto spans = std::make_shared<std::vector<BlockSpan>>();
+    std::vector<size_t> open;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].type == TokenType::INDENT) {
+            open.push_back(spans->size());
+            spans->push_back({ i, i });
+        } else if (tokens[i].type == TokenType::DEDENT && !open.empty()) {
+            (*spans)[open.back()].dedent = i;
+            open.pop_back();
+        }
+    }
+    for (size_t block : open) {
+        (*spans)[block].dedent = tokens.size() - 1;
+    }
+    blocks = std::move(spans);
+}
+
+ParseNode* SyntaxAnalyzer::parseLazyBlock() {
+    // Record the body as an unparsed span and jump to its DEDENT; blocks
+    // are in INDENT order
+    const size_t indent = pos - 1;
+    auto block = std::lower_bound(blocks->begin(), blocks->end(), indent,
+                                  [](const BlockSpan& span, size_t index) { return span.indent < index; });
+    const size_t end = block != blocks->end() && block->indent == indent ? block->dedent : tokens.size() - 1;
+    auto node = new ParseNode("Block", "unparsed");
+    node->lazy.reset(new LazyBlock{ &tokens, blocks, pos, end });
+    pos = end;
+    if (currentToken().type == TokenType::DEDENT) {
+        advance();
+    }
+    return node;
+}
+
+bool SyntaxAnalyzer::materialize(ParseNode* node, std::vector<SyntaxError>* errors) {
+    if (!node || !node->lazy) return false;
+    parseBlockBody(node, true, errors);
+    return true;
+}
+
+void SyntaxAnalyzer::parseBlockBody(ParseNode* node, bool lazyNested, std::vector<SyntaxError>* errors) {
+    std::unique_ptr<LazyBlock> span = std::move(node->lazy);
+    node->value = QString();
+
+    // Blocks are parsed on demand, often on the GUI thread; never traced
+    SyntaxAnalyzer sub(*span->tokens);
+    sub.trace = false;
+    sub.lazyBlocks = lazyNested;
+    sub.blocks = span->blocks;
+    sub.pos = span->begin;
+    sub.parseStatementsUntil(span->end, node->children);
+
+    if (errors) {
+        errors->insert(errors->end(), sub.syntaxErrors.begin(), sub.syntaxErrors.end());
+    }
+}
+
+void SyntaxAnalyzer::materializeAll(ParseNode* root, std::vector<SyntaxError>& errors,
+                                    const CancellationToken* cancel, unsigned threadCount) {
+    // Unparsed blocks have no children yet, so none is nested in another
+    std::vector<ParseNode*> pending;
+    std::vector<ParseNode*> stack;
+    if (root) stack.push_back(root);
+    while (!stack.empty()) {
+        ParseNode* node = stack.back();
+        stack.pop_back();
+        if (!node) continue;
+        if (node->lazy) {
+            pending.push_back(node);
+            continue;
+        }
+        for (ParseNode* child : node->children) {
+            stack.push_back(child);
+        }
+    }
+    if (pending.empty()) return;
+
+    // Each block is parsed eagerly, nested blocks included, by one worker
+    std::vector<std::vector<SyntaxError>> blockErrors(pending.size());
+    std::atomic<size_t> nextBlock{0};
+    auto worker = [&pending, &blockErrors, &nextBlock, cancel]() {
+        for (size_t i = nextBlock++; i < pending.size(); i = nextBlock++) {
+            if (cancel && cancel->isCancelled()) return;
+            parseBlockBody(pending[i], false, &blockErrors[i]);
+        }
+    };
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::thread> pool;
+    unsigned workers = static_cast<unsigned>(std::min<size_t>(threadCount, pending.size()));
+    for (unsigned t = 1; t < workers; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& th : pool) {
+        th.join();
+    }
+
+    for (const auto& found : blockErrors) {
+        errors.insert(errors.end(), found.begin(), found.end());
+    }
+    std::stable_sort(errors.begin(), errors.end(), [](const SyntaxError& a, const SyntaxError& b) {
+        return a.line != b.line ? a.line < b.line : a.column < b.column;
+    });
 }
 
 ParseNode* SyntaxAnalyzer::parseComparison() {
@@ -123,154 +417,312 @@ ParseNode* SyntaxAnalyzer::parseContinueStmt() {
 
 //——— Statement dispatch ———
 
+// Compound statements do not recurse into their bodies. Their headers push
+// a StmtFrame and report NeedBody; the driver below then parses the body
+// and hands it back to resumeStmt(), so nesting depth is limited only by
+// the size of stmtStack. A body is a "Block" holding every statement of
+// the indented suite (Suite -> NEWLINE INDENT Stmt Stmts DEDENT); a Block
+// frame collects them one at a time the same way.
 ParseNode* SyntaxAnalyzer::parseStmt() {
-    std::cout << "parseStmt: current token type=" << tokenTypeToString(currentToken().type)
+    const size_t base = stmtStack.size();
+    ParseNode* result = nullptr;
+    StmtStep step = parseStmtHead(result);
+
+    while (true) {
+        if (step == StmtStep::NeedBody) {
+            if (pos > 0 && tokens[pos - 1].type == TokenType::INDENT) {
+                if (lazyBlocks) {
+                    // Lazy mode records the whole block instead of descending
+                    result = parseLazyBlock();
+                } else {
+                    stmtStack.push_back({ StmtFrame::Block, new ParseNode("Block") });
+                    result = nullptr;
+                }
+                step = resumeStmt(result);
+            } else {
+                // A header whose block is missing takes the next statement
+                step = parseStmtHead(result);
+            }
+            continue;
+        }
+        if (stmtStack.size() == base) {
+            return result;
+        }
+        step = resumeStmt(result);
+    }
+}
+
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::parseStmtHead(ParseNode*& result) {
+    result = nullptr;
+
+    if (trace) std::cout << "parseStmt: current token type=" << tokenTypeToString(currentToken().type)
     << ", lexeme='" << currentToken().lexeme
     << "', line=" << currentToken().line
     << ", col=" << currentToken().column << std::endl;
 
     // Handle DEDENT - it's not a statement, just return nullptr to end the block
     if (currentToken().type == TokenType::DEDENT) {
-        std::cout << "  Found DEDENT - ending block" << std::endl;
+        if (trace) std::cout << "  Found DEDENT - ending block" << std::endl;
         advance(); // consume the DEDENT
-        return nullptr;
+        return StmtStep::Done;
     }
 
     // 1) Skip blank lines, comments, and handle indentation
     while (!isAtEnd() && (currentToken().type == TokenType::NEWLINE || 
                          currentToken().type == TokenType::COMMENT)) {
         advance();
-        std::cout << "  Skipped newline or comment" << std::endl;
+        if (trace) std::cout << "  Skipped newline or comment" << std::endl;
     }
 
     // Handle whitespace/indentation without consuming statement tokens
     while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
                           currentToken().type == TokenType::INDENT ||
                           currentToken().type == TokenType::DEDENT)) {
-        std::cout << "  Skipped " << tokenTypeToString(currentToken().type) << std::endl;
+        if (trace) std::cout << "  Skipped " << tokenTypeToString(currentToken().type) << std::endl;
         advance();
     }
 
     // Skip any inline comments before processing the statement
     while (!isAtEnd() && currentToken().type == TokenType::COMMENT) {
         advance();
-        std::cout << "  Skipped inline comment" << std::endl;
+        if (trace) std::cout << "  Skipped inline comment" << std::endl;
     }
 
     // 2) Skip stray colons
     while (!isAtEnd() && currentToken().lexeme == ":") {
-        std::cout << "  Skipped colon" << std::endl;
+        if (trace) std::cout << "  Skipped colon" << std::endl;
         advance();
     }
 
-    // 3) Statement heads
-    if (match("if")) {
-        std::cout << "  Parsing if statement" << std::endl;
-        auto core = parseIfCore();
-        return parseIfChain(core);
+    // 3) Parse the statement and record where it starts
+    const int line = currentToken().line;
+    const int column = currentToken().column;
+    StmtStep step = dispatchStmt(result);
+    ParseNode* stmt = step == StmtStep::NeedBody ? stmtStack.back().node : result;
+    if (stmt && stmt->line == 0) {
+        stmt->line = line;
+        stmt->column = column;
     }
-    if (match("for"))   return parseForStmt();
-    if (match("while")) return parseWhileStmt();
-    if (match("def"))   return parseFuncDef();
-    if (match("return")) return parseReturnStmt();
-    if (match("pass"))   return parsePassStmt();
-    if (match("else")) {
-        addSyntaxError("'else' without matching 'if'",
+    return step;
+}
+
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::dispatchStmt(ParseNode*& result) {
+    // Pick the statement from the LL(1) table (see grammar.h)
+    const grammar::Terminal la = lookahead();
+    switch (grammar::selectAction(grammar::NonTerminal::Stmt, la)) {
+    case grammar::Action::If:
+        advance();
+        if (trace) std::cout << "  Parsing if statement" << std::endl;
+        return parseIfStmt(result);
+    case grammar::Action::For:
+        advance();
+        return parseForStmt(result);
+    case grammar::Action::While:
+        advance();
+        return parseWhileStmt(result);
+    case grammar::Action::Def:
+        advance();
+        return parseFuncDef();
+    case grammar::Action::Return:
+        advance();
+        result = parseReturnStmt();
+        return StmtStep::Done;
+    case grammar::Action::Pass:
+        advance();
+        result = parsePassStmt();
+        return StmtStep::Done;
+    case grammar::Action::Break:
+        advance();
+        result = parseBreakStmt();
+        return StmtStep::Done;
+    case grammar::Action::Continue:
+        advance();
+        result = parseContinueStmt();
+        return StmtStep::Done;
+    case grammar::Action::Builtin:
+        result = parseBuiltinCall();
+        return StmtStep::Done;
+    case grammar::Action::Assign:
+        result = parseAssignment();
+        return StmtStep::Done;
+    default:
+        break;
+    }
+
+    // No statement starts with elif/else outside an if chain
+    if (la == grammar::Terminal::Elif || la == grammar::Terminal::Else) {
+        std::string keyword = currentToken().lexeme;
+        advance();
+        addSyntaxError("'" + keyword + "' without matching 'if'",
                        currentToken().line, currentToken().column);
-        return nullptr;
+        return StmtStep::Done;
     }
-    if (match("elif")) {
-        addSyntaxError("'elif' without matching 'if'",
+
+    // Expression statement; also the fallback that reports tokens no
+    // production starts with
+    result = parseExprStmt();
+    if (!result) {
+        addSyntaxError("Invalid expression or unknown statement",
                        currentToken().line, currentToken().column);
-        return nullptr;
     }
-    if (match("break"))  return parseBreakStmt();
-    if (match("continue")) return parseContinueStmt();
+    return StmtStep::Done;
+}
 
-    // 4) Built-in functions like print
-    if (currentToken().type == TokenType::IDENTIFIER) {
-        std::string funcName = currentToken().lexeme;
-        std::cout << "  Found identifier: " << funcName << std::endl;
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::resumeStmt(ParseNode*& result) {
+    StmtFrame frame = stmtStack.back();
+    stmtStack.pop_back();
+    ParseNode* body = result;
+    ParseNode* node = frame.node;
 
-        // Check if it's a built-in function
-        if (funcName == "print" || funcName == "len" || funcName == "input") {
-            auto node = new ParseNode("FuncCall", QString::fromStdString(funcName));
-            advance(); // consume function name
+    switch (frame.kind) {
+    case StmtFrame::IfBody:
+        if (!body) {
+            deleteTree(node);
+            node = nullptr;
+        } else {
+            node->children.push_back(body);
+        }
+        return parseIfChain(node, true, result);
 
-            // For print statements, parentheses are optional
-            if (funcName == "print") {
-                std::cout << "  Handling print statement" << std::endl;
+    case StmtFrame::ElifBody: {
+        bool validElif = frame.valid && body != nullptr;
 
-                // Skip any whitespace after print
-                while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
-                    advance();
-                }
+        // Only add valid elif nodes to the chain
+        if (validElif && node) {
+            frame.clause->children.push_back(frame.cond);
+            frame.clause->children.push_back(body);
+            node->children.push_back(frame.clause);
+        } else {
+            deleteTree(frame.cond);
+            deleteTree(frame.clause);
+            deleteTree(body);
+        }
 
-                // If there are parentheses, parse them
-                if (match("(")) {
-                    std::cout << "  Found opening parenthesis" << std::endl;
-                    // Parse arguments
-                    if (!isAtEnd() && currentToken().lexeme != ")") {
-                        do {
-                            // Skip any whitespace before argument
-                            while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
-                                advance();
-                            }
-
-                            auto arg = parseExpression();
-                            if (!arg) {
-                                delete node;
-                                return nullptr;
-                            }
-                            node->children.push_back(arg);
-
-                            // Skip any whitespace after argument
-                            while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
-                                advance();
-                            }
-                        } while (match(","));
-                    }
+        // Skip newlines between elif/else blocks
+        while (!isAtEnd() && (currentToken().type == TokenType::NEWLINE ||
+                              currentToken().type == TokenType::WHITESPACE)) {
+            advance();
+        }
 
-                    if (!match(")")) {
-                        addSyntaxError("Expected ')' after arguments",
-                                       currentToken().line, currentToken().column);
-                        delete node;
-                        return nullptr;
-                    }
-                } else {
-                    std::cout << "  No parentheses, parsing single argument" << std::endl;
-                    // No parentheses - parse a single argument
-                    // Skip any whitespace before the argument
-                    while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
-                        advance();
-                    }
+        // If we hit an error without a block to skip, try to recover by
+        // skipping to next elif/else or end of block
+        if (!validElif && !(body && body->name == "Block")) {
+            while (!isAtEnd() &&
+                   currentToken().type != TokenType::DEDENT &&
+                   currentToken().lexeme != "elif" &&
+                   currentToken().lexeme != "else") {
+                advance();
+            }
+        }
+        return parseIfChain(node, false, result);
+    }
 
-                    if (currentToken().type == TokenType::NEWLINE ||
-                        currentToken().type == TokenType::ENDOFFILE) {
-                        addSyntaxError("Expected an argument after print",
-                                       currentToken().line, currentToken().column);
-                        delete node;
-                        return nullptr;
-                    }
+    case StmtFrame::ElseBody:
+        if (!body || !node) {
+            deleteTree(frame.clause);
+            deleteTree(body);
+        } else {
+            frame.clause->children.push_back(body);
+            node->children.push_back(frame.clause);
+        }
+        result = node;
+        return StmtStep::Done;
 
-                    auto arg = parseExpression();
-                    if (arg) {
-                        node->children.push_back(arg);
-                    } else {
-                        delete node;
-                        return nullptr;
-                    }
+    case StmtFrame::ForBody:
+        if (!body) {
+            deleteTree(node);
+            result = nullptr;
+        } else {
+            node->children.push_back(body);
+            result = node;
+        }
+        return StmtStep::Done;
+
+    case StmtFrame::WhileBody:
+        if (body) {
+            node->children.push_back(body);
+        }
+        result = node;
+        return StmtStep::Done;
+
+    case StmtFrame::DefBody:
+        if (!body) {
+            deleteTree(node);
+            result = nullptr;
+        } else {
+            node->children.push_back(body);
+            result = node;
+        }
+        return StmtStep::Done;
+
+    case StmtFrame::Block:
+        if (body) {
+            node->children.push_back(body);
+        } else if (pos == frame.start && !isAtEnd()) {
+            advance();  // no statement starts here; skip the token
+        }
+
+        while (true) {
+            // Blank lines between statements
+            while (!isAtEnd() && (currentToken().type == TokenType::NEWLINE ||
+                                  currentToken().type == TokenType::COMMENT ||
+                                  currentToken().type == TokenType::WHITESPACE)) {
+                advance();
+            }
+            // A block still open at the end of input ends there
+            if (isAtEnd() || (cancellation && cancellation->isCancelled())) {
+                result = node;
+                return StmtStep::Done;
+            }
+            // An over-indented line is read as part of this block; its
+            // DEDENT must not end the block
+            if (currentToken().type == TokenType::INDENT) {
+                frame.strayIndents++;
+                advance();
+                continue;
+            }
+            if (currentToken().type == TokenType::DEDENT) {
+                advance();
+                if (frame.strayIndents == 0) {
+                    result = node;
+                    return StmtStep::Done;
                 }
-                return node;
+                frame.strayIndents--;
+                continue;
             }
+            break;
+        }
 
-            // For other built-in functions, require parentheses
-            if (!match("(")) {
-                addSyntaxError("Expected '(' after '" + funcName + "'",
-                               currentToken().line, currentToken().column);
-                return nullptr;
-            }
+        frame.start = pos;
+        stmtStack.push_back(frame);
+        return parseStmtHead(result);
+    }
+
+    result = nullptr;
+    return StmtStep::Done;
+}
 
+// Builtin call statement: print with or without parentheses, len(...) or
+// input(...)
+ParseNode* SyntaxAnalyzer::parseBuiltinCall() {
+    std::string funcName = currentToken().lexeme;
+    if (trace) std::cout << "  Found identifier: " << funcName << std::endl;
+
+    auto node = new ParseNode("FuncCall", QString::fromStdString(funcName));
+    advance(); // consume function name
+
+    // For print statements, parentheses are optional
+    if (funcName == "print") {
+        if (trace) std::cout << "  Handling print statement" << std::endl;
+
+        // Skip any whitespace after print
+        while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
+            advance();
+        }
+
+        // If there are parentheses, parse them
+        if (match("(")) {
+            if (trace) std::cout << "  Found opening parenthesis" << std::endl;
             // Parse arguments
             if (!isAtEnd() && currentToken().lexeme != ")") {
                 do {
@@ -299,63 +751,108 @@ ParseNode* SyntaxAnalyzer::parseStmt() {
                 delete node;
                 return nullptr;
             }
+        } else {
+            if (trace) std::cout << "  No parentheses, parsing single argument" << std::endl;
+            // No parentheses - parse a single argument
+            // Skip any whitespace before the argument
+            while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
+                advance();
+            }
 
-            return node;
-        }
+            if (currentToken().type == TokenType::NEWLINE ||
+                currentToken().type == TokenType::ENDOFFILE) {
+                addSyntaxError("Expected an argument after print",
+                               currentToken().line, currentToken().column);
+                delete node;
+                return nullptr;
+            }
 
-        // 5) Assignment: x = ..., x += ..., etc.
-        if (pos + 1 < tokens.size() &&
-            (tokens[pos + 1].lexeme == "=" ||
-             tokens[pos + 1].lexeme == "+=" ||
-             tokens[pos + 1].lexeme == "-=" ||
-             tokens[pos + 1].lexeme == "*=" ||
-             tokens[pos + 1].lexeme == "/=")) {
-            return parseAssignment();
+            auto arg = parseExpression();
+            if (arg) {
+                node->children.push_back(arg);
+            } else {
+                delete node;
+                return nullptr;
+            }
         }
+        return node;
+    }
 
-        // 6) Function call or identifier expression
-        auto exprStmt = parseExprStmt();
-        if (!exprStmt) {
-            addSyntaxError("Invalid expression or unknown statement",
-                           currentToken().line, currentToken().column);
-            return nullptr;
-        }
-        return exprStmt;
+    // For other built-in functions, require parentheses
+    if (!match("(")) {
+        addSyntaxError("Expected '(' after '" + funcName + "'",
+                       currentToken().line, currentToken().column);
+        return nullptr;
     }
 
-    // 7) Fallback: expression statement
-    auto exprStmt = parseExprStmt();
-    if (!exprStmt) {
-        addSyntaxError("Invalid expression or unknown statement",
+    // Parse arguments
+    if (!isAtEnd() && currentToken().lexeme != ")") {
+        do {
+            // Skip any whitespace before argument
+            while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
+                advance();
+            }
+
+            auto arg = parseExpression();
+            if (!arg) {
+                delete node;
+                return nullptr;
+            }
+            node->children.push_back(arg);
+
+            // Skip any whitespace after argument
+            while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
+                advance();
+            }
+        } while (match(","));
+    }
+
+    if (!match(")")) {
+        addSyntaxError("Expected ')' after arguments",
                        currentToken().line, currentToken().column);
+        delete node;
         return nullptr;
     }
 
-    return exprStmt;
+    return node;
 }
 
 
 //——— If statement ———
 
+// Parses an 'if' statement up to its body; the elif/else chain is handled
+// by parseIfChain() once the body is complete.
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::parseIfStmt(ParseNode*& result) {
+    ParseNode* node = parseIfCore();
+    if (node) {
+        stmtStack.push_back({ StmtFrame::IfBody, node });
+        return StmtStep::NeedBody;
+    }
+    return parseIfChain(nullptr, true, result);
+}
+
 // Given an initial IfStmt *node*, attaches any number of
 //   'elif' Comparison ':' Stmt
 // followed optionally by one
 //   'else' ':' Stmt
-// clauses, and then returns the extended node.
-ParseNode* SyntaxAnalyzer::parseIfChain(ParseNode* node) {
-    // Skip any newlines before elif/else
-    while (!isAtEnd() && currentToken().type == TokenType::NEWLINE) {
-        advance();
-    }
-
-    // Handle whitespace/indentation
-    while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                          currentToken().type == TokenType::DEDENT)) {
-        advance();
+// clauses. Each call handles one clause header and pushes a frame for its
+// body; once no clause follows, the extended node is returned in `result`.
+// `skipLeading` is false when continuing after an elif body, which has
+// already skipped the blank lines that follow it. A body's Block ends at
+// its own DEDENT; any further DEDENT closes an enclosing block, so it is
+// left for that block and ends the chain.
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::parseIfChain(ParseNode* node, bool skipLeading, ParseNode*& result) {
+    if (skipLeading) {
+        // Skip any newlines before elif/else
+        while (!isAtEnd() && (currentToken().type == TokenType::NEWLINE ||
+                              currentToken().type == TokenType::WHITESPACE)) {
+            advance();
+        }
     }
 
     // handle zero or more "elif"
-    while (match("elif")) {
+    if (grammar::selectAction(grammar::NonTerminal::IfTail, lookahead()) == grammar::Action::Elif) {
+        advance();
         auto elifNode = new ParseNode("Elif");
         bool validElif = true;
 
@@ -364,7 +861,6 @@ ParseNode* SyntaxAnalyzer::parseIfChain(ParseNode* node) {
         if (!cond) {
             addSyntaxError("Invalid expression in elif condition",
                            currentToken().line, currentToken().column);
-            delete elifNode;
             validElif = false;
         }
 
@@ -376,85 +872,41 @@ ParseNode* SyntaxAnalyzer::parseIfChain(ParseNode* node) {
                 addSyntaxError("Expected ':' after elif condition",
                                currentToken().line, currentToken().column);
             }
-            if (cond) delete cond;
-            delete elifNode;
             validElif = false;
         }
 
         // Check indentation for elif block
         if (!checkIndentation("elif")) {
-            if (cond) delete cond;
-            delete elifNode;
             validElif = false;
         }
 
-        auto body = parseStmt();
-        if (!body) {
-            if (cond) delete cond;
-            delete elifNode;
-            validElif = false;
-        }
-
-        // Only add valid elif nodes to the chain
-        if (validElif) {
-            elifNode->children.push_back(cond);
-            elifNode->children.push_back(body);
-            node->children.push_back(elifNode);
-        }
-
-        // Skip newlines between elif/else blocks
-        while (!isAtEnd() && currentToken().type == TokenType::NEWLINE) {
-            advance();
-        }
-
-        // Handle whitespace/indentation before next elif/else
-        while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                              currentToken().type == TokenType::DEDENT)) {
-            advance();
-        }
-
-        // If we hit an error, try to recover by skipping to next elif/else or end of block
-        if (!validElif) {
-            while (!isAtEnd() &&
-                   currentToken().type != TokenType::DEDENT &&
-                   currentToken().lexeme != "elif" &&
-                   currentToken().lexeme != "else") {
-                advance();
-            }
-        }
-    }
-
-    // Handle whitespace/indentation before else
-    while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                          currentToken().type == TokenType::DEDENT)) {
-        advance();
+        // The body is parsed even for an invalid clause so that it is skipped
+        stmtStack.push_back({ StmtFrame::ElifBody, node, elifNode, cond, validElif });
+        return StmtStep::NeedBody;
     }
 
     // optional "else"
-    if (match("else")) {
+    if (grammar::selectAction(grammar::NonTerminal::IfTail, lookahead()) == grammar::Action::Else) {
+        advance();
         if (!match(":")) {
             addSyntaxError("Expected ':' after else",
                            currentToken().line, currentToken().column);
-            return node;
+            result = node;
+            return StmtStep::Done;
         }
 
         // Check indentation for else block
         if (!checkIndentation("else")) {
-            return node;
-        }
-
-        auto elseNode = new ParseNode("Else");
-        auto body = parseStmt();
-        if (!body) {
-            delete elseNode;
-            return node;
+            result = node;
+            return StmtStep::Done;
         }
 
-        elseNode->children.push_back(body);
-        node->children.push_back(elseNode);
+        stmtStack.push_back({ StmtFrame::ElseBody, node, new ParseNode("Else") });
+        return StmtStep::NeedBody;
     }
 
-    return node;
+    result = node;
+    return StmtStep::Done;
 }
 
 // Add this helper method near the top of the file
@@ -480,7 +932,8 @@ bool SyntaxAnalyzer::checkIndentation(const std::string& stmtType) {
     return true;
 }
 
-// Update the parseIfCore method
+// Parses the condition, colon and INDENT of an if statement; the caller
+// parses the body
 ParseNode* SyntaxAnalyzer::parseIfCore() {
     auto node = new ParseNode("IfStmt");
 
@@ -489,7 +942,7 @@ ParseNode* SyntaxAnalyzer::parseIfCore() {
     if (!cond) {
         addSyntaxError("Invalid expression in if condition",
                        currentToken().line, currentToken().column);
-        delete node;
+        deleteTree(node);
         return nullptr;
     }
     node->children.push_back(cond);
@@ -503,30 +956,22 @@ ParseNode* SyntaxAnalyzer::parseIfCore() {
             addSyntaxError("Expected ':' after if condition",
                            currentToken().line, currentToken().column);
         }
-        delete node;
+        deleteTree(node);
         return nullptr;
     }
 
     // 3) Check indentation
     if (!checkIndentation("if")) {
-        delete node;
-        return nullptr;
-    }
-
-    // 4) Parse the body
-    auto body = parseStmt();
-    if (!body) {
-        delete node;
+        deleteTree(node);
         return nullptr;
     }
-    node->children.push_back(body);
 
     return node;
 }
 
 //——— For statement ———
 
-ParseNode* SyntaxAnalyzer::parseForStmt() {
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::parseForStmt(ParseNode*& result) {
     auto node = new ParseNode("ForStmt");
 
     // 1) Parse target list
@@ -539,7 +984,9 @@ ParseNode* SyntaxAnalyzer::parseForStmt() {
                    currentToken().type != TokenType::NEWLINE)
                 advance();
             if (match(":")) {}
-            return nullptr;
+            deleteTree(targets);
+            deleteTree(node);
+            return StmtStep::Done;
         }
         targets->children.push_back(
             new ParseNode("Identifier",
@@ -556,12 +1003,16 @@ ParseNode* SyntaxAnalyzer::parseForStmt() {
                currentToken().type != TokenType::NEWLINE)
             advance();
         if (match(":")) {}
-        return nullptr;
+        deleteTree(node);
+        return StmtStep::Done;
     }
 
     // 3) Parse iterable
     auto iterable = parseComparison();
-    if (!iterable) return nullptr;
+    if (!iterable) {
+        deleteTree(node);
+        return StmtStep::Done;
+    }
     node->children.push_back(iterable);
 
     // 4) Expect colon
@@ -571,26 +1022,25 @@ ParseNode* SyntaxAnalyzer::parseForStmt() {
         while (!isAtEnd() && currentToken().type != TokenType::NEWLINE) {
             advance();
         }
-        return nullptr;
+        deleteTree(node);
+        return StmtStep::Done;
     }
 
     // 5) Check indentation
     if (!checkIndentation("for")) {
-        return node;
+        result = node;
+        return StmtStep::Done;
     }
 
-    // 6) Parse the body
-    auto body = parseStmt();
-    if (!body) return nullptr;
-    node->children.push_back(body);
-
-    return node;
+    // 6) The body is parsed next and attached in resumeStmt()
+    stmtStack.push_back({ StmtFrame::ForBody, node });
+    return StmtStep::NeedBody;
 }
 
 
 //——— While statement ———
 
-ParseNode* SyntaxAnalyzer::parseWhileStmt() {
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::parseWhileStmt(ParseNode*& result) {
     auto node = new ParseNode("WhileStmt");
 
     // 1) Optional parentheses
@@ -631,33 +1081,32 @@ ParseNode* SyntaxAnalyzer::parseWhileStmt() {
         while (!isAtEnd() && currentToken().type != TokenType::NEWLINE) {
             advance();
         }
-        return node;
+        result = node;
+        return StmtStep::Done;
     }
 
     // 6) Check indentation
     if (!checkIndentation("while")) {
-        return node;
+        result = node;
+        return StmtStep::Done;
     }
 
-    // 7) Parse the body
-    auto body = parseStmt();
-    if (body) {
-        node->children.push_back(body);
-    }
-
-    return node;
+    // 7) The body is parsed next and attached in resumeStmt()
+    stmtStack.push_back({ StmtFrame::WhileBody, node });
+    return StmtStep::NeedBody;
 }
 
 //——— Def statement ———
 
-ParseNode* SyntaxAnalyzer::parseFuncDef() {
+SyntaxAnalyzer::StmtStep SyntaxAnalyzer::parseFuncDef() {
     auto node = new ParseNode("FuncDef");
 
     // 1) Parse function name
     if (currentToken().type != TokenType::IDENTIFIER) {
         addSyntaxError("Expected function name after def",
                        currentToken().line, currentToken().column);
-        return nullptr;
+        deleteTree(node);
+        return StmtStep::Done;
     }
     node->children.push_back(
         new ParseNode("Identifier",
@@ -668,8 +1117,8 @@ ParseNode* SyntaxAnalyzer::parseFuncDef() {
     if (!match("(")) {
         addSyntaxError("Expected '(' after function name",
                        currentToken().line, currentToken().column);
-        delete node;
-        return nullptr;
+        deleteTree(node);
+        return StmtStep::Done;
     }
 
     if (currentToken().type == TokenType::IDENTIFIER) {
@@ -688,32 +1137,27 @@ ParseNode* SyntaxAnalyzer::parseFuncDef() {
             addSyntaxError("Expected ')' after parameters",
                            currentToken().line, currentToken().column);
         }
-        delete node;
-        return nullptr;
+        deleteTree(node);
+        return StmtStep::Done;
     }
 
     // 3) Expect colon
     if (!match(":")) {
         addSyntaxError("Expected ':' after def header",
                        currentToken().line, currentToken().column);
-        delete node;
-        return nullptr;
+        deleteTree(node);
+        return StmtStep::Done;
     }
 
     // 4) Check for proper indentation
     if (!checkIndentation("def")) {
-        delete node;
-        return nullptr;
+        deleteTree(node);
+        return StmtStep::Done;
     }
 
-    // 5) Parse the function body
-    auto body = parseStmt();
-    if (!body) {
-        delete node;
-        return nullptr;
-    }
-    node->children.push_back(body);
-    return node;
+    // 5) The function body is parsed next and attached in resumeStmt()
+    stmtStack.push_back({ StmtFrame::DefBody, node });
+    return StmtStep::NeedBody;
 }
 
 //——— Param list ———
@@ -810,110 +1254,199 @@ ParseNode* SyntaxAnalyzer::parseExprStmt() {
     return node;
 }
 
-//——— Expression (E ::= T { (+|-) T }) ———
+//——— Expressions ———
+//   E ::= T { (+|-) T }
+//   T ::= P { (*|/|%) P }
+//   P ::= F [ '**' P ]                 (right-associative)
+//   F ::= '(' E ')' | identifier [ '(' [ E { ',' E } ] ')' ] | literal
+//
+// Evaluated with an explicit stack of ExprFrames instead of recursion, so
+// deeply nested parentheses and calls cannot overflow the native stack.
 
-ParseNode* SyntaxAnalyzer::parseExpression() {
-    // Skip any leading whitespace or comments
+void SyntaxAnalyzer::skipWhitespaceAndComments() {
     while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
                          currentToken().type == TokenType::COMMENT)) {
         advance();
     }
+}
 
-    // Block endings are not expressions
-    if (currentToken().type == TokenType::DEDENT ||
-        currentToken().type == TokenType::NEWLINE ||
-        currentToken().type == TokenType::ENDOFFILE) {
-        return nullptr;
-    }
+ParseNode* SyntaxAnalyzer::parseExpression() {
+    enum class Step { Expression, Term, Power, Factor, Return };
 
-    auto left = parseTerm();
-    if (!left) return nullptr;
+    const size_t base = exprStack.size();
+    Step step = Step::Expression;
+    ParseNode* result = nullptr;
 
-    while (!isAtEnd()) {
-        // Skip whitespace and comments between terms
-        while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                             currentToken().type == TokenType::COMMENT)) {
-            advance();
-        }
+    while (true) {
+        switch (step) {
+        case Step::Expression:
+            // Skip any leading whitespace or comments
+            skipWhitespaceAndComments();
+
+            // Block endings are not expressions
+            if (currentToken().type == TokenType::DEDENT ||
+                currentToken().type == TokenType::NEWLINE ||
+                currentToken().type == TokenType::ENDOFFILE) {
+                result = nullptr;
+                step = Step::Return;
+                break;
+            }
+            exprStack.push_back({ ExprFrame::Expression, nullptr, QString() });
+            step = Step::Term;
+            break;
 
-        // Stop at block endings
-        if (currentToken().type == TokenType::DEDENT ||
-            currentToken().type == TokenType::NEWLINE ||
-            currentToken().type == TokenType::ENDOFFILE ||
-            currentToken().lexeme == ":") {
+        case Step::Term:
+            // Skip any leading whitespace or comments
+            skipWhitespaceAndComments();
+            exprStack.push_back({ ExprFrame::Term, nullptr, QString() });
+            step = Step::Power;
             break;
-        }
 
-        std::string op;
-        if (match("+")) op = "+";
-        else if (match("-")) op = "-";
-        else break;
+        case Step::Power:
+            exprStack.push_back({ ExprFrame::Power, nullptr, QString() });
+            step = Step::Factor;
+            break;
 
-        // Skip whitespace and comments after operator
-        while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                             currentToken().type == TokenType::COMMENT)) {
-            advance();
-        }
+        case Step::Factor:
+            // Either produces a complete operand or opens a '(' / call frame
+            step = parseFactor(result) ? Step::Expression : Step::Return;
+            break;
 
-        auto right = parseTerm();
-        if (!right) return nullptr;
+        case Step::Return: {
+            if (exprStack.size() == base) {
+                return result;
+            }
 
-        auto opNode = new ParseNode("Operator", QString::fromStdString(op));
-        opNode->children.push_back(left);
-        opNode->children.push_back(right);
-        left = opNode;
-    }
+            ExprFrame& frame = exprStack.back();
 
-    return left;
-}
+            // A failed operand fails every enclosing level
+            if (!result && frame.kind != ExprFrame::Paren) {
+                deleteTree(frame.node);
+                exprStack.pop_back();
+                break;
+            }
 
-//——— Term (T ::= F { (*|/) F }) ———
+            switch (frame.kind) {
+            case ExprFrame::Expression:
+            case ExprFrame::Term: {
+                if (frame.node) {
+                    auto opNode = new ParseNode("Operator", frame.op);
+                    opNode->children.push_back(frame.node);
+                    opNode->children.push_back(result);
+                    result = opNode;
+                }
+                frame.node = result;
+                result = nullptr;
+
+                // Look for the next operator of this level
+                std::string op;
+                if (frame.kind == ExprFrame::Expression) {
+                    if (!isAtEnd()) {
+                        // Skip whitespace and comments between terms
+                        skipWhitespaceAndComments();
+
+                        // Stop at block endings
+                        if (currentToken().type != TokenType::DEDENT &&
+                            currentToken().type != TokenType::NEWLINE &&
+                            currentToken().type != TokenType::ENDOFFILE &&
+                            currentToken().lexeme != ":") {
+                            if (match("+")) op = "+";
+                            else if (match("-")) op = "-";
+                        }
+                    }
+                } else {
+                    // Skip any whitespace or comments before operator
+                    skipWhitespaceAndComments();
 
-ParseNode* SyntaxAnalyzer::parseTerm() {
-    // Skip any leading whitespace or comments
-    while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                         currentToken().type == TokenType::COMMENT)) {
-        advance();
-    }
+                    if (match("*")) op = "*";
+                    else if (match("/")) op = "/";
+                    else if (match("%")) op = "%";
+                }
 
-    auto left = parseFactor();
-    if (!left) return nullptr;
+                if (op.empty()) {
+                    result = frame.node;
+                    exprStack.pop_back();
+                    break;
+                }
 
-    while (true) {
-        // Skip any whitespace or comments before operator
-        while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                             currentToken().type == TokenType::COMMENT)) {
-            advance();
-        }
+                // Skip whitespace and comments after operator
+                skipWhitespaceAndComments();
+                frame.op = QString::fromStdString(op);
+                step = frame.kind == ExprFrame::Expression ? Step::Term : Step::Power;
+                break;
+            }
 
-        std::string op;
-        if (match("*")) op = "*";
-        else if (match("/")) op = "/";
-        else if (match("%")) op = "%";
-        else break;
+            case ExprFrame::Power: {
+                // Right operand of '**' is back: combine and finish this level
+                if (frame.node) {
+                    auto opNode = new ParseNode("Operator", "**");
+                    opNode->children.push_back(frame.node);
+                    opNode->children.push_back(result);
+                    result = opNode;
+                    exprStack.pop_back();
+                    break;
+                }
 
-        // Skip any whitespace or comments after operator
-        while (!isAtEnd() && (currentToken().type == TokenType::WHITESPACE ||
-                             currentToken().type == TokenType::COMMENT)) {
-            advance();
-        }
+                skipWhitespaceAndComments();
+                if (!match("**")) {
+                    exprStack.pop_back();
+                    break;
+                }
 
-        auto right = parseFactor();
-        if (!right) return nullptr;
+                // The exponent is itself a power, which makes '**' bind right to left
+                skipWhitespaceAndComments();
+                frame.node = result;
+                result = nullptr;
+                step = Step::Power;
+                break;
+            }
 
-        auto opNode = new ParseNode("Operator", QString::fromStdString(op));
-        opNode->children.push_back(left);
-        opNode->children.push_back(right);
-        left = opNode;
+            case ExprFrame::Paren:
+                exprStack.pop_back();
+                if (!match(")")) {
+                    addSyntaxError("Expected ')' after expression",
+                                   currentToken().line, currentToken().column);
+                    deleteTree(result);
+                    result = nullptr;
+                }
+                break;
+
+            case ExprFrame::Call: {
+                // Parse zero or more comma-separated arguments
+                frame.node->children.push_back(result);
+                result = nullptr;
+                if (match(",")) {
+                    step = Step::Expression;
+                    break;
+                }
+
+                ParseNode* callNode = frame.node;
+                exprStack.pop_back();
+                if (!match(")")) {
+                    addSyntaxError("Expected ')' after function call arguments",
+                                   currentToken().line, currentToken().column);
+                    deleteTree(callNode);
+                    break;
+                }
+                result = callNode;
+                break;
+            }
+            }
+            break;
+        }
+        }
     }
-    return left;
 }
 
-
 //——— Factor (F ::= '(' E ')' | number | identifier ) ———
 
-ParseNode* SyntaxAnalyzer::parseFactor() {
-    std::cout << "parseFactor: current token type=" << tokenTypeToString(currentToken().type)
+// Parses one factor into `result`. Returns true when the factor opens a
+// parenthesized expression or a call's argument list; the matching frame has
+// then been pushed and the caller continues with the inner expression.
+bool SyntaxAnalyzer::parseFactor(ParseNode*& result) {
+    result = nullptr;
+
+    if (trace) std::cout << "parseFactor: current token type=" << tokenTypeToString(currentToken().type)
     << ", lexeme='" << currentToken().lexeme
     << "', line=" << currentToken().line
     << ", col=" << currentToken().column << std::endl;
@@ -921,85 +1454,74 @@ ParseNode* SyntaxAnalyzer::parseFactor() {
     // Skip any leading whitespace
     while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
         advance();
-        std::cout << "  Skipped whitespace" << std::endl;
+        if (trace) std::cout << "  Skipped whitespace" << std::endl;
     }
 
     // Parenthesized expression
     if (match("(")) {
-        std::cout << "  Parsing parenthesized expression" << std::endl;
-        auto expr = parseExpression();
-        if (!match(")")) {
-            addSyntaxError("Expected ')' after expression",
-                           currentToken().line, currentToken().column);
-            delete expr;
-            return nullptr;
-        }
-        return expr;
+        if (trace) std::cout << "  Parsing parenthesized expression" << std::endl;
+        exprStack.push_back({ ExprFrame::Paren, nullptr, QString() });
+        return true;
     }
 
     const Token& tok = currentToken();
-    std::cout << "  Checking token: type=" << tokenTypeToString(tok.type)
+    if (trace) std::cout << "  Checking token: type=" << tokenTypeToString(tok.type)
               << ", lexeme='" << tok.lexeme << "'" << std::endl;
 
     // String literals
     if (tok.type == TokenType::STRING) {
-        std::cout << "  Found string literal" << std::endl;
-        auto leaf = new ParseNode("String", QString::fromStdString(tok.lexeme));
+        if (trace) std::cout << "  Found string literal" << std::endl;
+        result = new ParseNode("String", QString::fromStdString(tok.lexeme));
         advance();
-        return leaf;
+        return false;
     }
 
     // Boolean literals
     if (tok.type == TokenType::KEYWORD &&
         (tok.lexeme == "True" || tok.lexeme == "False"))
     {
-        std::cout << "  Found boolean literal" << std::endl;
-        auto leaf = new ParseNode("Bool", QString::fromStdString(tok.lexeme));
+        if (trace) std::cout << "  Found boolean literal" << std::endl;
+        result = new ParseNode("Bool", QString::fromStdString(tok.lexeme));
         advance();
-        return leaf;
+        return false;
     }
 
     // Identifier or function call
     if (tok.type == TokenType::IDENTIFIER) {
-        std::cout << "  Found identifier: " << tok.lexeme << std::endl;
+        if (trace) std::cout << "  Found identifier: " << tok.lexeme << std::endl;
         std::string name = tok.lexeme;
         advance();
 
         // Skip whitespace after identifier
         while (!isAtEnd() && currentToken().type == TokenType::WHITESPACE) {
             advance();
-            std::cout << "  Skipped whitespace after identifier" << std::endl;
+            if (trace) std::cout << "  Skipped whitespace after identifier" << std::endl;
         }
 
         // Function call: IDENTIFIER '(' [args] ')'
         if (match("(")) {
-            std::cout << "  Found function call" << std::endl;
+            if (trace) std::cout << "  Found function call" << std::endl;
             auto callNode = new ParseNode("FuncCall", QString::fromStdString(name));
 
-            // Parse zero or more comma‑separated arguments
             if (!isAtEnd() && currentToken().lexeme != ")") {
-                do {
-                    auto arg = parseExpression();
-                    if (!arg) {
-                        delete callNode;
-                        return nullptr;
-                    }
-                    callNode->children.push_back(arg);
-                } while (match(","));
+                exprStack.push_back({ ExprFrame::Call, callNode, QString() });
+                return true;
             }
 
             if (!match(")")) {
                 addSyntaxError("Expected ')' after function call arguments",
                                currentToken().line, currentToken().column);
-                delete callNode;
-                return nullptr;
+                deleteTree(callNode);
+                return false;
             }
-            return callNode;
+            result = callNode;
+            return false;
         }
 
         // Plain identifier
-        std::cout << "  Creating identifier node for: " << name << std::endl;
-        return new ParseNode("Identifier", QString::fromStdString(name));
+        if (trace) std::cout << "  Creating identifier node for: " << name << std::endl;
+        result = new ParseNode("Identifier", QString::fromStdString(name));
+        return false;
     }
 
     // Number literals
@@ -1008,7 +1530,7 @@ ParseNode* SyntaxAnalyzer::parseFactor() {
         tok.type == TokenType::BinaryNumber ||
         tok.type == TokenType::OCTALNUMBER)
     {
-        std::cout << "  Found number literal" << std::endl;
+        if (trace) std::cout << "  Found number literal" << std::endl;
         QString nodeName;
         switch (tok.type) {
         case TokenType::NUMBER:            nodeName = "Number"; break;
@@ -1018,38 +1540,155 @@ ParseNode* SyntaxAnalyzer::parseFactor() {
         default:                           nodeName = "Number"; break;
         }
 
-        auto leaf = new ParseNode(nodeName, QString::fromStdString(tok.lexeme));
+        result = new ParseNode(nodeName, QString::fromStdString(tok.lexeme));
         advance();
-        return leaf;
+        return false;
     }
 
     // If we get here, we couldn't parse a factor
     if (currentToken().type == TokenType::NEWLINE ||
         currentToken().type == TokenType::ENDOFFILE) {
-        std::cout << "  Hit end of line or file" << std::endl;
-        return nullptr;
+        if (trace) std::cout << "  Hit end of line or file" << std::endl;
+        return false;
     }
 
-    std::cout << "  Failed to parse factor" << std::endl;
+    if (trace) std::cout << "  Failed to parse factor" << std::endl;
     addSyntaxError("Expected an identifier, number, or expression",
                    currentToken().line, currentToken().column);
-    return nullptr;
+    return false;
+}
+
+const Token& SyntaxAnalyzer::currentToken() const {
+    return tokens[pos];
 }
 
-void SyntaxAnalyzer::buildTree(QTreeWidgetItem* parent, ParseNode* node) {
-    for (auto child : node->children) {
-        QTreeWidgetItem* item = new QTreeWidgetItem(parent);
-        item->setText(0, child->name + (child->value.isEmpty() ? "" : ": " + child->value));
-        buildTree(item, child);
+namespace {
+
+using grammar::Terminal;
+
+// The lexer marks keywords ignoring case; only the exact spelling starts a
+// production. Branching on the length first keeps this to one or two
+// comparisons per keyword.
+Terminal keywordTerminal(const std::string& word) {
+    switch (word.size()) {
+    case 2:
+        if (word == "if") return Terminal::If;
+        if (word == "in") return Terminal::In;
+        if (word == "or" || word == "is") return Terminal::Operator;
+        break;
+    case 3:
+        if (word == "def") return Terminal::Def;
+        if (word == "for") return Terminal::For;
+        if (word == "and" || word == "not") return Terminal::Operator;
+        break;
+    case 4:
+        if (word == "elif") return Terminal::Elif;
+        if (word == "else") return Terminal::Else;
+        if (word == "pass") return Terminal::Pass;
+        if (word == "True" || word == "None") return Terminal::Literal;
+        break;
+    case 5:
+        if (word == "while") return Terminal::While;
+        if (word == "break") return Terminal::Break;
+        if (word == "False") return Terminal::Literal;
+        break;
+    case 6:
+        if (word == "return") return Terminal::Return;
+        break;
+    case 8:
+        if (word == "continue") return Terminal::Continue;
+        break;
     }
+    return Terminal::Other;
 }
 
-const Token& SyntaxAnalyzer::currentToken() const {
-    return tokens[pos];
+bool isAssignOp(TokenType type) {
+    return type == TokenType::EQUALOPERATOR || type == TokenType::ADD_ASSIGN ||
+           type == TokenType::SUB_ASSIGN || type == TokenType::MULTIPLYASSIGN;
+}
+
+} // namespace
+
+// Identifiers are split by one token of context: builtin names and
+// assignment targets are separate terminals so the grammar stays LL(1)
+grammar::Terminal SyntaxAnalyzer::lookahead() const {
+    if (pos >= tokens.size()) return grammar::Terminal::EndOfFile;
+    const Token& tok = tokens[pos];
+
+    switch (tok.type) {
+    case TokenType::KEYWORD:
+        return keywordTerminal(tok.lexeme);
+    case TokenType::IDENTIFIER:
+        if (tok.lexeme == "print" || tok.lexeme == "len" || tok.lexeme == "input") {
+            return grammar::Terminal::Builtin;
+        }
+        if (pos + 1 < tokens.size() && isAssignOp(tokens[pos + 1].type)) {
+            return grammar::Terminal::AssignTarget;
+        }
+        return grammar::Terminal::Name;
+    case TokenType::EQUALOPERATOR:
+    case TokenType::ADD_ASSIGN:
+    case TokenType::SUB_ASSIGN:
+    case TokenType::MULTIPLYASSIGN:
+        return grammar::Terminal::AssignOp;
+    case TokenType::DELIMITER:
+        switch (tok.lexeme.empty() ? '\0' : tok.lexeme[0]) {
+        case ':': return grammar::Terminal::Colon;
+        case ',': return grammar::Terminal::Comma;
+        case '(': return grammar::Terminal::LParen;
+        case ')': return grammar::Terminal::RParen;
+        default:  return grammar::Terminal::Other;
+        }
+    case TokenType::NUMBER:
+    case TokenType::HexadecimalNumber:
+    case TokenType::BinaryNumber:
+    case TokenType::OCTALNUMBER:
+    case TokenType::COMPLEX_NUMBER:
+    case TokenType::STRING:
+        return grammar::Terminal::Literal;
+    case TokenType::OPERATOR:
+    case TokenType::ADDOPERATOR:
+    case TokenType::MINUSOPERATOR:
+    case TokenType::MULTIPLYOPERATOR:
+    case TokenType::DIVIDEOPERATOR:
+    case TokenType::PERCENTAGEOPERATOR:
+    case TokenType::POWEROPERATOR:
+    case TokenType::COMPAREOPERATOR:
+    case TokenType::BITANDOPERATOR:
+    case TokenType::BITOROPERATOR:
+        return grammar::Terminal::Operator;
+    case TokenType::NEWLINE:
+        return grammar::Terminal::Newline;
+    case TokenType::INDENT:
+        return grammar::Terminal::Indent;
+    case TokenType::DEDENT:
+        return grammar::Terminal::Dedent;
+    case TokenType::ENDOFFILE:
+        return grammar::Terminal::EndOfFile;
+    default:
+        return grammar::Terminal::Other;
+    }
 }
 
 void SyntaxAnalyzer::advance() {
     if (!isAtEnd()) pos++;
+    // Keep the current token and the one after it (see lookahead()) received
+    if (tokenRing) fillTo(pos + 1);
+}
+
+void SyntaxAnalyzer::fillTo(size_t index) {
+    TokenBatch batch;
+    while (tokenRing && streamedTokens.size() <= index) {
+        if (!tokenRing->pop(batch)) {
+            tokenRing = nullptr;
+            break;
+        }
+        for (auto& token : batch) {
+            if (token.type != TokenType::COMMENT) {
+                streamedTokens.push_back(std::move(token));
+            }
+        }
+    }
 }
 
 bool SyntaxAnalyzer::match(const std::string& lexeme) {
@@ -1068,3 +1707,14 @@ void SyntaxAnalyzer::addSyntaxError(const std::string& msg, int line, int column
     syntaxErrors.push_back({ msg, line, column });
 }
 
+void SyntaxAnalyzer::printTokenStream() const {
+    std::cout << "Token stream:" << std::endl;
+    for (size_t i = 0; i < tokens.size(); i++) {
+        std::cout << "Token " << i << ": type=" << tokenTypeToString(tokens[i].type)
+        << ", lexeme='" << tokens[i].lexeme
+        << "', line=" << tokens[i].line
+        << ", col=" << tokens[i].column << std::endl;
+    }
+    std::cout << std::endl;
+}
+
@@ -4,15 +4,29 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <functional>
 #include <QString>
-#include <QTreeWidget>
+#include <QVector>
 #include "pythonlexer.h"
+#include "grammar.h"
+
+// Token span of a block whose statements have not been parsed yet
+struct LazyBlock {
+    const std::vector<Token>* tokens;
+    std::shared_ptr<const std::vector<BlockSpan>> blocks; // of the whole stream
+    size_t begin;           // first token after the INDENT
+    size_t end;             // the matching DEDENT (or ENDOFFILE)
+};
 
 // Parse tree node
 struct ParseNode {
     QString name;            // Node type or token
     QString value;          // Optional token value
     QVector<ParseNode*> children;
+    std::unique_ptr<LazyBlock> lazy; // Set while the node's children are still unparsed
+    int line = 0;              // Source position of statements (0 elsewhere)
+    int column = 0;
     ParseNode(const QString& n, const QString& v = "")
         : name(n), value(v) {}
 };
@@ -27,47 +41,146 @@ struct SyntaxError {
 // LL(1) Syntax Analyzer for Python subset
 class SyntaxAnalyzer {
 public:
+    // Receives each completed top-level statement in streaming mode
+    using StatementVisitor = std::function<void(const ParseNode*)>;
+
     SyntaxAnalyzer(const std::vector<Token>& tokens)
         : tokens(tokens), pos(0) {}
-    ~SyntaxAnalyzer();
+
+    // Pipeline mode: tokens are pulled from `ring` while the lexer is still
+    // producing them; comments are dropped on the way in. Parallel and lazy
+    // parsing need the whole stream up front and are not used in this mode;
+    // the tree has the same shape either way.
+    explicit SyntaxAnalyzer(TokenRing& ring)
+        : tokenRing(&ring), tokens(streamedTokens), pos(0) {}
 
     // Build parse tree; returns root node (or nullptr on top-level failure)
     ParseNode* parseProgram();
 
-    // Populate a QTreeWidget with the parse tree
-    void populateTree(QTreeWidget* tree);
+    // Same as parseProgram(), but splits the token stream at top-level
+    // statement boundaries and parses the segments on a thread pool.
+    // The resulting tree and error list are identical to a sequential parse.
+    // threadCount == 0 uses std::thread::hardware_concurrency().
+    ParseNode* parseProgramParallel(unsigned threadCount = 0);
+
+    // Streaming mode: hands every top-level statement to `visitor` as soon
+    // as it is complete and frees it afterwards, so no Program tree is kept.
+    // Fed from a TokenRing, the tokens of finished statements are dropped
+    // too, and the parser holds about one statement at a time; the lexer
+    // still keeps the source and every token it produced. Returns the
+    // number of statements visited.
+    size_t parseStreaming(const StatementVisitor& visitor);
+
+    // Free a parse tree, including spans of blocks that were never parsed
+    static void deleteTree(ParseNode* node);
+
+    // Lazy mode: block bodies are skipped to their matching DEDENT and
+    // recorded as unparsed "Block" nodes until materialize() is called,
+    // which gives the Block the statements an eager parse would have.
+    // `blocks` is the lexer's block index for these tokens (comments
+    // removed); without it the tokens are scanned for one.
+    void setLazyBlocks(bool enabled, std::shared_ptr<const std::vector<BlockSpan>> blocks = nullptr);
+
+    // Parse the statements of an unparsed block into node->children.
+    // Returns false if the node was not lazy; errors found in the block
+    // are appended to `errors` when given.
+    static bool materialize(ParseNode* node, std::vector<SyntaxError>* errors = nullptr);
+
+    // Parse every unparsed block under `root`, nested ones included, on a
+    // thread pool, so passes that need whole function bodies see the tree an
+    // eager parse would have built. Errors found in the blocks are merged
+    // into `errors` by source position. Stops early once `cancel` is set.
+    static void materializeAll(ParseNode* root, std::vector<SyntaxError>& errors,
+                               const CancellationToken* cancel = nullptr, unsigned threadCount = 0);
+
+    // Stop before the next top-level statement once `token` is cancelled;
+    // the tree returned then holds only the statements parsed so far
+    void setCancellation(const CancellationToken* token) { cancellation = token; }
+
+    // Debug output of the token stream and of each parsing step on stdout
+    // (on by default); it costs more than the parse itself
+    void setTrace(bool enabled) { trace = enabled; }
 
     // Retrieve collected syntax errors
     const std::vector<SyntaxError>& getErrors() const { return syntaxErrors; }
 
 private:
+    TokenRing* tokenRing = nullptr;      // pipeline source, null once drained
+    std::vector<Token> streamedTokens;   // tokens received from tokenRing
     const std::vector<Token>& tokens;
     size_t pos;
     std::vector<SyntaxError> syntaxErrors;
+    bool lazyBlocks = false;
+    const CancellationToken* cancellation = nullptr;
+    bool trace = true;
+    std::shared_ptr<const std::vector<BlockSpan>> blocks;   // lazy mode
+
+    // Explicit work stacks replacing recursion in the statement and
+    // expression parsers; nesting depth is bounded only by memory
+    enum class StmtStep { Done, NeedBody };
+    struct StmtFrame {
+        enum Kind { IfBody, ElifBody, ElseBody, ForBody, WhileBody, DefBody, Block } kind;
+        ParseNode* node;              // statement waiting for its body, or the Block
+        ParseNode* clause = nullptr;  // Elif/Else node the body belongs to
+        ParseNode* cond = nullptr;    // elif condition
+        bool valid = true;            // elif header parsed without errors
+        size_t start = 0;             // Block: where its latest statement began
+        int strayIndents = 0;         // Block: unexpected INDENTs still open
+    };
+    struct ExprFrame {
+        enum Kind { Expression, Term, Power, Paren, Call } kind;
+        ParseNode* node;              // left operand so far, or the FuncCall node
+        QString op;                   // operator waiting for its right operand
+    };
+    std::vector<StmtFrame> stmtStack;
+    std::vector<ExprFrame> exprStack;
 
     // Helper methods
     bool checkIndentation(const std::string& stmtType);
     bool match(const std::string& lexeme);
     bool isAtEnd() const;
     const Token& currentToken() const;
+    grammar::Terminal lookahead() const;  // current token as a grammar terminal
     void advance();
+    void fillTo(size_t index);  // pipeline mode: receive tokens up to `index`
     void addSyntaxError(const std::string& msg, int line, int column);
+    void printTokenStream() const;
+
+    // Top-level statement loop shared by the sequential and parallel drivers;
+    // parses statements until pos reaches `end` (or the end of input)
+    void parseStatementsUntil(size_t end, QVector<ParseNode*>& out);
+
+    // One iteration of the top-level loop; returns the statement parsed, if any
+    ParseNode* parseTopLevelStep();
+
+    // Token indices where a new statement starts at indentation depth zero
+    std::vector<size_t> findTopLevelBoundaries() const;
+
+    // Unparsed "Block" for the body following the INDENT just consumed
+    ParseNode* parseLazyBlock();
+
+    // Parse the statements of a lazy block; nested blocks stay lazy only
+    // if `lazyNested`
+    static void parseBlockBody(ParseNode* node, bool lazyNested, std::vector<SyntaxError>* errors);
 
-    // Build QTree recursively
-    void buildTree(QTreeWidgetItem* parent, ParseNode* node);
+    void skipWhitespaceAndComments();
 
     // Parsing methods for grammar rules
     ParseNode* parseStmt();
-    ParseNode* parseIfChain(ParseNode* node);
+    StmtStep parseStmtHead(ParseNode*& result);
+    StmtStep dispatchStmt(ParseNode*& result);
+    StmtStep resumeStmt(ParseNode*& result);
+    ParseNode* parseBuiltinCall();
+    StmtStep parseIfStmt(ParseNode*& result);
+    StmtStep parseIfChain(ParseNode* node, bool skipLeading, ParseNode*& result);
     ParseNode* parseIfCore();
-    ParseNode* parseForStmt();
-    ParseNode* parseWhileStmt();
-    ParseNode* parseFuncDef();
+    StmtStep parseForStmt(ParseNode*& result);
+    StmtStep parseWhileStmt(ParseNode*& result);
+    StmtStep parseFuncDef();
     ParseNode* parseAssignment();
     ParseNode* parseExprStmt();
     ParseNode* parseExpression();
-    ParseNode* parseTerm();
-    ParseNode* parseFactor();
+    bool parseFactor(ParseNode*& result);
     ParseNode* parseParamList();
     ParseNode* parseComparison();
     ParseNode* parseReturnStmt();
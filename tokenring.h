@@ -0,0 +1,122 @@
+// tokenring.h
+#ifndef TOKENRING_H
+#define TOKENRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Counters of a finished SpscRing; read them once both sides are done
+struct RingStats {
+    size_t capacity = 0;
+    uint64_t pushed = 0;            // items that went through the ring
+    uint64_t producerStalls = 0;    // pushes that found the ring full
+    uint64_t consumerStalls = 0;    // pops that found the ring empty
+    size_t maxOccupancy = 0;        // most items queued at once
+    double meanOccupancy = 0.0;     // items queued, sampled after every push
+};
+
+// Bounded single-producer/single-consumer queue. The two indices are the
+// only shared state, so neither side ever takes a lock; a full ring makes
+// the producer wait (backpressure), an empty one makes the consumer wait.
+// Either side may close() it: the producer to mark the end of the stream,
+// the consumer to stop the producer early.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : cells(roundUpToPowerOfTwo(capacity)), mask(cells.size() - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side; waits while the ring is full. Returns false if the
+    // ring was closed, in which case `item` is dropped.
+    bool push(T item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == cells.size()) {
+            producerStalls++;
+            while (t - head.load(std::memory_order_acquire) == cells.size()) {
+                if (isClosed.load(std::memory_order_acquire)) return false;
+                std::this_thread::yield();
+            }
+        }
+        if (isClosed.load(std::memory_order_acquire)) return false;
+
+        cells[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+
+        const size_t occupancy = t + 1 - head.load(std::memory_order_acquire);
+        pushed++;
+        occupancySum += occupancy;
+        if (occupancy > maxOccupancy) maxOccupancy = occupancy;
+        return true;
+    }
+
+    // Consumer side; waits while the ring is empty. Returns false once the
+    // ring is closed and every item pushed before that has been popped.
+    bool pop(T& item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (tail.load(std::memory_order_acquire) == h) {
+            consumerStalls++;
+            while (tail.load(std::memory_order_acquire) == h) {
+                if (isClosed.load(std::memory_order_acquire)) {
+                    // The producer may have pushed just before closing
+                    if (tail.load(std::memory_order_acquire) == h) return false;
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        item = std::move(cells[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void close() { isClosed.store(true, std::memory_order_release); }
+    bool closed() const { return isClosed.load(std::memory_order_acquire); }
+    size_t capacity() const { return cells.size(); }
+
+    // Not synchronised; call after the producer and consumer have finished
+    RingStats stats() const {
+        RingStats s;
+        s.capacity = cells.size();
+        s.pushed = pushed;
+        s.producerStalls = producerStalls;
+        s.consumerStalls = consumerStalls;
+        s.maxOccupancy = maxOccupancy;
+        s.meanOccupancy = pushed ? double(occupancySum) / double(pushed) : 0.0;
+        return s;
+    }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t n) {
+        size_t capacity = 1;
+        while (capacity < n) capacity <<= 1;
+        return capacity;
+    }
+
+    // Each index is written by one side only; keep them on separate cache
+    // lines so the two threads do not invalidate each other's writes
+    alignas(64) std::atomic<size_t> head{ 0 };  // next slot to pop
+    alignas(64) std::atomic<size_t> tail{ 0 };  // next slot to push
+    alignas(64) std::atomic<bool> isClosed{ false };
+
+    std::vector<T> cells;
+    const size_t mask;
+
+    // Producer-side counters
+    alignas(64) uint64_t pushed = 0;
+    uint64_t producerStalls = 0;
+    uint64_t occupancySum = 0;
+    size_t maxOccupancy = 0;
+
+    // Consumer-side counters
+    alignas(64) uint64_t consumerStalls = 0;
+};
+
+#endif // TOKENRING_H
@@ -0,0 +1,191 @@
+// tokentablemodel.cpp
+#include "tokentablemodel.h"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+const int TOKEN_TYPE_COUNT = int(TokenType::NOTASSIGN) + 1;
+
+// Type names are made once per type, not once per painted row
+const QString& typeName(TokenType type) {
+    static const std::vector<QString> names = [] {
+        std::vector<QString> all;
+        for (int t = 0; t < TOKEN_TYPE_COUNT; ++t) {
+            all.push_back(QString::fromStdString(tokenTypeToString(TokenType(t))));
+        }
+        return all;
+    }();
+    return names[size_t(type)];
+}
+
+// Line breaks and tabs would spill out of the cell
+QString displayLexeme(const std::string& lexeme) {
+    QString text = QString::fromStdString(lexeme);
+    text.replace("\n", "\\n");
+    text.replace("\r", "\\r");
+    text.replace("\t", "\\t");
+    return text;
+}
+
+std::string toLowerAscii(std::string text) {
+    for (char& c : text) {
+        c = char(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+// `needle` is already lowercase
+bool containsIgnoringCase(const std::string& haystack, const std::string& needle) {
+    auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(),
+                          [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+    return it != haystack.end();
+}
+
+} // namespace
+
+TokenTableModel::TokenTableModel(QObject* parent)
+    : QAbstractTableModel(parent) {}
+
+void TokenTableModel::setTokens(std::shared_ptr<const std::vector<Token>> newTokens) {
+    beginResetModel();
+    tokens = std::move(newTokens);
+    updateRows();
+    endResetModel();
+}
+
+void TokenTableModel::setFilter(const QString& text) {
+    if (text == filter) return;
+    beginResetModel();
+    filter = text;
+    updateRows();
+    endResetModel();
+}
+
+int TokenTableModel::rowCount(const QModelIndex& parent) const {
+    if (parent.isValid() || !tokens) return 0;
+    return int(inLexingOrder ? tokens->size() : rows.size());
+}
+
+int TokenTableModel::columnCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant TokenTableModel::data(const QModelIndex& index, int role) const {
+    if (!index.isValid() || role != Qt::DisplayRole) return QVariant();
+    const Token& token = tokenAt(index.row());
+    switch (index.column()) {
+    case LineColumn:   return token.line;
+    case ColumnColumn: return token.column;
+    case LexemeColumn: return displayLexeme(token.lexeme);
+    case TypeColumn:   return typeName(token.type);
+    default:           return QVariant();
+    }
+}
+
+QVariant TokenTableModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch (section) {
+    case LineColumn:   return QString("Line");
+    case ColumnColumn: return QString("Column");
+    case LexemeColumn: return QString("Lexeme");
+    case TypeColumn:   return QString("Type");
+    default:           return QVariant();
+    }
+}
+
+// Sorting shows the same tokens in another order, so selections and the
+// current row move with their tokens instead of being reset
+void TokenTableModel::sort(int column, Qt::SortOrder order) {
+    if (column < 0 || column >= ColumnCount) return;
+    if (column == sortColumn && order == sortOrder) return;
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+
+    const QModelIndexList from = persistentIndexList();
+    std::vector<size_t> tokenOf;
+    tokenOf.reserve(from.size());
+    for (const QModelIndex& index : from) tokenOf.push_back(tokenIndex(index.row()));
+
+    sortColumn = column;
+    sortOrder = order;
+    updateRows();
+
+    if (!from.isEmpty()) {
+        std::vector<int> rowOf;
+        if (!inLexingOrder) {
+            rowOf.assign(tokens->size(), -1);
+            for (size_t row = 0; row < rows.size(); ++row) rowOf[rows[row]] = int(row);
+        }
+        QModelIndexList to;
+        to.reserve(from.size());
+        for (int i = 0; i < from.size(); ++i) {
+            const int row = inLexingOrder ? int(tokenOf[i]) : rowOf[tokenOf[i]];
+            to.append(createIndex(row, from[i].column()));
+        }
+        changePersistentIndexList(from, to);
+    }
+
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+const Token& TokenTableModel::tokenAt(int row) const {
+    return (*tokens)[tokenIndex(row)];
+}
+
+// Tokens arrive in lexing order, which is also ascending line order, so
+// that order needs no index at all
+void TokenTableModel::updateRows() {
+    rows.clear();
+    const bool byLine = sortColumn == LineColumn && sortOrder == Qt::AscendingOrder;
+    inLexingOrder = !tokens || (filter.isEmpty() && byLine);
+    if (inLexingOrder) {
+        rows.shrink_to_fit();
+        return;
+    }
+
+    // A token passes if its type name matches, which is decided once per
+    // type, or its lexeme does
+    const std::string needle = toLowerAscii(filter.toStdString());
+    std::vector<uint8_t> typeMatches(TOKEN_TYPE_COUNT, 0);
+    for (int t = 0; t < TOKEN_TYPE_COUNT; ++t) {
+        typeMatches[t] = containsIgnoringCase(tokenTypeToString(TokenType(t)), needle);
+    }
+    rows.reserve(needle.empty() ? tokens->size() : 0);
+    for (size_t i = 0; i < tokens->size(); ++i) {
+        const Token& token = (*tokens)[i];
+        if (needle.empty() || typeMatches[size_t(token.type)] || containsIgnoringCase(token.lexeme, needle)) {
+            rows.push_back(uint32_t(i));
+        }
+    }
+    if (byLine) return;
+
+    // Types compare by the rank of their name, not by the name itself
+    std::vector<int> typeRank(TOKEN_TYPE_COUNT);
+    {
+        std::vector<int> byName(TOKEN_TYPE_COUNT);
+        for (int t = 0; t < TOKEN_TYPE_COUNT; ++t) byName[t] = t;
+        std::sort(byName.begin(), byName.end(),
+                  [](int a, int b) { return typeName(TokenType(a)) < typeName(TokenType(b)); });
+        for (int r = 0; r < TOKEN_TYPE_COUNT; ++r) typeRank[byName[r]] = r;
+    }
+
+    // Stable, so equal keys stay in lexing order
+    const std::vector<Token>& all = *tokens;
+    auto less = [this, &all, &typeRank](uint32_t a, uint32_t b) {
+        const Token& x = all[a];
+        const Token& y = all[b];
+        switch (sortColumn) {
+        case LineColumn:   return x.line < y.line;
+        case ColumnColumn: return x.column < y.column;
+        case LexemeColumn: return x.lexeme < y.lexeme;
+        default:           return typeRank[size_t(x.type)] < typeRank[size_t(y.type)];
+        }
+    };
+    if (sortOrder == Qt::AscendingOrder) {
+        std::stable_sort(rows.begin(), rows.end(), less);
+    } else {
+        std::stable_sort(rows.begin(), rows.end(), [&less](uint32_t a, uint32_t b) { return less(b, a); });
+    }
+}
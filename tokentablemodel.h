@@ -0,0 +1,50 @@
+// tokentablemodel.h
+#ifndef TOKENTABLEMODEL_H
+#define TOKENTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "pythonlexer.h"
+
+// Table of the lexer's tokens for a QTableView.
+//
+// Rows are formatted in data(), so only the rows being painted are ever
+// turned into strings. In lexing order no per-row state is kept at all;
+// sorting or filtering keeps one index per row shown.
+class TokenTableModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { LineColumn, ColumnColumn, LexemeColumn, TypeColumn, ColumnCount };
+
+    explicit TokenTableModel(QObject* parent = nullptr);
+
+    // Show `tokens` under the current sort order and filter
+    void setTokens(std::shared_ptr<const std::vector<Token>> tokens);
+
+    // Keep only tokens whose lexeme or type contains `text`, ignoring case
+    void setFilter(const QString& text);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+    std::shared_ptr<const std::vector<Token>> tokens;
+    std::vector<uint32_t> rows;     // token shown in each row; unused in lexing order
+    bool inLexingOrder = true;
+    int sortColumn = LineColumn;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+    QString filter;
+
+    size_t tokenIndex(int row) const { return inLexingOrder ? size_t(row) : rows[row]; }
+    const Token& tokenAt(int row) const;
+    void updateRows();
+};
+
+#endif // TOKENTABLEMODEL_H
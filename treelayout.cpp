@@ -0,0 +1,441 @@
+// treelayout.cpp
+#include "treelayout.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Per-node state of the algorithm, as parallel arrays
+class TidyLayout {
+public:
+    TidyLayout(const TreeGeometry& geometry, qreal siblingGap, qreal subtreeGap);
+
+    void run(std::vector<qreal>& x);
+
+private:
+    const TreeGeometry& tree;
+    const qreal siblingGap;
+    const qreal subtreeGap;
+    const int count;
+
+    // Children of node v are children[childStart[v] .. childStart[v + 1]]
+    std::vector<int> childStart;
+    std::vector<int> children;
+    std::vector<int> number;        // position among its siblings
+
+    std::vector<qreal> prelim;
+    std::vector<qreal> mod;
+    std::vector<qreal> shift;
+    std::vector<qreal> change;
+    std::vector<int> thread;        // -1 when unset
+    std::vector<int> ancestor;
+
+    int childCount(int v) const { return childStart[size_t(v) + 1] - childStart[size_t(v)]; }
+    int child(int v, int i) const { return children[size_t(childStart[size_t(v)] + i)]; }
+    int firstChild(int v) const { return childCount(v) ? child(v, 0) : -1; }
+    int lastChild(int v) const { return childCount(v) ? child(v, childCount(v) - 1) : -1; }
+    int leftSibling(int v) const { return number[size_t(v)] > 0 ? child(tree.parent[size_t(v)], number[size_t(v)] - 1) : -1; }
+
+    // Next node on the left and right contour of a subtree
+    int nextLeft(int v) const { return childCount(v) ? firstChild(v) : thread[size_t(v)]; }
+    int nextRight(int v) const { return childCount(v) ? lastChild(v) : thread[size_t(v)]; }
+
+    // Required distance between the centers of two neighbours on a level
+    qreal distance(int left, int right) const;
+
+    void finish(int v);
+    int apportion(int v, int defaultAncestor);
+    void moveSubtree(int left, int right, qreal amount);
+    void executeShifts(int v);
+};
+
+TidyLayout::TidyLayout(const TreeGeometry& geometry, qreal siblingGap, qreal subtreeGap)
+    : tree(geometry), siblingGap(siblingGap), subtreeGap(subtreeGap), count(int(geometry.size())),
+      childStart(size_t(count) + 1, 0), children(count > 0 ? size_t(count) - 1 : 0), number(size_t(count), 0),
+      prelim(size_t(count), 0), mod(size_t(count), 0), shift(size_t(count), 0), change(size_t(count), 0),
+      thread(size_t(count), -1), ancestor(size_t(count))
+{
+    // Parents come before children, so filling in index order keeps
+    // siblings in source order
+    for (int v = 1; v < count; ++v) ++childStart[size_t(tree.parent[size_t(v)]) + 1];
+    for (int v = 0; v < count; ++v) childStart[size_t(v) + 1] += childStart[size_t(v)];
+    std::vector<int> next(childStart.begin(), childStart.end() - 1);
+    for (int v = 1; v < count; ++v) {
+        const size_t p = size_t(tree.parent[size_t(v)]);
+        number[size_t(v)] = next[p] - childStart[p];
+        children[size_t(next[p]++)] = v;
+    }
+    for (int v = 0; v < count; ++v) ancestor[size_t(v)] = v;
+}
+
+qreal TidyLayout::distance(int left, int right) const
+{
+    const bool siblings = tree.parent[size_t(left)] == tree.parent[size_t(right)];
+    return (tree.width[size_t(left)] + tree.width[size_t(right)]) / 2 + (siblings ? siblingGap : subtreeGap);
+}
+
+void TidyLayout::run(std::vector<qreal>& x)
+{
+    x.assign(size_t(count), 0);
+    if (count == 0) return;
+
+    // First walk, post-order with an explicit stack. Each child is
+    // apportioned against its left siblings as soon as it is finished.
+    struct Frame {
+        int node;
+        int nextChild;
+        int defaultAncestor;
+    };
+    std::vector<Frame> stack;
+    stack.push_back({ 0, 0, firstChild(0) });
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        if (frame.nextChild < childCount(frame.node)) {
+            const int w = child(frame.node, frame.nextChild++);
+            stack.push_back({ w, 0, firstChild(w) });
+            continue;
+        }
+        const int v = frame.node;
+        finish(v);
+        stack.pop_back();
+        if (!stack.empty()) {
+            stack.back().defaultAncestor = apportion(v, stack.back().defaultAncestor);
+        }
+    }
+
+    // Second walk: a node's offset is the sum of the mods of its ancestors;
+    // parents come first, so index order will do
+    std::vector<qreal> offset(size_t(count), 0);
+    for (int v = 0; v < count; ++v) {
+        const int p = tree.parent[size_t(v)];
+        if (p >= 0) offset[size_t(v)] = offset[size_t(p)] + mod[size_t(p)];
+        x[size_t(v)] = prelim[size_t(v)] + offset[size_t(v)];
+    }
+    const qreal rootX = x[0];
+    for (qreal& value : x) value -= rootX;
+}
+
+// Place v once its children are placed
+void TidyLayout::finish(int v)
+{
+    const int left = leftSibling(v);
+    if (childCount(v) == 0) {
+        prelim[size_t(v)] = left >= 0 ? prelim[size_t(left)] + distance(left, v) : 0;
+        return;
+    }
+    executeShifts(v);
+    const qreal midpoint = (prelim[size_t(firstChild(v))] + prelim[size_t(lastChild(v))]) / 2;
+    if (left >= 0) {
+        prelim[size_t(v)] = prelim[size_t(left)] + distance(left, v);
+        mod[size_t(v)] = prelim[size_t(v)] - midpoint;
+    } else {
+        prelim[size_t(v)] = midpoint;
+    }
+}
+
+// Push the subtree of v right until it clears the subtrees of its left
+// siblings, walking their facing contours level by level
+int TidyLayout::apportion(int v, int defaultAncestor)
+{
+    const int left = leftSibling(v);
+    if (left < 0) return defaultAncestor;
+
+    int insideRight = v;                                    // v+ inside
+    int outsideRight = v;                                   // v+ outside
+    int insideLeft = left;                                  // v- inside
+    int outsideLeft = firstChild(tree.parent[size_t(v)]);   // v- outside
+    qreal modInsideRight = mod[size_t(insideRight)];
+    qreal modOutsideRight = mod[size_t(outsideRight)];
+    qreal modInsideLeft = mod[size_t(insideLeft)];
+    qreal modOutsideLeft = mod[size_t(outsideLeft)];
+
+    while (nextRight(insideLeft) >= 0 && nextLeft(insideRight) >= 0) {
+        insideLeft = nextRight(insideLeft);
+        insideRight = nextLeft(insideRight);
+        outsideLeft = nextLeft(outsideLeft);
+        outsideRight = nextRight(outsideRight);
+        ancestor[size_t(outsideRight)] = v;
+
+        const qreal overlap = (prelim[size_t(insideLeft)] + modInsideLeft)
+            - (prelim[size_t(insideRight)] + modInsideRight) + distance(insideLeft, insideRight);
+        if (overlap > 0) {
+            // The subtree to move against is the sibling of v that holds insideLeft
+            const int candidate = ancestor[size_t(insideLeft)];
+            const int from = tree.parent[size_t(candidate)] == tree.parent[size_t(v)] ? candidate : defaultAncestor;
+            moveSubtree(from, v, overlap);
+            modInsideRight += overlap;
+            modOutsideRight += overlap;
+        }
+        modInsideLeft += mod[size_t(insideLeft)];
+        modInsideRight += mod[size_t(insideRight)];
+        modOutsideLeft += mod[size_t(outsideLeft)];
+        modOutsideRight += mod[size_t(outsideRight)];
+    }
+
+    // Thread the shorter contour onto the longer one
+    if (nextRight(insideLeft) >= 0 && nextRight(outsideRight) < 0) {
+        thread[size_t(outsideRight)] = nextRight(insideLeft);
+        mod[size_t(outsideRight)] += modInsideLeft - modOutsideRight;
+    }
+    if (nextLeft(insideRight) >= 0 && nextLeft(outsideLeft) < 0) {
+        thread[size_t(outsideLeft)] = nextLeft(insideRight);
+        mod[size_t(outsideLeft)] += modInsideRight - modOutsideLeft;
+        defaultAncestor = v;
+    }
+    return defaultAncestor;
+}
+
+// Shift the subtree of `right` by `amount` and spread the shift over the
+// siblings between it and `left`; executeShifts() applies the spread
+void TidyLayout::moveSubtree(int left, int right, qreal amount)
+{
+    const qreal subtrees = number[size_t(right)] - number[size_t(left)];
+    change[size_t(right)] -= amount / subtrees;
+    shift[size_t(right)] += amount;
+    change[size_t(left)] += amount / subtrees;
+    prelim[size_t(right)] += amount;
+    mod[size_t(right)] += amount;
+}
+
+void TidyLayout::executeShifts(int v)
+{
+    qreal totalShift = 0;
+    qreal totalChange = 0;
+    for (int i = childCount(v) - 1; i >= 0; --i) {
+        const size_t w = size_t(child(v, i));
+        prelim[w] += totalShift;
+        mod[w] += totalShift;
+        totalChange += change[w];
+        totalShift += shift[w] + totalChange;
+    }
+}
+
+} // namespace
+
+void layoutTidyTree(TreeGeometry& geometry, qreal siblingGap, qreal subtreeGap)
+{
+    TidyLayout layout(geometry, siblingGap, subtreeGap);
+    layout.run(geometry.x);
+}
+
+TreeGeometry replaceSubtree(const TreeGeometry& geometry, const TreeIndex& index, int node,
+                            const TreeGeometry& subtree, qreal siblingGap, qreal subtreeGap)
+{
+    const int count = int(geometry.size());
+    const int levels = int(index.levelStart.size()) - 1;
+    const int depth = geometry.depth[size_t(node)];
+    const qreal unbounded = -std::numeric_limits<qreal>::infinity();
+
+    // In a tidy layout each level is in pre-order as well as in x order, so
+    // the nodes before or after a given one are found by binary search
+    const auto levelBegin = [&index](int d) { return index.levelStart[size_t(d)]; };
+    const auto levelEnd = [&index](int d) { return index.levelStart[size_t(d) + 1]; };
+    const auto bound = [&index](int d, int v) {
+        const auto begin = index.byLevel.begin() + index.levelStart[size_t(d)];
+        const auto end = index.byLevel.begin() + index.levelStart[size_t(d) + 1];
+        return int(std::lower_bound(begin, end, v) - index.byLevel.begin());
+    };
+    const auto at = [&index](int pos) { return index.byLevel[size_t(pos)]; };
+    const auto distance = [siblingGap, subtreeGap](qreal leftWidth, qreal rightWidth, bool siblings) {
+        return (leftWidth + rightWidth) / 2 + (siblings ? siblingGap : subtreeGap);
+    };
+
+    // Ancestors of node by depth, and where each one's subtree ends: at the
+    // next node on its level or where its parent's ends
+    std::vector<int> path(size_t(depth) + 1);
+    for (int v = node; v >= 0; v = geometry.parent[size_t(v)]) path[size_t(geometry.depth[size_t(v)])] = v;
+    std::vector<int> ends(path.size());
+    for (int d = 0; d <= depth; ++d) {
+        const int next = bound(d, path[size_t(d)]) + 1;
+        const int nextOnLevel = next < levelEnd(d) ? at(next) : count;
+        ends[size_t(d)] = std::min(nextOnLevel, d > 0 ? ends[size_t(d) - 1] : count);
+    }
+    const int end = ends[size_t(depth)];
+
+    // Outermost nodes of each level of the new subtree; in pre-order the
+    // first and last of a level
+    int subtreeLevels = 0;
+    for (int d : subtree.depth) subtreeLevels = std::max(subtreeLevels, d + 1);
+    std::vector<int> leftmost(size_t(subtreeLevels), -1);
+    std::vector<int> rightmost(size_t(subtreeLevels), -1);
+    for (int i = 0; i < int(subtree.size()); ++i) {
+        const size_t d = size_t(subtree.depth[size_t(i)]);
+        if (leftmost[d] < 0) leftmost[d] = i;
+        rightmost[d] = i;
+    }
+    const qreal anchor = geometry.x[size_t(node)];
+
+    // The first walk of a tidy layout, along the path only: going up from
+    // node, the subtree of each ancestor is placed as far left as the
+    // subtrees of its elder siblings allow, then each younger sibling's
+    // subtree as far left as everything before it allows, and the parent is
+    // centred over them. Subtrees off the path keep their shape and the
+    // elder siblings keep their place. Once two younger siblings in a row
+    // move alike, the rest of them move as one block.
+    //
+    // Positions are kept in the frame of an ancestor: where the nodes of its
+    // subtree go if the subtree itself is not moved. The subtree of path[d]
+    // moves by shift[d] within its parent's frame, so going from the frame
+    // of path[d] to that of path[k] adds moved[k + 1] - moved[d + 1].
+    std::vector<qreal> moved(path.size() + 1, 0);   // sum of the shifts from path[d] down
+    std::vector<qreal> centre(path.size());         // path[d] in its own frame
+    std::vector<int> blockStart;                    // younger siblings, in pre-order
+    std::vector<qreal> blockShift;
+    std::vector<int> blockParent;                   // depth of their parent
+    centre[size_t(depth)] = anchor + subtree.x[0];
+
+    // Parents are old indices, or -2 inside the new subtree
+    struct Placed {
+        qreal x;
+        qreal width;
+        int parent;
+    };
+    const auto frame = [&moved](int k, int d) { return moved[size_t(k) + 1] - moved[size_t(d) + 1]; };
+
+    // Old node v, outside the old subtree, in the frame of path[k]
+    const auto oldAt = [&](int k, int v) {
+        qreal x;
+        if (v >= end) {
+            const size_t b = size_t(std::upper_bound(blockStart.begin(), blockStart.end(), v) - blockStart.begin()) - 1;
+            x = geometry.x[size_t(v)] + blockShift[b] + frame(k, blockParent[b]);
+        } else {
+            const int d = int(std::upper_bound(path.begin(), path.end(), v) - path.begin()) - 1;
+            x = (path[size_t(d)] == v ? centre[size_t(d)] : geometry.x[size_t(v)]) + frame(k, d);
+        }
+        return Placed{ x, geometry.width[size_t(v)], geometry.parent[size_t(v)] };
+    };
+
+    // Node s of the new subtree in the frame of path[k]
+    const auto newAt = [&](int k, int s) {
+        const int parent = subtree.depth[size_t(s)] == 0 ? geometry.parent[size_t(node)] : -2;
+        return Placed{ anchor + subtree.x[size_t(s)] + frame(k, depth), subtree.width[size_t(s)], parent };
+    };
+
+    // Leftmost node on `level` of the subtree of path[j], in its frame
+    const auto leftmostOf = [&](int j, int level, Placed& placed) {
+        const int pos = bound(level, path[size_t(j)]);
+        if (pos < levelEnd(level) && at(pos) < node) {
+            placed = oldAt(j, at(pos));
+            return true;
+        }
+        const int l = level - depth;
+        if (l >= 0 && l < subtreeLevels) {
+            placed = newAt(j, leftmost[size_t(l)]);
+            return true;
+        }
+        const int after = bound(level, end);
+        if (after < levelEnd(level) && at(after) < ends[size_t(j)]) {
+            placed = oldAt(j, at(after));
+            return true;
+        }
+        return false;
+    };
+
+    // Nearest node on the left of old position `pos` on `level` among the
+    // descendants of path[k] placed so far, in its frame: a younger
+    // sibling's, else the new subtree's, else one before it
+    const auto leftNeighbour = [&](int k, int level, int pos, Placed& placed) {
+        if (pos > levelBegin(level) && at(pos - 1) >= end) {
+            placed = oldAt(k, at(pos - 1));
+            return true;
+        }
+        const int l = level - depth;
+        if (l >= 0 && l < subtreeLevels) {
+            placed = newAt(k, rightmost[size_t(l)]);
+            return true;
+        }
+        const int before = bound(level, node);
+        if (before == levelBegin(level) || at(before - 1) <= path[size_t(k)]) return false;
+        placed = oldAt(k, at(before - 1));
+        return true;
+    };
+
+    for (int j = depth; j > 0; --j) {
+        const int parent = path[size_t(j) - 1];
+
+        // The subtree of path[j] against those of its elder siblings
+        qreal lowest = unbounded;
+        for (int level = j; level < levels; ++level) {
+            const int pos = bound(level, path[size_t(j)]) - 1;
+            if (pos < levelBegin(level) || at(pos) <= parent) break;
+            const Placed left = oldAt(j - 1, at(pos));
+            Placed right;
+            if (!leftmostOf(j, level, right)) break;
+            lowest = std::max(lowest, left.x + distance(left.width, right.width, left.parent == right.parent) - right.x);
+        }
+        moved[size_t(j)] = (lowest == unbounded ? 0 : lowest) + moved[size_t(j) + 1];
+
+        // Then the subtrees of its younger siblings, one at a time
+        const int firstPos = bound(j, ends[size_t(j)]);
+        const int lastPos = bound(j, ends[size_t(j) - 1]);
+        bool rest = false;
+        for (int pos = firstPos; pos < lastPos; ++pos) {
+            const int from = at(pos);
+            const bool last = rest || pos + 1 == lastPos;
+            const int to = last ? ends[size_t(j) - 1] : at(pos + 1);
+            lowest = unbounded;
+            for (int level = j; level < levels; ++level) {
+                const int first = bound(level, from);
+                if (first >= levelEnd(level) || at(first) >= to) break;
+                Placed left;
+                if (!leftNeighbour(j - 1, level, first, left)) break;
+                const size_t v = size_t(at(first));
+                lowest = std::max(lowest, left.x + distance(left.width, geometry.width[v], left.parent == geometry.parent[v])
+                                          - geometry.x[v]);
+            }
+            const qreal shift = lowest == unbounded ? 0 : lowest;
+            rest = !blockShift.empty() && blockParent.back() == j - 1 && shift == blockShift.back();
+            blockStart.push_back(from);
+            blockShift.push_back(shift);
+            blockParent.push_back(j - 1);
+            if (last) break;
+        }
+
+        // The parent, centred between its first and last child
+        const int lastChild = lastPos > firstPos ? at(lastPos - 1) : path[size_t(j)];
+        centre[size_t(j) - 1] = (oldAt(j - 1, parent + 1).x + oldAt(j - 1, lastChild).x) / 2;
+    }
+
+    // Splice: what comes before keeps its numbering, the new subtree
+    // follows, and the younger siblings after it are renumbered
+    const int added = int(subtree.size()) - (end - node);
+    TreeGeometry result;
+    result.nodeHeight = geometry.nodeHeight;
+    result.levelHeight = geometry.levelHeight;
+    const size_t total = size_t(count + added);
+    result.parent.reserve(total);
+    result.depth.reserve(total);
+    result.x.reserve(total);
+    result.width.reserve(total);
+    result.label.reserve(total);
+    result.collapsed.reserve(total);
+    const auto copy = [&result](const TreeGeometry& from, int v, int parent, int depth, qreal x) {
+        result.parent.push_back(parent);
+        result.depth.push_back(depth);
+        result.x.push_back(x);
+        result.width.push_back(from.width[size_t(v)]);
+        result.label.push_back(from.label[size_t(v)]);
+        result.collapsed.push_back(from.collapsed[size_t(v)]);
+    };
+    for (int d = 0; d < depth; ++d) {
+        const int v = path[size_t(d)];
+        copy(geometry, v, geometry.parent[size_t(v)], d, centre[size_t(d)] + frame(0, d));
+        for (int w = v + 1; w < path[size_t(d) + 1]; ++w) {
+            copy(geometry, w, geometry.parent[size_t(w)], geometry.depth[size_t(w)], geometry.x[size_t(w)] + frame(0, d));
+        }
+    }
+    for (int v = 0; v < int(subtree.size()); ++v) {
+        const int parent = v == 0 ? geometry.parent[size_t(node)] : node + subtree.parent[size_t(v)];
+        copy(subtree, v, parent, depth + subtree.depth[size_t(v)], newAt(0, v).x);
+    }
+    for (size_t b = 0; b < blockStart.size(); ++b) {
+        const qreal shift = blockShift[b] + frame(0, blockParent[b]);
+        const int to = b + 1 < blockStart.size() ? blockStart[b + 1] : count;
+        for (int v = blockStart[b]; v < to; ++v) {
+            const int parent = geometry.parent[size_t(v)];
+            copy(geometry, v, parent >= end ? parent + added : parent, geometry.depth[size_t(v)], geometry.x[size_t(v)] + shift);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,26 @@
+// treelayout.h
+#ifndef TREELAYOUT_H
+#define TREELAYOUT_H
+
+#include "parsetreeitem.h"
+
+// Tidy tree layout: Buchheim, Jünger and Leipert's linear-time form of
+// Walker's algorithm. Fills in geometry.x from the parent and width arrays.
+// Parents are centred over their children, siblings keep their order, and
+// subtrees are packed as close as the gaps allow without ever overlapping.
+// Adjacent nodes of a level keep `siblingGap` between their boxes when they
+// share a parent and `subtreeGap` otherwise. The root ends up at x = 0.
+void layoutTidyTree(TreeGeometry& geometry, qreal siblingGap, qreal subtreeGap);
+
+// Swap the subtree below `node` of a tidy layout for `subtree`, laid out on
+// its own by layoutTidyTree() with a copy of `node` as its root, and return
+// the combined layout. Only the path from `node` up to the root is laid out
+// again, as layoutTidyTree() would: going up, each ancestor's subtree is
+// placed against its elder siblings, its younger siblings follow it one by
+// one, each moved by the least amount that keeps every level clear, and the
+// parent is centred over them. Elder siblings keep their place. Both trees
+// must be numbered in pre-order and `index` built from `geometry`.
+TreeGeometry replaceSubtree(const TreeGeometry& geometry, const TreeIndex& index, int node,
+                            const TreeGeometry& subtree, qreal siblingGap, qreal subtreeGap);
+
+#endif // TREELAYOUT_H
@@ -0,0 +1,259 @@
+// treeminimap.cpp
+#include "treeminimap.h"
+#include "parsetreedisplay.h"
+#include <QPainter>
+#include <QPen>
+#include <algorithm>
+#include <cmath>
+
+// Shade of fully covered pixels, the faintest shade a node leaves, and how
+// much coverage makes a pixel fully shaded
+static const int INK = 70;
+static const float MIN_SHADE = 0.2f;
+static const float FULL_COVERAGE = 0.5f;
+
+// The part in view stays at least this big, so it can be seen and grabbed
+static const qreal MIN_MARK_PIXELS = 6;
+
+// Room around the overview
+static const qreal MARGIN = 4;
+
+static const QColor MARK_COLOR(30, 90, 200);
+
+TreeMinimap::TreeMinimap(ParseTreeDisplay* view, QWidget* parent)
+    : QWidget(parent), view(view)
+{
+    setFixedWidth(MINIMAP_WIDTH);
+    setToolTip("Drag to move the view");
+
+    // A burst of toggles or a drag of the splitter renders once, after it
+    renderTimer.setSingleShot(true);
+    renderTimer.setInterval(RENDER_DELAY_MS);
+    connect(&renderTimer, &QTimer::timeout, this, &TreeMinimap::startRender);
+
+    connect(view, &ParseTreeDisplay::treeChanged, this, &TreeMinimap::treeChanged);
+    connect(view, &ParseTreeDisplay::viewChanged, this, [this]() { update(); });
+
+    // One worker, so a superseded render finishes (or notices it was
+    // cancelled) before the next one starts
+    qRegisterMetaType<std::shared_ptr<RenderedOverview>>();
+    renderPool.setMaxThreadCount(1);
+    connect(this, &TreeMinimap::overviewReady, this, &TreeMinimap::showOverview, Qt::QueuedConnection);
+}
+
+TreeMinimap::~TreeMinimap()
+{
+    // The worker refers to this widget; let it stop before tearing down
+    if (activeRender) {
+        activeRender->cancel();
+    }
+    renderPool.waitForDone();
+}
+
+void TreeMinimap::treeChanged()
+{
+    // Copied when the render starts, so only the last of a burst is copied
+    outline.reset();
+    renderTimer.start();
+}
+
+void TreeMinimap::startRender()
+{
+    if (activeRender) {
+        activeRender->cancel();
+        activeRender.reset();
+    }
+    const uint64_t generation = ++renderGeneration;
+
+    if (!outline) {
+        const TreeGeometry& geometry = view->treeGeometry();
+        if (geometry.size() == 0) {
+            overview = QPixmap();
+            update();
+            return;
+        }
+        auto copy = std::make_shared<TreeOutline>();
+        copy->depth = geometry.depth;
+        copy->x = geometry.x;
+        copy->width = geometry.width;
+        copy->nodeHeight = geometry.nodeHeight;
+        copy->levelHeight = geometry.levelHeight;
+        copy->bounds = view->treeBounds();
+        outline = copy;
+    }
+
+    const QSize size = (overviewRect().size() * devicePixelRatioF()).toSize();
+    if (size.isEmpty()) return;
+
+    auto cancel = std::make_shared<CancellationToken>();
+    activeRender = cancel;
+    renderPool.start([this, source = outline, size, cancel, generation]() {
+        auto rendered = std::make_shared<RenderedOverview>();
+        rendered->generation = generation;
+        rendered->image = render(*source, size, *cancel);
+        if (cancel->isCancelled()) return;
+        rendered->bounds = source->bounds;
+        emit overviewReady(rendered);
+    });
+}
+
+void TreeMinimap::showOverview(std::shared_ptr<RenderedOverview> rendered)
+{
+    // A newer render was requested since this one started
+    if (rendered->generation != renderGeneration) return;
+    activeRender.reset();
+
+    overview = QPixmap::fromImage(std::move(rendered->image));
+    overview.setDevicePixelRatio(devicePixelRatioF());
+    overviewBounds = rendered->bounds;
+    update();
+}
+
+// Each node adds the share of every pixel its box covers, so a pixel over
+// thousands of nodes and one over a single box come out in proportion.
+// The two axes are scaled apart to fill the image: parse trees are far
+// wider than deep, and kept to scale the levels would share a few rows.
+// Stretched that way a node spans many rows, all of which it shares with
+// its level, so nodes are summed into the columns of their level first
+// and each level is spread over its rows once.
+QImage TreeMinimap::render(const TreeOutline& outline, const QSize& size, const CancellationToken& cancel)
+{
+    const int width = size.width();
+    const int height = size.height();
+    const QRectF& bounds = outline.bounds;
+    const qreal scaleX = width / bounds.width();
+    const qreal scaleY = height / bounds.height();
+
+    int levels = 0;
+    for (int d : outline.depth) levels = std::max(levels, d + 1);
+    std::vector<float> levelColumns(size_t(levels) * size_t(width), 0);
+    for (size_t i = 0; i < outline.x.size(); ++i) {
+        if (i % 4096 == 0 && cancel.isCancelled()) return QImage();
+        const qreal left = (outline.x[i] - outline.width[i] / 2 - bounds.left()) * scaleX;
+        const qreal right = left + outline.width[i] * scaleX;
+        float* columns = levelColumns.data() + size_t(outline.depth[i]) * size_t(width);
+        const int lastColumn = std::min(width, int(std::ceil(right)));
+        for (int column = std::max(0, int(left)); column < lastColumn; ++column) {
+            columns[column] += float(std::min(right, column + 1.0) - std::max(left, qreal(column)));
+        }
+    }
+
+    std::vector<float> coverage(size_t(width) * size_t(height), 0);
+    for (int d = 0; d < levels; ++d) {
+        if (cancel.isCancelled()) return QImage();
+        const float* columns = levelColumns.data() + size_t(d) * size_t(width);
+        const qreal top = (d * outline.levelHeight - outline.nodeHeight / 2 - bounds.top()) * scaleY;
+        const qreal bottom = top + outline.nodeHeight * scaleY;
+        const int lastRow = std::min(height, int(std::ceil(bottom)));
+        for (int row = std::max(0, int(top)); row < lastRow; ++row) {
+            const float rowShare = float(std::min(bottom, row + 1.0) - std::max(top, qreal(row)));
+            float* line = coverage.data() + size_t(row) * size_t(width);
+            for (int column = 0; column < width; ++column) line[column] += rowShare * columns[column];
+        }
+    }
+
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int row = 0; row < height; ++row) {
+        const float* line = coverage.data() + size_t(row) * size_t(width);
+        QRgb* pixels = reinterpret_cast<QRgb*>(image.scanLine(row));
+        for (int column = 0; column < width; ++column) {
+            // Nodes far below a pixel still leave a trace
+            const float shade = line[column] > 0 ? std::clamp(line[column] / FULL_COVERAGE, MIN_SHADE, 1.0f) : 0;
+            const int value = 255 - int(shade * (255 - INK));
+            pixels[column] = qRgb(value, value, value);
+        }
+    }
+    return image;
+}
+
+QRectF TreeMinimap::overviewRect() const
+{
+    return QRectF(rect()).adjusted(MARGIN, MARGIN, -MARGIN, -MARGIN);
+}
+
+QRectF TreeMinimap::viewMark() const
+{
+    if (overview.isNull()) return QRectF();
+    const QRectF target = overviewRect();
+    const QRectF visible = view->mapToScene(view->viewport()->rect()).boundingRect();
+    const qreal scaleX = target.width() / overviewBounds.width();
+    const qreal scaleY = target.height() / overviewBounds.height();
+    QRectF mark(target.left() + (visible.left() - overviewBounds.left()) * scaleX,
+                target.top() + (visible.top() - overviewBounds.top()) * scaleY,
+                visible.width() * scaleX, visible.height() * scaleY);
+    mark = mark.intersected(target);
+
+    // Zoomed far in on a big tree, the view covers less than a pixel
+    const QPointF centre = mark.center();
+    mark.setWidth(std::max(mark.width(), MIN_MARK_PIXELS));
+    mark.setHeight(std::max(mark.height(), MIN_MARK_PIXELS));
+    mark.moveCenter(centre);
+    return mark;
+}
+
+QPointF TreeMinimap::toScene(const QPointF& pos) const
+{
+    const QRectF target = overviewRect();
+    return QPointF(overviewBounds.left() + (pos.x() - target.left()) / target.width() * overviewBounds.width(),
+                   overviewBounds.top() + (pos.y() - target.top()) / target.height() * overviewBounds.height());
+}
+
+void TreeMinimap::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::white);
+    if (overview.isNull()) return;
+
+    // Until a render for a new size arrives, the last one is stretched
+    painter.drawPixmap(overviewRect(), overview, QRectF(overview.rect()));
+
+    QColor fill = MARK_COLOR;
+    fill.setAlpha(40);
+    painter.setPen(QPen(MARK_COLOR, 1));
+    painter.setBrush(fill);
+    painter.drawRect(viewMark());
+}
+
+void TreeMinimap::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    renderTimer.start();
+}
+
+void TreeMinimap::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() != Qt::LeftButton || overview.isNull()) {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+
+    // Grabbing the mark keeps the point grabbed under the pointer; pressing
+    // elsewhere brings the view there first
+    const QPointF pos = event->position();
+    const QRectF mark = viewMark();
+    if (mark.contains(pos)) {
+        grabOffset = pos - mark.center();
+    } else {
+        grabOffset = QPointF();
+        view->centerOn(toScene(pos));
+    }
+    setCursor(Qt::ClosedHandCursor);
+    event->accept();
+}
+
+void TreeMinimap::mouseMoveEvent(QMouseEvent* event)
+{
+    if (!(event->buttons() & Qt::LeftButton) || overview.isNull()) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+    view->centerOn(toScene(event->position() - grabOffset));
+    event->accept();
+}
+
+void TreeMinimap::mouseReleaseEvent(QMouseEvent* event)
+{
+    unsetCursor();
+    QWidget::mouseReleaseEvent(event);
+}
@@ -0,0 +1,100 @@
+// treeminimap.h
+#ifndef TREEMINIMAP_H
+#define TREEMINIMAP_H
+
+#include <QWidget>
+#include <QImage>
+#include <QPixmap>
+#include <QMetaType>
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QThreadPool>
+#include <QTimer>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cancellation.h"
+
+class ParseTreeDisplay;
+
+// Node boxes of the tree shown, all the overview is drawn from
+struct TreeOutline {
+    std::vector<int> depth;
+    std::vector<qreal> x;
+    std::vector<qreal> width;
+    qreal nodeHeight = 0;
+    qreal levelHeight = 0;
+    QRectF bounds;
+};
+
+// An overview rendered by the minimap's worker
+struct RenderedOverview {
+    uint64_t generation = 0;    // request this answers; older ones are stale
+    QImage image;
+    QRectF bounds;              // scene rectangle the image covers
+};
+
+Q_DECLARE_METATYPE(std::shared_ptr<RenderedOverview>)
+
+// Overview of the whole tree of a ParseTreeDisplay, with the part in view
+// marked by a rectangle that can be dragged to move the view.
+//
+// The overview is rendered on a worker thread whenever the tree changes
+// shape or the minimap is resized, as node density per pixel stretched to
+// fill the minimap, and kept as a pixmap. Scrolling and zooming the view
+// only move the rectangle, so they cost the same whatever the size of the
+// tree.
+class TreeMinimap : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit TreeMinimap(ParseTreeDisplay* view, QWidget* parent = nullptr);
+    ~TreeMinimap();
+
+signals:
+    // Emitted from the render worker thread
+    void overviewReady(std::shared_ptr<RenderedOverview> overview);
+
+private:
+    ParseTreeDisplay* view;
+
+    // The outline is copied from the view when its tree changes and kept
+    // for renders after a resize; the overview is the last one finished
+    std::shared_ptr<const TreeOutline> outline;
+    QPixmap overview;
+    QRectF overviewBounds;
+    QPointF grabOffset;         // from the centre of the view rectangle
+
+    QTimer renderTimer;         // gathers bursts of changes into one render
+    QThreadPool renderPool;
+    std::shared_ptr<CancellationToken> activeRender;    // render in flight
+    uint64_t renderGeneration = 0;                      // latest request
+
+    const int MINIMAP_WIDTH = 180;
+    const int RENDER_DELAY_MS = 50;
+
+    void treeChanged();
+    void startRender();
+    void showOverview(std::shared_ptr<RenderedOverview> rendered);
+
+    // Where the overview is drawn, the part of it in view, and the scene
+    // point under a point of the overview
+    QRectF overviewRect() const;
+    QRectF viewMark() const;
+    QPointF toScene(const QPointF& pos) const;
+
+    // Runs on the worker
+    static QImage render(const TreeOutline& outline, const QSize& size, const CancellationToken& cancel);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+
+    // Pressing moves the view there, dragging moves it along
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+};
+
+#endif // TREEMINIMAP_H
@@ -0,0 +1,505 @@
+// typeinference.cpp
+#include "typeinference.h"
+#include <deque>
+
+namespace {
+
+const TypeSet INT = typeBit(DataType::Int);
+const TypeSet FLOAT = typeBit(DataType::Float);
+const TypeSet STR = typeBit(DataType::Str);
+const TypeSet BOOL = typeBit(DataType::Bool);
+const TypeSet FUNCTION = typeBit(DataType::Function);
+const TypeSet NONE = typeBit(DataType::None);
+const TypeSet NUMBER = INT | FLOAT | BOOL;
+
+bool isLiteral(const QString& kind) {
+    return kind == "Number" || kind == "Hex" || kind == "Binary" || kind == "Octal" ||
+           kind == "String" || kind == "Bool";
+}
+
+TypeSet literalType(const ParseNode* node) {
+    if (node->name == "String") return STR;
+    if (node->name == "Bool") return BOOL;
+    if (node->name != "Number") return INT;
+    const std::string digits = node->value.toStdString();
+    if (digits.find_first_of("jJ") != std::string::npos) return ANY_TYPE;     // complex
+    return digits.find_first_of(".eE") != std::string::npos ? FLOAT : INT;
+}
+
+// Identifiers and call sites in an expression, in evaluation order
+void collectUses(const ParseNode* expr, std::vector<const ParseNode*>& uses) {
+    std::vector<const ParseNode*> stack;
+    if (expr) stack.push_back(expr);
+    while (!stack.empty()) {
+        const ParseNode* node = stack.back();
+        stack.pop_back();
+        if (!node) continue;
+        if (node->name == "Identifier" || node->name == "FuncCall") uses.push_back(node);
+        for (int i = node->children.size() - 1; i >= 0; --i) {
+            stack.push_back(node->children[i]);
+        }
+    }
+}
+
+} // namespace
+
+DataType singleType(TypeSet types) {
+    for (DataType type : { DataType::Int, DataType::Float, DataType::Str, DataType::Bool,
+                           DataType::Function, DataType::None }) {
+        if (types == typeBit(type)) return type;
+    }
+    return DataType::Unknown;
+}
+
+//——— Definitions and uses ———
+
+int32_t TypeInference::addDef(Def::Kind kind, const ParseNode* node, const ParseNode* target) {
+    const Slot* slot = target ? resolver->slotOf(target) : nullptr;
+    if (!slot) return -1;
+    Def def;
+    def.kind = kind;
+    def.node = node;
+    def.target = target;
+    def.var = varKey(*slot);
+    defs.push_back(def);
+    const int32_t index = int32_t(defs.size() - 1);
+    defsOfVar[def.var].push_back(index);
+    return index;
+}
+
+// Walks back from `block` until each path meets a definition of `var`;
+// paths that reach the entry first leave the name unbound there
+TypeInference::Reach TypeInference::reachingAtEntry(const ControlFlowGraph& graph, int32_t block, uint64_t var,
+        const std::vector<std::unordered_map<uint64_t, int32_t>>& lastDef) const {
+    Reach reach;
+    std::vector<bool> visited(graph.blockCount(), false);
+    const auto preds = graph.predecessors(block);
+    std::vector<int32_t> pending(preds.begin(), preds.end());
+    while (!pending.empty()) {
+        const int32_t b = pending.back();
+        pending.pop_back();
+        if (visited[b]) continue;
+        visited[b] = true;
+
+        auto def = lastDef[b].find(var);
+        if (def != lastDef[b].end()) {
+            reach.defs.push_back(def->second);
+            continue;
+        }
+        if (graph.isOpaque(b)) reach.opaque = true;
+        for (int32_t pred : graph.predecessors(b)) {
+            pending.push_back(pred);
+        }
+    }
+    return reach;
+}
+
+void TypeInference::addGraph(const ControlFlowGraph& graph) {
+    const bool isFunction = graph.owner && graph.owner->name == "FuncDef";
+    const int32_t scope = isFunction ? resolver->scopeOf(graph.owner) : ScopeResolver::MODULE_SCOPE;
+    if (scope < 0) return;
+
+    // Parameters are defined on entry
+    std::vector<std::unordered_map<uint64_t, int32_t>> lastDef(graph.blockCount());
+    int32_t function = -1;
+    if (isFunction) {
+        function = int32_t(functions.size());
+        functions.emplace_back(graph.owner);
+        functionIndex[graph.owner] = function;
+        int32_t position = 0;
+        for (const ParseNode* part : graph.owner->children) {
+            if (!part || part->name != "ParamList") continue;
+            for (const ParseNode* param : part->children) {
+                const int32_t def = addDef(Def::Kind::Param, graph.owner, param);
+                if (def >= 0) {
+                    defs[def].paramIndex = position;
+                    lastDef[ControlFlowGraph::ENTRY][defs[def].var] = def;
+                }
+                ++position;
+            }
+        }
+    }
+
+    // Definitions, block by block and in order. A use after a definition
+    // in its own block links to it at once; the others wait until every
+    // block's last definitions are known
+    struct Use {
+        const ParseNode* node;
+        int32_t block;
+        int32_t index;      // slot in this scope
+    };
+    std::vector<Use> uses;
+    for (int32_t b = 0; b < graph.blockCount(); ++b) {
+        if (graph.isOpaque(b)) opaqueScopes.insert(scope);
+        std::unordered_map<uint64_t, int32_t>& defined = lastDef[b];
+        std::vector<const ParseNode*> found;
+        auto use = [&](const ParseNode* expr) {
+            found.clear();
+            collectUses(expr, found);
+            for (const ParseNode* node : found) {
+                const Slot* slot = resolver->slotOf(node);
+                if (!slot) {
+                    reaches[node].opaque = true;
+                    continue;
+                }
+                if (slot->scope == ScopeResolver::BUILTIN_SCOPE) continue;
+                const uint64_t var = varKey(*slot);
+                if (slot->scope != scope) {
+                    outerUses.push_back({ node, var });
+                    continue;
+                }
+                auto local = defined.find(var);
+                if (local != defined.end()) {
+                    reaches[node].defs.push_back(local->second);
+                } else {
+                    uses.push_back({ node, b, slot->index });
+                }
+            }
+        };
+        auto define = [&](Def::Kind kind, const ParseNode* node, const ParseNode* target) {
+            const int32_t def = addDef(kind, node, target);
+            if (def >= 0) defined[defs[def].var] = def;
+        };
+
+        for (const ParseNode* item : graph.items(b)) {
+            const QString& kind = item->name;
+            if (kind == "Assignment") {
+                if (item->value != "=") use(item->children.value(0));
+                use(item->children.value(1));
+                define(Def::Kind::Assign, item, item->children.value(0));
+            } else if (kind == "ForStmt") {
+                if (const ParseNode* targets = item->children.value(0)) {
+                    for (const ParseNode* target : targets->children) {
+                        define(Def::Kind::ForTarget, item, target);
+                    }
+                }
+            } else if (kind == "FuncDef") {
+                define(Def::Kind::Function, item, item->children.value(0));
+            } else if (kind == "ExprStmt" || kind == "ReturnStmt") {
+                use(item->children.value(0));
+            } else if (kind != "Block") {
+                use(item);  // a call statement, condition or iterable
+            }
+        }
+    }
+
+    // Uses of names not yet bound in their block: the definitions reaching
+    // the block's entry, found once per block and name
+    std::unordered_map<uint64_t, Reach> entryMemo;
+    for (const Use& u : uses) {
+        const uint64_t key = (uint64_t(uint32_t(u.block)) << 32) | uint32_t(u.index);
+        auto memo = entryMemo.find(key);
+        if (memo == entryMemo.end()) {
+            const uint64_t var = varKey({ scope, u.index });
+            memo = entryMemo.emplace(key, reachingAtEntry(graph, u.block, var, lastDef)).first;
+        }
+        reaches[u.node] = memo->second;
+    }
+
+    if (isFunction) {
+        // Returns and the end of the body count only where they can run
+        for (int32_t b : graph.reversePostorder()) {
+            for (const ParseNode* item : graph.items(b)) {
+                if (item->name == "ReturnStmt") functions[function].returns.push_back(item);
+            }
+            if (graph.isOpaque(b)) functions[function].opaque = true;
+        }
+        functions[function].fallsOff = graph.fallthrough >= 0 && graph.isReachable(graph.fallthrough);
+    }
+}
+
+// A call whose name can only hold functions passes its arguments to their
+// parameters; a function that is used any other way may be called from
+// anywhere, so nothing is known about its parameters
+void TypeInference::linkCalls() {
+    for (const auto& entry : reaches) {
+        const ParseNode* use = entry.first;
+        const Reach& reach = entry.second;
+        bool onlyFunctions = !reach.opaque && !reach.defs.empty();
+        for (int32_t def : reach.defs) {
+            onlyFunctions = onlyFunctions && defs[def].kind == Def::Kind::Function;
+        }
+        for (int32_t def : reach.defs) {
+            if (defs[def].kind != Def::Kind::Function) continue;
+            auto function = functionIndex.find(defs[def].node);
+            if (function == functionIndex.end()) continue;
+            if (use->name == "FuncCall" && onlyFunctions) {
+                functions[function->second].calls.push_back(use);
+            } else {
+                functions[function->second].escapes = true;
+            }
+        }
+    }
+}
+
+//——— Solver ———
+
+void TypeInference::run(const std::vector<ControlFlowGraph>& graphs, const ScopeResolver& scopes) {
+    resolver = &scopes;
+    defs.clear();
+    functions.clear();
+    functionIndex.clear();
+    defsOfVar.clear();
+    reaches.clear();
+    dependents.clear();
+    dependencyEdges.clear();
+    outerUses.clear();
+    opaqueScopes.clear();
+    moduleTypes.clear();
+    localTypes.clear();
+    evaluations = 0;
+
+    for (const ControlFlowGraph& graph : graphs) {
+        addGraph(graph);
+    }
+
+    // A function reading a name of another scope sees any of its values
+    for (const auto& use : outerUses) {
+        Reach& reach = reaches[use.first];
+        auto all = defsOfVar.find(use.second);
+        if (all != defsOfVar.end()) reach.defs = all->second;
+        reach.opaque = opaqueScopes.count(int32_t(use.second >> 32)) > 0;
+    }
+    linkCalls();
+
+    // Definitions first, then each function's return type
+    const int32_t defCount = int32_t(defs.size());
+    const int32_t nodeCount = defCount + int32_t(functions.size());
+    dependents.assign(nodeCount, {});
+    std::deque<int32_t> worklist;
+    std::vector<bool> queued(nodeCount, true);
+    for (int32_t node = 0; node < nodeCount; ++node) {
+        worklist.push_back(node);
+    }
+
+    while (!worklist.empty()) {
+        const int32_t node = worklist.front();
+        worklist.pop_front();
+        queued[node] = false;
+        ++evaluations;
+
+        evaluating = node;
+        TypeSet& current = node < defCount ? defs[node].type : functions[node - defCount].result;
+        const TypeSet computed = node < defCount ? evaluateDef(node) : evaluateReturns(node - defCount);
+        evaluating = -1;
+
+        // Types only grow, so the solver stops once nothing changes
+        const TypeSet grown = TypeSet(current | computed);
+        if (grown == current) continue;
+        current = grown;
+        for (int32_t dependent : dependents[node]) {
+            if (!queued[dependent]) {
+                queued[dependent] = true;
+                worklist.push_back(dependent);
+            }
+        }
+    }
+
+    // Summaries for the symbol table; an unparsed block may rebind any
+    // name of its scope
+    for (const Def& def : defs) {
+        const Slot slot{ int32_t(def.var >> 32), int32_t(uint32_t(def.var)) };
+        const std::string name(resolver->nameOf(slot));
+        auto& types = slot.scope == ScopeResolver::MODULE_SCOPE ? moduleTypes : localTypes;
+        types[name] |= opaqueScopes.count(slot.scope) ? ANY_TYPE : def.type;
+    }
+    resolver = nullptr;
+}
+
+void TypeInference::dependOn(int32_t node) {
+    if (evaluating < 0) return;
+    const uint64_t edge = (uint64_t(uint32_t(node)) << 32) | uint32_t(evaluating);
+    if (dependencyEdges.insert(edge).second) dependents[node].push_back(evaluating);
+}
+
+TypeSet TypeInference::typeOfReach(const Reach& reach) {
+    TypeSet types = reach.opaque ? ANY_TYPE : 0;
+    for (int32_t def : reach.defs) {
+        dependOn(def);
+        types |= defs[def].type;
+    }
+    return types;
+}
+
+TypeSet TypeInference::evaluateDef(int32_t index) {
+    const Def& def = defs[index];
+    switch (def.kind) {
+    case Def::Kind::Function:
+        return FUNCTION;
+    case Def::Kind::Assign: {
+        const ParseNode* value = def.node->children.value(1);
+        if (def.node->value == "=") return evaluate(value);
+        auto current = reaches.find(def.target);
+        const TypeSet before = current != reaches.end() ? typeOfReach(current->second) : 0;
+        // "+=" applies "+", and so on
+        const std::string op = def.node->value.toStdString();
+        return binaryResult(QString::fromStdString(op.substr(0, op.size() - 1)), before, evaluate(value), value);
+    }
+    case Def::Kind::ForTarget: {
+        const ParseNode* targets = def.node->children.value(0);
+        const ParseNode* iterable = def.node->children.value(1);
+        if (!targets || targets->children.size() != 1 || !iterable) return ANY_TYPE;
+        if (iterable->name == "FuncCall" && iterable->value == "range") {
+            const Slot* slot = resolver->slotOf(iterable);
+            if (slot && slot->scope == ScopeResolver::BUILTIN_SCOPE) return INT;
+        }
+        // Strings are the only iterables besides range() in the subset
+        const TypeSet types = evaluate(iterable);
+        if (types == ANY_TYPE) return ANY_TYPE;
+        return types & STR;
+    }
+    case Def::Kind::Param: {
+        const Function& function = functions[functionIndex.at(def.node)];
+        if (function.escapes || function.calls.empty()) return ANY_TYPE;
+        TypeSet types = 0;
+        for (const ParseNode* call : function.calls) {
+            const ParseNode* arg = call->children.value(def.paramIndex);
+            if (arg) types |= evaluate(arg);
+        }
+        return types;
+    }
+    }
+    return ANY_TYPE;
+}
+
+TypeSet TypeInference::evaluateReturns(int32_t index) {
+    const Function& function = functions[index];
+    if (function.opaque) return ANY_TYPE;
+    TypeSet types = function.fallsOff ? NONE : 0;
+    for (const ParseNode* ret : function.returns) {
+        const ParseNode* value = ret->children.value(0);
+        types |= value ? evaluate(value) : NONE;
+    }
+    return types;
+}
+
+TypeSet TypeInference::callResult(const ParseNode* call) {
+    const Slot* slot = resolver->slotOf(call);
+    if (slot && slot->scope == ScopeResolver::BUILTIN_SCOPE) {
+        if (call->value == "len") return INT;
+        if (call->value == "input") return STR;
+        if (call->value == "print") return NONE;
+        return ANY_TYPE;
+    }
+
+    auto reach = reaches.find(call);
+    if (reach == reaches.end() || reach->second.opaque) return ANY_TYPE;
+    TypeSet types = 0;
+    for (int32_t def : reach->second.defs) {
+        dependOn(def);
+        if (defs[def].kind == Def::Kind::Function) {
+            auto function = functionIndex.find(defs[def].node);
+            if (function == functionIndex.end()) return ANY_TYPE;
+            const int32_t node = int32_t(defs.size()) + function->second;
+            dependOn(node);
+            types |= functions[function->second].result;
+        } else if (defs[def].type & FUNCTION) {
+            return ANY_TYPE;    // some function we cannot follow
+        }
+    }
+    return types;
+}
+
+// Python's result types: bool acts as int in arithmetic, '/' always gives
+// a float, '**' of ints gives a float for negative exponents (only a
+// literal exponent is known not to be one), str supports + and * int, and
+// a pair with no result (a TypeError) adds nothing
+TypeSet TypeInference::binaryResult(const QString& op, TypeSet l, TypeSet r, const ParseNode* right) const {
+    TypeSet result = 0;
+    const TypeSet numbers[] = { INT, FLOAT, BOOL };
+    for (TypeSet a : numbers) {
+        if (!(l & a)) continue;
+        for (TypeSet b : numbers) {
+            if (!(r & b)) continue;
+            const bool isFloat = a == FLOAT || b == FLOAT;
+            if (op == "/") {
+                result |= FLOAT;
+            } else if (op == "**" && !isFloat) {
+                const bool literalExponent = right && isLiteral(right->name);
+                result |= literalExponent ? INT : TypeSet(INT | FLOAT);
+            } else {
+                result |= isFloat ? FLOAT : INT;
+            }
+        }
+    }
+    if (op == "+" && (l & STR) && (r & STR)) result |= STR;
+    if (op == "*" && (((l & STR) && (r & (INT | BOOL))) || ((l & (INT | BOOL)) && (r & STR)))) result |= STR;
+    return result;
+}
+
+// Post-order walk with an explicit stack; operand types wait on `values`
+TypeSet TypeInference::evaluate(const ParseNode* expr) {
+    if (!expr) return 0;
+    struct Frame {
+        const ParseNode* node;
+        int next;
+    };
+    std::vector<Frame> stack;
+    std::vector<TypeSet> values;
+    stack.push_back({ expr, 0 });
+
+    while (!stack.empty()) {
+        Frame& frame = stack.back();
+        const ParseNode* node = frame.node;
+        const bool isOperator = node && (node->name == "Operator" || node->name == "CompareOp");
+        if (isOperator && frame.next < int(node->children.size())) {
+            stack.push_back({ node->children[frame.next++], 0 });
+            continue;
+        }
+        stack.pop_back();
+
+        TypeSet result = ANY_TYPE;
+        if (!node) {
+            result = 0;
+        } else if (isLiteral(node->name)) {
+            result = literalType(node);
+        } else if (node->name == "Identifier") {
+            const Slot* slot = resolver->slotOf(node);
+            auto reach = reaches.find(node);
+            if (slot && slot->scope == ScopeResolver::BUILTIN_SCOPE) result = FUNCTION;
+            else if (reach != reaches.end()) result = typeOfReach(reach->second);
+        } else if (node->name == "FuncCall") {
+            result = callResult(node);
+        } else if (isOperator) {
+            const size_t arity = size_t(node->children.size());
+            TypeSet r = arity >= 2 ? values.back() : 0;
+            TypeSet l = arity >= 2 ? values[values.size() - 2] : 0;
+            values.resize(values.size() - arity);
+            result = node->name == "CompareOp" ? (l && r ? BOOL : 0)
+                                               : binaryResult(node->value, l, r, node->children.value(1));
+        }
+        values.push_back(result);
+    }
+    return values.empty() ? 0 : values.back();
+}
+
+//——— Results ———
+
+TypeSet TypeInference::typeOfUse(const ParseNode* identifier) const {
+    auto reach = reaches.find(identifier);
+    if (reach == reaches.end()) return 0;
+    TypeSet types = reach->second.opaque ? ANY_TYPE : 0;
+    for (int32_t def : reach->second.defs) {
+        types |= defs[def].type;
+    }
+    return types;
+}
+
+TypeSet TypeInference::returnType(const ParseNode* funcDef) const {
+    auto function = functionIndex.find(funcDef);
+    return function != functionIndex.end() ? functions[function->second].result : 0;
+}
+
+void TypeInference::annotate(SymbolTable& table) const {
+    auto record = [&table](const std::string& name, TypeSet types) {
+        const SymbolId id = table.lookup(name);
+        const DataType type = singleType(types);
+        if (id != NO_SYMBOL && type != DataType::Unknown) table.setDataType(id, type);
+    };
+    for (const auto& entry : moduleTypes) {
+        record(entry.first, entry.second);
+    }
+    for (const auto& entry : localTypes) {
+        if (!moduleTypes.count(entry.first)) record(entry.first, entry.second);
+    }
+}
@@ -0,0 +1,112 @@
+// typeinference.h
+#ifndef TYPEINFERENCE_H
+#define TYPEINFERENCE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "cfg.h"
+#include "scoperesolver.h"
+#include "symboltable.h"
+
+// Set of the Python types a value may have, one bit per DataType
+using TypeSet = uint8_t;
+constexpr TypeSet typeBit(DataType type) {
+    return type == DataType::Unknown ? TypeSet(0) : TypeSet(1u << (unsigned(type) - 1));
+}
+constexpr TypeSet ANY_TYPE = 0x3F;
+
+// The only type in `types`, or Unknown when there are none or several
+DataType singleType(TypeSet types);
+
+// Flow-sensitive type inference over the graphs from CfgBuilder.
+//
+// Every binding of a name (assignment, for target, def, parameter) is a
+// definition; every use of a name is linked to the definitions that reach
+// it along the control-flow graph. A sparse worklist then solves for the
+// types of all definitions at once: evaluating a definition records which
+// definitions (and function return types) it read, and only those
+// dependents are evaluated again when a type grows. Work is proportional
+// to the def-use edges, not to the size of the graph times the number of
+// names. Parameters take the types of the arguments at every call site;
+// calls take the types their function returns.
+class TypeInference {
+public:
+    // `graphs` and `resolver` must describe the same (materialized) tree
+    void run(const std::vector<ControlFlowGraph>& graphs, const ScopeResolver& resolver);
+
+    // Types an Identifier may hold where it is read
+    TypeSet typeOfUse(const ParseNode* identifier) const;
+    // Types a FuncDef's calls may return
+    TypeSet returnType(const ParseNode* funcDef) const;
+
+    // Fill the data type column: a module-level name shows every type it
+    // takes in the module, any other name every type of its function locals
+    void annotate(SymbolTable& table) const;
+
+    // Definitions and functions evaluated by the last run (for profiling)
+    size_t getEvaluations() const { return evaluations; }
+
+private:
+    struct Def {
+        enum class Kind : uint8_t { Assign, ForTarget, Function, Param };
+        Kind kind;
+        const ParseNode* node;      // Assignment, ForStmt or FuncDef
+        const ParseNode* target;    // the bound Identifier
+        uint64_t var;
+        int32_t paramIndex = -1;
+        TypeSet type = 0;
+    };
+
+    // Definitions that reach one use
+    struct Reach {
+        std::vector<int32_t> defs;
+        bool opaque = false;        // an unparsed block may also have bound the name
+    };
+
+    struct Function {
+        explicit Function(const ParseNode* def) : def(def) {}
+        const ParseNode* def;
+        std::vector<const ParseNode*> returns;  // reachable ReturnStmts
+        bool fallsOff = false;                  // the end of the body is reachable
+        std::vector<const ParseNode*> calls;    // call sites that can reach this function
+        bool escapes = false;                   // used as a value, so callers are unknown
+        bool opaque = false;                    // has an unparsed block that may return
+        TypeSet result = 0;
+    };
+
+    const ScopeResolver* resolver = nullptr;
+    std::vector<Def> defs;
+    std::vector<Function> functions;
+    std::unordered_map<const ParseNode*, int32_t> functionIndex;   // FuncDef -> functions
+    std::unordered_map<uint64_t, std::vector<int32_t>> defsOfVar;
+    std::unordered_map<const ParseNode*, Reach> reaches;           // Identifier or FuncCall use
+    std::vector<std::vector<int32_t>> dependents;                 // defs, then functions
+    std::unordered_set<uint64_t> dependencyEdges;
+    std::vector<std::pair<const ParseNode*, uint64_t>> outerUses;  // uses of another scope's names
+    std::unordered_set<int32_t> opaqueScopes;                      // scopes with unparsed blocks
+    std::unordered_map<std::string, TypeSet> moduleTypes;
+    std::unordered_map<std::string, TypeSet> localTypes;
+    int32_t evaluating = -1;
+    size_t evaluations = 0;
+
+    static uint64_t varKey(const Slot& slot) { return (uint64_t(uint32_t(slot.scope)) << 32) | uint32_t(slot.index); }
+
+    void addGraph(const ControlFlowGraph& graph);
+    int32_t addDef(Def::Kind kind, const ParseNode* node, const ParseNode* target);
+    Reach reachingAtEntry(const ControlFlowGraph& graph, int32_t block, uint64_t var,
+                          const std::vector<std::unordered_map<uint64_t, int32_t>>& lastDef) const;
+    void linkCalls();
+
+    TypeSet evaluateDef(int32_t index);
+    TypeSet evaluateReturns(int32_t function);
+    TypeSet evaluate(const ParseNode* expr);
+    TypeSet binaryResult(const QString& op, TypeSet l, TypeSet r, const ParseNode* right) const;
+    TypeSet typeOfReach(const Reach& reach);
+    TypeSet callResult(const ParseNode* call);
+    void dependOn(int32_t node);
+};
+
+#endif // TYPEINFERENCE_H
@@ -0,0 +1,736 @@
+// vm.cpp
+#include "vm.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <new>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+
+bool isIntegral(const Value& v) {
+    return v.kind == Value::Kind::Int || v.kind == Value::Kind::Bool || v.kind == Value::Kind::Big;
+}
+bool isNumeric(const Value& v)  { return isIntegral(v) || v.kind == Value::Kind::Float; }
+
+const char* symbolOf(Op op) {
+    switch (op) {
+    case Op::Add:   return "+";
+    case Op::Sub:   return "-";
+    case Op::Mul:   return "*";
+    case Op::Div:   return "/";
+    case Op::Mod:   return "%";
+    case Op::Pow:   return "**";
+    case Op::CmpEq: return "==";
+    case Op::CmpNe: return "!=";
+    case Op::CmpLt: return "<";
+    case Op::CmpLe: return "<=";
+    case Op::CmpGt: return ">";
+    case Op::CmpGe: return ">=";
+    default:        return "?";
+    }
+}
+
+} // namespace
+
+VirtualMachine::VirtualMachine(const BytecodeProgram& program)
+    : program(program) {}
+
+//——— Values ———
+
+const char* VirtualMachine::typeName(const Value& v) {
+    switch (v.kind) {
+    case Value::Kind::None:  return "NoneType";
+    case Value::Kind::Bool:  return "bool";
+    case Value::Kind::Int:
+    case Value::Kind::Big:   return "int";
+    case Value::Kind::Float: return "float";
+    case Value::Kind::Str:   return "str";
+    case Value::Kind::Func:  return "function";
+    default:                 return "unbound";
+    }
+}
+
+bool VirtualMachine::truthy(const Value& v) {
+    switch (v.kind) {
+    case Value::Kind::Bool:
+    case Value::Kind::Int:   return v.i != 0;
+    case Value::Kind::Float: return v.f != 0.0;
+    case Value::Kind::Big:
+    case Value::Kind::Func:  return true;
+    default:                 return false;
+    }
+}
+
+// String values index the program's constants first, then the strings
+// built at run time
+const std::string& VirtualMachine::stringOf(const Value& v) const {
+    if (v.ref < program.strings.size()) return program.strings[v.ref];
+    return runtimeStrings[v.ref - program.strings.size()];
+}
+
+bool VirtualMachine::makeString(std::string s, Value& result, std::string& error) {
+    if (!reserveRuntime(sizeof(std::string) + s.size(), error)) return false;
+    runtimeStrings.push_back(std::move(s));
+    result = Value::string(uint32_t(program.strings.size() + runtimeStrings.size() - 1));
+    return true;
+}
+
+// Big values index the same way: the program's first, then the run's own
+Integer VirtualMachine::integerOf(const Value& v) const {
+    if (v.kind != Value::Kind::Big) return Integer(v.i);
+    if (v.ref < program.bigIntegers.size()) return program.bigIntegers[v.ref];
+    return runtimeIntegers[v.ref - program.bigIntegers.size()];
+}
+
+Numeric VirtualMachine::numericOf(const Value& v) const {
+    return v.kind == Value::Kind::Float ? Numeric::real(v.f) : Numeric::integer(integerOf(v));
+}
+
+// Ints that fit in 64 bits stay unboxed
+bool VirtualMachine::makeInteger(const Integer& n, Value& result, std::string& error) {
+    if (n.isSmall()) {
+        result = Value::integer(n.smallValue());
+        return true;
+    }
+    if (!reserveRuntime(sizeof(Integer) + n.bitLength() / 8, error)) return false;
+    runtimeIntegers.push_back(n);
+    result = Value::big(uint32_t(program.bigIntegers.size() + runtimeIntegers.size() - 1));
+    return true;
+}
+
+//——— Runtime memory ———
+
+bool VirtualMachine::reserveRuntime(size_t bytes, std::string& error) {
+    if (runtimeBytes + bytes > collectAt) {
+        collect();
+        collectAt = std::max(FIRST_COLLECTION, 2 * runtimeBytes);
+    }
+    if (runtimeBytes + bytes > MAX_RUNTIME_BYTES) {
+        error = "out of memory";
+        return false;
+    }
+    runtimeBytes += bytes;
+    return true;
+}
+
+// Strings and ints that no global or live stack slot refers to are dropped
+// and the rest moved down in order, and the values referring to them are
+// renumbered to match. Constants of the program never move.
+void VirtualMachine::collect() {
+    const uint32_t stringBase = uint32_t(program.strings.size());
+    const uint32_t integerBase = uint32_t(program.bigIntegers.size());
+    const uint32_t dead = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> stringIndex(runtimeStrings.size(), dead);
+    std::vector<uint32_t> integerIndex(runtimeIntegers.size(), dead);
+
+    auto forEachRoot = [this](auto&& visit) {
+        for (Value& v : globals) visit(v);
+        for (Value* v = stack.data(); v < liveTop; ++v) visit(*v);
+    };
+    forEachRoot([&](const Value& v) {
+        if (v.kind == Value::Kind::Str && v.ref >= stringBase) stringIndex[v.ref - stringBase] = 0;
+        if (v.kind == Value::Kind::Big && v.ref >= integerBase) integerIndex[v.ref - integerBase] = 0;
+    });
+
+    runtimeBytes = 0;
+    uint32_t live = 0;
+    for (size_t i = 0; i < runtimeStrings.size(); ++i) {
+        if (stringIndex[i] == dead) continue;
+        if (i != live) runtimeStrings[live] = std::move(runtimeStrings[i]);
+        runtimeBytes += sizeof(std::string) + runtimeStrings[live].size();
+        stringIndex[i] = live++;
+    }
+    runtimeStrings.resize(live);
+    live = 0;
+    for (size_t i = 0; i < runtimeIntegers.size(); ++i) {
+        if (integerIndex[i] == dead) continue;
+        if (i != live) runtimeIntegers[live] = std::move(runtimeIntegers[i]);
+        runtimeBytes += sizeof(Integer) + runtimeIntegers[live].bitLength() / 8;
+        integerIndex[i] = live++;
+    }
+    runtimeIntegers.resize(live);
+
+    forEachRoot([&](Value& v) {
+        if (v.kind == Value::Kind::Str && v.ref >= stringBase) v.ref = stringBase + stringIndex[v.ref - stringBase];
+        if (v.kind == Value::Kind::Big && v.ref >= integerBase) v.ref = integerBase + integerIndex[v.ref - integerBase];
+    });
+}
+
+std::string VirtualMachine::formatValue(const Value& v) const {
+    switch (v.kind) {
+    case Value::Kind::None:  return "None";
+    case Value::Kind::Bool:  return v.i ? "True" : "False";
+    case Value::Kind::Int:   return std::to_string(v.i);
+    case Value::Kind::Big:   return integerOf(v).toString();
+    case Value::Kind::Float: return formatFloat(v.f);
+    case Value::Kind::Str:   return stringOf(v);
+    case Value::Kind::Func:  return "<function " + program.functions[v.ref].name + ">";
+    default:                 return "<unbound>";
+    }
+}
+
+//——— Slow paths ———
+
+bool VirtualMachine::arithmetic(Op op, const Value& l, const Value& r, Value& result, std::string& error) {
+    if (isNumeric(l) && isNumeric(r)) {
+        ArithOp arith = ArithOp::Add;
+        switch (op) {
+        case Op::Add: arith = ArithOp::Add; break;
+        case Op::Sub: arith = ArithOp::Sub; break;
+        case Op::Mul: arith = ArithOp::Mul; break;
+        case Op::Div: arith = ArithOp::Div; break;
+        case Op::Mod: arith = ArithOp::Mod; break;
+        default:      arith = ArithOp::Pow; break;
+        }
+
+        // Overflow of the inline int path lands here and is promoted
+        Numeric n;
+        if (!applyArithmetic(arith, numericOf(l), numericOf(r), n, error)) return false;
+        if (n.isFloat) {
+            result = Value::real(n.f);
+            return true;
+        }
+        return makeInteger(n.i, result, error);
+    }
+
+    // Both build the new string before it is stored, so they copy out of
+    // the operands before makeString can move them
+    if (l.kind == Value::Kind::Str && r.kind == Value::Kind::Str && op == Op::Add) {
+        const std::string& left = stringOf(l);
+        const std::string& right = stringOf(r);
+        if (left.size() + right.size() > MAX_RUNTIME_BYTES) {
+            error = "out of memory";
+            return false;
+        }
+        std::string joined;
+        joined.reserve(left.size() + right.size());
+        joined += left;
+        joined += right;
+        pendingWork += joined.size() / BYTES_PER_BUDGET_UNIT;
+        return makeString(std::move(joined), result, error);
+    }
+    if (op == Op::Mul && ((l.kind == Value::Kind::Str && isIntegral(r)) || (isIntegral(l) && r.kind == Value::Kind::Str))) {
+        const Value& s = l.kind == Value::Kind::Str ? l : r;
+        const Value& times = l.kind == Value::Kind::Str ? r : l;
+        if (times.kind == Value::Kind::Big) {
+            error = "cannot fit 'int' into an index-sized integer";
+            return false;
+        }
+        const std::string& text = stringOf(s);
+        if (times.i <= 0 || text.empty()) return makeString(std::string(), result, error);
+        if (uint64_t(times.i) > MAX_OUTPUT / text.size()) {
+            error = "string repetition too large";
+            return false;
+        }
+        // Doubling copies the whole result in a handful of appends
+        const size_t size = text.size() * size_t(times.i);
+        std::string repeated;
+        repeated.reserve(size);
+        repeated = text;
+        while (repeated.size() * 2 <= size) repeated += repeated;
+        repeated.append(repeated, 0, size - repeated.size());
+        pendingWork += size / BYTES_PER_BUDGET_UNIT;
+        return makeString(std::move(repeated), result, error);
+    }
+
+    error = std::string("unsupported operand type(s) for ") + symbolOf(op) + ": '" +
+            typeName(l) + "' and '" + typeName(r) + "'";
+    return false;
+}
+
+bool VirtualMachine::compare(Op op, const Value& l, const Value& r, Value& result, std::string& error) const {
+    int order = 0;
+    bool comparable = true;
+    if (isNumeric(l) && isNumeric(r)) {
+        bool unordered = false;
+        if (isIntegral(l) && isIntegral(r) && l.kind != Value::Kind::Big && r.kind != Value::Kind::Big) {
+            order = (l.i > r.i) - (l.i < r.i);
+        } else {
+            order = compareNumeric(numericOf(l), numericOf(r), unordered);
+        }
+        if (unordered) {
+            result = Value::boolean(op == Op::CmpNe);
+            return true;
+        }
+    } else if (l.kind == Value::Kind::Str && r.kind == Value::Kind::Str) {
+        const int c = stringOf(l).compare(stringOf(r));
+        order = (c > 0) - (c < 0);
+    } else if (l.kind == r.kind && (l.kind == Value::Kind::None || l.kind == Value::Kind::Func)) {
+        order = l.kind == Value::Kind::Func && l.ref != r.ref ? 1 : 0;
+        comparable = false;
+    } else {
+        order = 1;
+        comparable = false;
+    }
+
+    switch (op) {
+    case Op::CmpEq: result = Value::boolean(order == 0); return true;
+    case Op::CmpNe: result = Value::boolean(order != 0); return true;
+    default: break;
+    }
+    if (!comparable) {
+        error = std::string("'") + symbolOf(op) + "' not supported between instances of '" +
+                typeName(l) + "' and '" + typeName(r) + "'";
+        return false;
+    }
+    switch (op) {
+    case Op::CmpLt: result = Value::boolean(order < 0);  break;
+    case Op::CmpLe: result = Value::boolean(order <= 0); break;
+    case Op::CmpGt: result = Value::boolean(order > 0);  break;
+    default:        result = Value::boolean(order >= 0); break;
+    }
+    return true;
+}
+
+bool VirtualMachine::callBuiltin(Builtin id, const Value* args, int argc, Value& result, std::string& error) {
+    result = Value::none();
+    switch (id) {
+    case Builtin::Print: {
+        std::string line;
+        for (int i = 0; i < argc; ++i) {
+            if (i) line += ' ';
+            line += formatValue(args[i]);
+        }
+        line += '\n';
+        if (output.size() < MAX_OUTPUT) {
+            output += line;
+            if (output.size() >= MAX_OUTPUT) output += "... output truncated\n";
+        }
+        return true;
+    }
+    case Builtin::Len:
+        if (argc != 1) {
+            error = "len() takes exactly one argument (" + std::to_string(argc) + " given)";
+            return false;
+        }
+        if (args[0].kind != Value::Kind::Str) {
+            error = std::string("object of type '") + typeName(args[0]) + "' has no len()";
+            return false;
+        }
+        result = Value::integer(int64_t(stringOf(args[0]).size()));
+        return true;
+    case Builtin::Input:
+        // There is no console to read from; the prompt is echoed and the
+        // answer is always empty
+        if (argc > 1) {
+            error = "input expected at most 1 argument, got " + std::to_string(argc);
+            return false;
+        }
+        if (argc == 1 && output.size() < MAX_OUTPUT) output += formatValue(args[0]);
+        return makeString(std::string(), result, error);
+    }
+    return true;
+}
+
+bool VirtualMachine::chargeWork(uint64_t& budget, std::string& error) {
+    if (pendingWork == 0) return true;
+    const uint64_t work = pendingWork;
+    pendingWork = 0;
+    if (work >= budget) {
+        error = "Execution limit reached";
+        return false;
+    }
+    budget -= work;
+    return true;
+}
+
+bool VirtualMachine::budgetCheckpoint(uint64_t budget, std::string& error) const {
+    if (budget == 0) {
+        error = "Execution limit reached";
+        return false;
+    }
+    if (cancellation && cancellation->isCancelled()) {
+        error = "Run cancelled";
+        return false;
+    }
+    return true;
+}
+
+bool VirtualMachine::fail(uint32_t pc, const std::string& message) {
+    runtimeError.message = message;
+    runtimeError.line = pc < program.lines.size() ? program.lines[pc] : 0;
+    return false;
+}
+
+//——— Interpreter loop ———
+
+bool VirtualMachine::run() {
+    globals.assign(program.globalNames.size(), Value());
+    stack.assign(STACK_SIZE, Value());
+    frames.clear();
+    runtimeStrings.clear();
+    runtimeIntegers.clear();
+    runtimeBytes = 0;
+    collectAt = FIRST_COLLECTION;
+    liveTop = stack.data();
+    pendingWork = 0;
+    output.clear();
+    runtimeError = RuntimeError();
+
+    profile = VmProfile();
+    if (profiling) {
+        profile.perOpcode.assign(size_t(Op::Count), 0);
+        profile.perInstruction.assign(program.code.size(), 0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    try {
+        ok = profiling ? execute<true>() : execute<false>();
+    } catch (const std::bad_alloc&) {
+        // Runtime data is capped, but the host may still run short
+        ok = fail(uint32_t(program.code.size()), "out of memory");
+    }
+    profile.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (profiling) {
+        for (size_t pc = 0; pc < profile.perInstruction.size(); ++pc) {
+            profile.perOpcode[size_t(program.code[pc].op)] += profile.perInstruction[pc];
+            profile.instructions += profile.perInstruction[pc];
+        }
+    }
+    return ok;
+}
+
+// Threaded dispatch where the compiler supports labels as values (one
+// indirect jump per opcode, which predicts far better than a shared
+// switch), a plain switch elsewhere
+#if defined(__GNUC__) || defined(__clang__)
+#define VM_COMPUTED_GOTO 1
+#endif
+
+template <bool Profiled>
+bool VirtualMachine::execute() {
+    const Instr* const code = program.code.data();
+    const Value* const constants = program.constants.data();
+    Value* const globalSlots = globals.data();
+    Value* const stackEnd = stack.data() + stack.size();
+    uint64_t* const counters = Profiled ? profile.perInstruction.data() : nullptr;
+
+    Value* fp = stack.data();   // locals of the running function
+    Value* sp = fp;             // next free slot
+    uint32_t pc = 0;
+    uint64_t budget = instructionBudget ? instructionBudget : std::numeric_limits<uint64_t>::max();
+    const Instr* ins = nullptr;
+    std::string error;
+
+#define VM_PUSH_CHECK(n) \
+    if (sp + (n) > stackEnd) return fail(pc, "stack overflow")
+
+#ifdef VM_COMPUTED_GOTO
+    static void* const labels[] = {
+#define BYTECODE_LABEL(name) &&op_##name,
+        BYTECODE_OPCODES(BYTECODE_LABEL)
+#undef BYTECODE_LABEL
+    };
+#define VM_CASE(name) op_##name:
+#define VM_NEXT()                                   \
+    do {                                            \
+        ins = &code[pc];                            \
+        if (Profiled) counters[pc]++;               \
+        goto *labels[size_t(ins->op)];              \
+    } while (0)
+
+    VM_NEXT();
+#else
+#define VM_CASE(name) case Op::name:
+#define VM_NEXT() continue
+
+    for (;;) {
+        ins = &code[pc];
+        if (Profiled) counters[pc]++;
+        switch (ins->op) {
+#endif
+
+    VM_CASE(LoadConst) {
+        VM_PUSH_CHECK(1);
+        *sp++ = constants[ins->a];
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(LoadGlobal) {
+        const Value& v = globalSlots[ins->a];
+        if (v.kind == Value::Kind::Unbound) {
+            return fail(pc, "name '" + program.globalNames[ins->a] + "' is not defined");
+        }
+        VM_PUSH_CHECK(1);
+        *sp++ = v;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(StoreGlobal) {
+        globalSlots[ins->a] = *--sp;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(LoadLocal) {
+        const Value& v = fp[ins->a];
+        if (v.kind == Value::Kind::Unbound) {
+            const FunctionInfo& fn = program.functions[frames.back().function];
+            return fail(pc, "local variable '" + fn.localNames[ins->a] + "' referenced before assignment");
+        }
+        VM_PUSH_CHECK(1);
+        *sp++ = v;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(StoreLocal) {
+        fp[ins->a] = *--sp;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(Pop) {
+        --sp;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(PopN) {
+        sp -= ins->a;
+        pc++;
+        VM_NEXT();
+    }
+
+    // Arithmetic on two ints is handled inline; everything else, including
+    // results that overflow 64 bits, goes through arithmetic()
+#define VM_ARITH(name, intOp)                                               \
+    VM_CASE(name) {                                                         \
+        Value& l = sp[-2];                                                  \
+        const Value& r = sp[-1];                                            \
+        int64_t n;                                                          \
+        if (l.kind == Value::Kind::Int && r.kind == Value::Kind::Int &&     \
+            !intOp(l.i, r.i, n)) {                                          \
+            l.i = n;                                                        \
+        } else {                                                            \
+            liveTop = sp;                                                   \
+            if (!arithmetic(Op::name, l, r, l, error) ||                    \
+                !chargeWork(budget, error)) {                               \
+                return fail(pc, error);                                     \
+            }                                                               \
+        }                                                                   \
+        --sp;                                                               \
+        pc++;                                                               \
+        VM_NEXT();                                                          \
+    }
+
+    VM_ARITH(Add, addOverflows)
+    VM_ARITH(Sub, subOverflows)
+    VM_ARITH(Mul, mulOverflows)
+#undef VM_ARITH
+
+    VM_CASE(Div) {
+        // Ints of up to 53 bits convert to double exactly, so one division rounds correctly
+        Value& l = sp[-2];
+        const Value& r = sp[-1];
+        const int64_t exact = int64_t(1) << 53;
+        if (l.kind == Value::Kind::Int && r.kind == Value::Kind::Int && r.i != 0 &&
+            l.i <= exact && l.i >= -exact && r.i <= exact && r.i >= -exact) {
+            l = Value::real(double(l.i) / double(r.i));
+        } else {
+            liveTop = sp;
+            if (!arithmetic(Op::Div, l, r, l, error)) return fail(pc, error);
+        }
+        --sp;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(Mod) {
+        Value& l = sp[-2];
+        const Value& r = sp[-1];
+        if (l.kind == Value::Kind::Int && r.kind == Value::Kind::Int && r.i != 0) {
+            l.i = floorMod(l.i, r.i);
+        } else {
+            liveTop = sp;
+            if (!arithmetic(Op::Mod, l, r, l, error)) return fail(pc, error);
+        }
+        --sp;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(Pow) {
+        liveTop = sp;
+        if (!arithmetic(Op::Pow, sp[-2], sp[-1], sp[-2], error)) return fail(pc, error);
+        --sp;
+        pc++;
+        VM_NEXT();
+    }
+
+#define VM_COMPARE(name, cmp)                                               \
+    VM_CASE(name) {                                                         \
+        Value& l = sp[-2];                                                  \
+        const Value& r = sp[-1];                                            \
+        if (l.kind == Value::Kind::Int && r.kind == Value::Kind::Int) {     \
+            l = Value::boolean(l.i cmp r.i);                                \
+        } else if (!compare(Op::name, l, r, l, error)) {                    \
+            return fail(pc, error);                                         \
+        }                                                                   \
+        --sp;                                                               \
+        pc++;                                                               \
+        VM_NEXT();                                                          \
+    }
+
+    VM_COMPARE(CmpEq, ==)
+    VM_COMPARE(CmpNe, !=)
+    VM_COMPARE(CmpLt, <)
+    VM_COMPARE(CmpLe, <=)
+    VM_COMPARE(CmpGt, >)
+    VM_COMPARE(CmpGe, >=)
+#undef VM_COMPARE
+
+    VM_CASE(Jump) {
+        // Only backward jumps (loops) count against the budget; every few
+        // thousand of them the run checks whether it should stop
+        if (uint32_t(ins->a) <= pc && (--budget & CANCEL_POLL_MASK) == 0 && !budgetCheckpoint(budget, error)) {
+            return fail(pc, error);
+        }
+        pc = uint32_t(ins->a);
+        VM_NEXT();
+    }
+    VM_CASE(JumpIfFalse) {
+        const Value& v = *--sp;
+        if (v.kind == Value::Kind::Bool ? v.i == 0 : !truthy(v)) {
+            pc = uint32_t(ins->a);
+        } else {
+            pc++;
+        }
+        VM_NEXT();
+    }
+    VM_CASE(ForRange) {
+        Value& cur = sp[-3];
+        Value& stop = sp[-2];
+        Value& step = sp[-1];
+        if (cur.kind != Value::Kind::Int || stop.kind != Value::Kind::Int || step.kind != Value::Kind::Int) {
+            for (Value* v : { &cur, &stop, &step }) {
+                if (v->kind == Value::Kind::Bool) {
+                    v->kind = Value::Kind::Int;
+                } else if (v->kind == Value::Kind::Big) {
+                    return fail(pc, "range() argument too large");
+                } else if (v->kind != Value::Kind::Int) {
+                    return fail(pc, std::string("'") + typeName(*v) + "' object cannot be interpreted as an integer");
+                }
+            }
+        }
+        if (step.i == 0) return fail(pc, "range() arg 3 must not be zero");
+
+        if (step.i > 0 ? cur.i < stop.i : cur.i > stop.i) {
+            const int64_t value = cur.i;
+            if (addOverflows(cur.i, step.i, cur.i)) cur.i = stop.i;  // past the end either way
+            *sp++ = Value::integer(value);
+            pc++;
+        } else {
+            sp -= 3;
+            pc = uint32_t(ins->a);
+        }
+        VM_NEXT();
+    }
+    VM_CASE(Call) {
+        const int argc = ins->a;
+        Value* args = sp - argc;
+        const Value& callee = args[-1];
+        if (callee.kind != Value::Kind::Func) {
+            return fail(pc, std::string("'") + typeName(callee) + "' object is not callable");
+        }
+        const FunctionInfo& fn = program.functions[callee.ref];
+        if (argc != fn.params) {
+            return fail(pc, fn.name + "() takes " + std::to_string(fn.params) + " positional argument" +
+                            (fn.params == 1 ? "" : "s") + " but " + std::to_string(argc) +
+                            (argc == 1 ? " was" : " were") + " given");
+        }
+        if (frames.size() >= MAX_CALL_DEPTH) return fail(pc, "maximum recursion depth exceeded");
+        if ((--budget & CANCEL_POLL_MASK) == 0 && !budgetCheckpoint(budget, error)) return fail(pc, error);
+        VM_PUSH_CHECK(fn.locals - argc);
+
+        frames.push_back({ pc + 1, fp, callee.ref });
+        fp = args;
+        for (Value* slot = args + argc; slot < args + fn.locals; ++slot) {
+            *slot = Value();
+        }
+        sp = args + fn.locals;
+        pc = fn.entry;
+        VM_NEXT();
+    }
+    VM_CASE(CallBuiltin) {
+        const int argc = ins->a;
+        Value result;
+        liveTop = sp;
+        if (!callBuiltin(Builtin(ins->b), sp - argc, argc, result, error)) return fail(pc, error);
+        sp -= argc;
+        *sp++ = result;
+        pc++;
+        VM_NEXT();
+    }
+    VM_CASE(Return) {
+        const Value result = sp[-1];
+        const Frame frame = frames.back();
+        frames.pop_back();
+        sp = fp - 1;    // drop the locals and the callee
+        *sp++ = result;
+        fp = frame.callerBase;
+        pc = frame.returnPc;
+        VM_NEXT();
+    }
+    VM_CASE(ReturnNone) {
+        const Frame frame = frames.back();
+        frames.pop_back();
+        sp = fp - 1;
+        *sp++ = Value::none();
+        fp = frame.callerBase;
+        pc = frame.returnPc;
+        VM_NEXT();
+    }
+    VM_CASE(Halt) {
+        return true;
+    }
+
+#ifndef VM_COMPUTED_GOTO
+        default:
+            return fail(pc, "invalid opcode");
+        }
+    }
+#endif
+
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_PUSH_CHECK
+}
+
+//——— Profile ———
+
+std::string VirtualMachine::profileReport(size_t topN) const {
+    std::ostringstream out;
+    out << "Executed " << profile.instructions << " instructions in "
+        << std::fixed << std::setprecision(3) << profile.seconds * 1000.0 << " ms\n";
+    if (profile.perOpcode.empty()) return out.str();
+
+    std::vector<std::pair<uint64_t, size_t>> opcodes;
+    for (size_t op = 0; op < profile.perOpcode.size(); ++op) {
+        if (profile.perOpcode[op]) opcodes.push_back({ profile.perOpcode[op], op });
+    }
+    std::sort(opcodes.rbegin(), opcodes.rend());
+    out << "\nOpcode counts:\n";
+    for (const auto& entry : opcodes) {
+        out << "  " << std::left << std::setw(12) << opName(Op(entry.second)) << std::right
+            << std::setw(12) << entry.first << '\n';
+    }
+
+    std::map<int, uint64_t> perLine;
+    for (size_t pc = 0; pc < profile.perInstruction.size(); ++pc) {
+        if (profile.perInstruction[pc]) perLine[program.lines[pc]] += profile.perInstruction[pc];
+    }
+    std::vector<std::pair<uint64_t, int>> hot;
+    for (const auto& entry : perLine) {
+        hot.push_back({ entry.second, entry.first });
+    }
+    std::sort(hot.rbegin(), hot.rend());
+    if (hot.size() > topN) hot.resize(topN);
+    out << "\nHottest lines:\n";
+    for (const auto& entry : hot) {
+        out << "  line " << std::setw(5) << entry.second << std::setw(12) << entry.first << '\n';
+    }
+    return out.str();
+}
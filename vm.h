@@ -0,0 +1,112 @@
+// vm.h
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "bytecode.h"
+#include "cancellation.h"
+
+struct RuntimeError {
+    std::string message;
+    int line = 0;
+};
+
+// Counters gathered by a profiled run
+struct VmProfile {
+    uint64_t instructions = 0;
+    std::vector<uint64_t> perOpcode;        // indexed by Op
+    std::vector<uint64_t> perInstruction;   // indexed by pc
+    double seconds = 0.0;
+};
+
+// Stack machine for BytecodeProgram. Values live unboxed on one fixed-size
+// stack; a call frame is the callee's locals, followed by its temporaries.
+class VirtualMachine {
+public:
+    explicit VirtualMachine(const BytecodeProgram& program);
+
+    void setProfiling(bool enabled) { profiling = enabled; }
+    // Stop with an error after this many loop iterations and calls (0 = no limit)
+    void setInstructionBudget(uint64_t budget) { instructionBudget = budget; }
+    // Polled with the budget; once set, the run stops with an error
+    void setCancellation(const CancellationToken* token) { cancellation = token; }
+
+    // Returns false if the program stopped with a runtime error
+    bool run();
+
+    const std::string& getOutput() const { return output; }
+    const RuntimeError& getError() const { return runtimeError; }
+    const VmProfile& getProfile() const { return profile; }
+
+    std::string formatValue(const Value& v) const;
+    // Opcode counts and the most executed source lines
+    std::string profileReport(size_t topN = 10) const;
+
+private:
+    struct Frame {
+        uint32_t returnPc;
+        Value* callerBase;
+        uint32_t function;
+    };
+
+    static constexpr size_t STACK_SIZE = 64 * 1024;
+    static constexpr size_t MAX_CALL_DEPTH = 1000;
+    static constexpr size_t MAX_OUTPUT = 1 << 20;
+    // Strings and ints built while running may hold this much at once; past
+    // FIRST_COLLECTION bytes the unreachable ones are collected whenever the
+    // total doubles
+    static constexpr size_t MAX_RUNTIME_BYTES = size_t(256) << 20;
+    static constexpr size_t FIRST_COLLECTION = size_t(8) << 20;
+    // Bytes a string operation may copy per unit of the budget
+    static constexpr size_t BYTES_PER_BUDGET_UNIT = 1024;
+    // Loop iterations and calls between polls of the cancellation token
+    static constexpr uint64_t CANCEL_POLL_MASK = 0xFFF;
+
+    const BytecodeProgram& program;
+    std::vector<Value> globals;
+    std::vector<Value> stack;
+    std::vector<Frame> frames;
+    std::vector<std::string> runtimeStrings;  // strings built while running
+    std::vector<Integer> runtimeIntegers;     // ints past 64 bits built while running
+    size_t runtimeBytes = 0;                  // held by the two above
+    size_t collectAt = FIRST_COLLECTION;
+    // End of the live stack, set by the interpreter before any slow path
+    // that can allocate; with the globals, it bounds what a collection keeps
+    Value* liveTop = nullptr;
+    // Work done by slow paths, charged to the budget when they return
+    uint64_t pendingWork = 0;
+    std::string output;
+    RuntimeError runtimeError;
+    VmProfile profile;
+    bool profiling = false;
+    uint64_t instructionBudget = 0;
+    const CancellationToken* cancellation = nullptr;
+
+    template <bool Profiled>
+    bool execute();
+    bool fail(uint32_t pc, const std::string& message);
+
+    const std::string& stringOf(const Value& v) const;
+    bool makeString(std::string s, Value& result, std::string& error);
+    Integer integerOf(const Value& v) const;     // Bool, Int or Big
+    Numeric numericOf(const Value& v) const;
+    bool makeInteger(const Integer& n, Value& result, std::string& error);
+
+    // Make room for `bytes` more runtime data, collecting first if due.
+    // References into runtimeStrings and runtimeIntegers do not survive it.
+    bool reserveRuntime(size_t bytes, std::string& error);
+    void collect();
+    // Charge pendingWork and poll the cancellation token
+    bool chargeWork(uint64_t& budget, std::string& error);
+    bool budgetCheckpoint(uint64_t budget, std::string& error) const;
+    static const char* typeName(const Value& v);
+    static bool truthy(const Value& v);
+
+    bool arithmetic(Op op, const Value& l, const Value& r, Value& result, std::string& error);
+    bool compare(Op op, const Value& l, const Value& r, Value& result, std::string& error) const;
+    bool callBuiltin(Builtin id, const Value* args, int argc, Value& result, std::string& error);
+};
+
+#endif // VM_H